@@ -0,0 +1,917 @@
+#include "audio_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "emu_player.h"
+#include "resampler.h"
+#include "song_cache.h"
+
+namespace {
+// Largest block rendered per voice in one go; longer callbacks are split.
+const int SCRATCH_FRAMES = 4096;
+
+// Used until Audio_Manager tells us the real output rate
+const uint32_t DEFAULT_SAMPLE_RATE = 44100;
+
+// A callback this much later than the average period means the device ran dry
+const double UNDERRUN_FACTOR = 1.5;
+
+int64_t NowMicroseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Preview gains travel in Command::value as 16.16 fixed point
+const double GAIN_ONE = 65536.0;
+
+// Beyond this a preview is just clipping
+const float MAX_PREVIEW_GAIN = 4.0f;
+
+int64_t GainToCommand(float gain) {
+    return (int64_t)std::llround(std::max(0.0f, std::min(gain, MAX_PREVIEW_GAIN)) * GAIN_ONE);
+}
+
+float GainFromCommand(int64_t value) {
+    return (float)(value / GAIN_ONE);
+}
+
+// True if sequence number a was issued after b (wrap-safe)
+bool SeqAfter(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+// Audio_Manager holds streams by shared_ptr, so the engine lives in one too
+std::shared_ptr<AudioEngine>& Instance() {
+    static std::shared_ptr<AudioEngine> instance = std::make_shared<AudioEngine>();
+    return instance;
+}
+} // namespace
+
+AudioEngine& AudioEngine::Get()
+{
+    return *Instance();
+}
+
+AudioEngine::AudioEngine()
+    : m_handover_pending(false), m_shadow_frame(0), m_song_seq(0), m_mute_mask(0), m_last_callback_us(0),
+      m_callback_done(0), m_callback_song_start(0), m_monitor_started(false), m_monitor_frame(0), m_output_frames(0),
+      m_native_rate(false), m_block_frames(SCRATCH_FRAMES), m_visual_offset_ms(0),
+      m_sample_rate(0), m_processed_seq(0), m_song_active_seq(0), m_song_cached_seq(0), m_shadow_active_seq(0), m_song_frame(0), m_monitor_active_seq(0),
+      m_stat_callback_frames(0), m_stat_period_us(0), m_stat_max_period_us(0), m_stat_render_us(0),
+      m_stat_underruns(0), m_stat_overloads(0), m_stat_reset(false),
+      m_clock_seq(0), m_clock_time_us(0), m_clock_frames(0), m_clock_song_start(0), m_clock_song_end(0), m_clock_output_start(0),
+      m_next_seq(1), m_song_request_seq(0), m_song_request_cached(false), m_shadow_request_seq(0),
+      m_mute_request_seq(0), m_mute_request_mask(0), m_monitor_request_seq(0), m_started(false)
+{
+    m_scratch.resize(SCRATCH_FRAMES);
+    for (int i = 0; i < MAX_PREVIEWS; ++i) {
+        m_callback_preview_start[i] = -1;
+    }
+    finished = false;
+}
+
+AudioEngine::~AudioEngine()
+{
+}
+
+void AudioEngine::Start()
+{
+    if (m_started) return;
+    m_started = true;
+    Audio_Manager::get().add_stream(Instance());
+    std::cout << "[AudioEngine] Registered with Audio_Manager" << std::endl;
+}
+
+uint32_t AudioEngine::GetSampleRate() const
+{
+    uint32_t rate = m_sample_rate.load(std::memory_order_acquire);
+    return rate ? rate : DEFAULT_SAMPLE_RATE;
+}
+
+void AudioEngine::SetBlockFrames(int frames)
+{
+    m_block_frames.store(std::min(std::max(frames, 32), SCRATCH_FRAMES), std::memory_order_release);
+}
+
+AudioEngine::Stats AudioEngine::GetStats() const
+{
+    Stats stats;
+    stats.callback_frames = m_stat_callback_frames.load(std::memory_order_relaxed);
+    stats.period_ms = m_stat_period_us.load(std::memory_order_relaxed) / 1000.0;
+    stats.max_period_ms = m_stat_max_period_us.load(std::memory_order_relaxed) / 1000.0;
+    stats.render_ms = m_stat_render_us.load(std::memory_order_relaxed) / 1000.0;
+    stats.underruns = m_stat_underruns.load(std::memory_order_relaxed);
+    stats.overloads = m_stat_overloads.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioEngine::ResetStats()
+{
+    m_stat_reset.store(true, std::memory_order_release);
+}
+
+std::shared_ptr<Audio_Stream> AudioEngine::PrepareSong(std::shared_ptr<Emu_Player> player) const
+{
+    if (!player) return nullptr;
+    std::shared_ptr<Audio_Stream> stream;
+    if (GetNativeRate()) {
+        stream = std::make_shared<ResampledStream>(player, NATIVE_CHIP_RATE);
+    } else {
+        stream = player;
+    }
+    stream->setup_stream(GetSampleRate());
+    return stream;
+}
+
+//=====================================================================
+// UI thread
+//=====================================================================
+
+bool AudioEngine::Post(Command&& cmd)
+{
+    cmd.seq = m_next_seq++;
+    if (!m_commands.Push(std::move(cmd))) {
+        std::cerr << "[AudioEngine] Command queue full, dropping command" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AudioEngine::PlaySong(std::shared_ptr<Emu_Player> player)
+{
+    std::shared_ptr<Audio_Stream> stream = PrepareSong(player);
+    return PlaySong(std::move(player), std::move(stream), 0);
+}
+
+bool AudioEngine::PlaySong(std::shared_ptr<Emu_Player> player, std::shared_ptr<Audio_Stream> stream, int64_t start_frame)
+{
+    if (!player || !stream) return false;
+
+    Command cmd;
+    cmd.type = CMD_SONG_PLAY;
+    cmd.value = start_frame;
+    cmd.stream = std::move(stream);
+    cmd.player = std::move(player);
+    uint32_t seq = m_next_seq;
+    if (!Post(std::move(cmd))) return false;
+    m_song_request_seq = seq;
+    m_song_request_cached = false;
+    return true;
+}
+
+bool AudioEngine::PlayCachedSong(std::shared_ptr<CachedSongStream> stream, int64_t start_frame)
+{
+    if (!stream) return false;
+    stream->seek(start_frame);
+
+    Command cmd;
+    cmd.type = CMD_SONG_PLAY_CACHED;
+    cmd.value = start_frame;
+    cmd.stream = stream;
+    cmd.cached = std::move(stream);
+    uint32_t seq = m_next_seq;
+    if (!Post(std::move(cmd))) return false;
+    m_song_request_seq = seq;
+    m_song_request_cached = true;
+    return true;
+}
+
+bool AudioEngine::SeekSong(int64_t frame)
+{
+    if (!IsPlayingCachedSong()) return false;
+    Command cmd;
+    cmd.type = CMD_SONG_SEEK;
+    cmd.value = std::max<int64_t>(0, frame);
+    return Post(std::move(cmd));
+}
+
+bool AudioEngine::IsPlayingCachedSong() const
+{
+    if (!m_song_request_cached || !IsSongPlaying()) return false;
+    uint32_t processed = m_processed_seq.load(std::memory_order_acquire);
+    if (SeqAfter(m_song_request_seq, processed)) return true;
+    if (m_song_cached_seq.load(std::memory_order_acquire) != m_song_request_seq) return false;
+    // A mute still on its way switches to a shadow player that is in step
+    return !(m_mute_request_mask != 0 && SeqAfter(m_mute_request_seq, processed) && IsShadowing());
+}
+
+bool AudioEngine::ShadowSong(std::shared_ptr<Emu_Player> player, std::shared_ptr<Audio_Stream> stream, int64_t at_frame)
+{
+    if (!player || !stream || !IsPlayingCachedSong()) return false;
+
+    Command cmd;
+    cmd.type = CMD_SONG_SHADOW;
+    cmd.value = at_frame;
+    cmd.stream = std::move(stream);
+    cmd.player = std::move(player);
+    uint32_t seq = m_next_seq;
+    if (!Post(std::move(cmd))) return false;
+    m_shadow_request_seq = seq;
+    return true;
+}
+
+bool AudioEngine::IsShadowing() const
+{
+    if (m_shadow_request_seq == 0) return false;
+    if (SeqAfter(m_shadow_request_seq, m_processed_seq.load(std::memory_order_acquire))) return true;
+    return m_shadow_active_seq.load(std::memory_order_acquire) == m_shadow_request_seq;
+}
+
+bool AudioEngine::HandoverSong(std::shared_ptr<Emu_Player> player, std::shared_ptr<Audio_Stream> stream, int64_t at_frame)
+{
+    if (!player || !stream || m_song_request_seq == 0) return false;
+
+    Command cmd;
+    cmd.type = CMD_SONG_HANDOVER;
+    cmd.value = at_frame;
+    cmd.stream = std::move(stream);
+    cmd.player = std::move(player);
+    if (!Post(std::move(cmd))) return false;
+    m_song_request_cached = false;
+    return true;
+}
+
+bool AudioEngine::StopSong()
+{
+    m_song_request_seq = 0;
+    m_song_request_cached = false;
+    Command cmd;
+    cmd.type = CMD_SONG_STOP;
+    return Post(std::move(cmd));
+}
+
+bool AudioEngine::SetMuteMask(uint32_t mask)
+{
+    Command cmd;
+    cmd.type = CMD_SET_MUTE;
+    cmd.value = mask;
+    uint32_t seq = m_next_seq;
+    if (!Post(std::move(cmd))) return false;
+    m_mute_request_seq = seq;
+    m_mute_request_mask = mask;
+    return true;
+}
+
+bool AudioEngine::IsSongPlaying() const
+{
+    if (m_song_request_seq == 0) return false;
+    // Still waiting for the audio thread to pick it up
+    if (SeqAfter(m_song_request_seq, m_processed_seq.load(std::memory_order_acquire))) return true;
+    return m_song_active_seq.load(std::memory_order_acquire) == m_song_request_seq;
+}
+
+int64_t AudioEngine::GetSongFrame() const
+{
+    return m_song_frame.load(std::memory_order_acquire);
+}
+
+bool AudioEngine::ReadClock(ClockSnapshot& snapshot) const
+{
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        uint32_t before = m_clock_seq.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        snapshot.time_us = m_clock_time_us.load(std::memory_order_relaxed);
+        snapshot.frames = m_clock_frames.load(std::memory_order_relaxed);
+        snapshot.song_start = m_clock_song_start.load(std::memory_order_relaxed);
+        snapshot.song_end = m_clock_song_end.load(std::memory_order_relaxed);
+        snapshot.output_start = m_clock_output_start.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_clock_seq.load(std::memory_order_relaxed) == before) {
+            return snapshot.frames > 0;
+        }
+    }
+    return false;
+}
+
+double AudioEngine::GetOutputLatencyMs() const
+{
+    ClockSnapshot snapshot;
+    double buffer_ms = ReadClock(snapshot) ? snapshot.frames * 1000.0 / GetSampleRate() : 0.0;
+    return buffer_ms + GetVisualOffsetMs();
+}
+
+double AudioEngine::GetAudibleOffset(const ClockSnapshot& snapshot) const
+{
+    // The buffer rendered in the last callback starts playing once the
+    // buffer queued before it has drained, i.e. about one buffer later.
+    double rate = GetSampleRate();
+    double elapsed = (NowMicroseconds() - snapshot.time_us) * rate / 1000000.0;
+    double latency = snapshot.frames + GetVisualOffsetMs() * rate / 1000.0;
+    double offset = (elapsed - latency) / snapshot.frames;
+
+    // Never run ahead of what has been rendered; if the audio thread has
+    // stalled, don't extrapolate backwards indefinitely either.
+    return std::min(1.0, std::max(-4.0, offset));
+}
+
+int64_t AudioEngine::GetAudibleSongFrame() const
+{
+    if (!IsSongPlaying()) return -1;
+    ClockSnapshot snapshot;
+    if (!ReadClock(snapshot)) return -1;
+    double offset = GetAudibleOffset(snapshot);
+    double frame = snapshot.song_start + (snapshot.song_end - snapshot.song_start) * offset;
+    return std::max<int64_t>(0, (int64_t)frame);
+}
+
+int64_t AudioEngine::GetAudibleOutputFrame() const
+{
+    ClockSnapshot snapshot;
+    if (!ReadClock(snapshot)) return -1;
+    double frame = snapshot.output_start + snapshot.frames * GetAudibleOffset(snapshot);
+    return std::max<int64_t>(0, (int64_t)frame);
+}
+
+int AudioEngine::GetAudiblePreviewPosition(uint32_t id) const
+{
+    if (!IsPreviewPlaying(id)) return -1;
+    for (const PreviewStatus& status : m_preview_status) {
+        if (!status.active.load(std::memory_order_acquire) || status.id.load(std::memory_order_relaxed) != id) {
+            continue;
+        }
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            uint32_t before = m_clock_seq.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            ClockSnapshot snapshot;
+            snapshot.time_us = m_clock_time_us.load(std::memory_order_relaxed);
+            snapshot.frames = m_clock_frames.load(std::memory_order_relaxed);
+            int start = status.clock_start.load(std::memory_order_relaxed);
+            int end = status.clock_end.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_clock_seq.load(std::memory_order_relaxed) != before) continue;
+
+            if (start < 0 || end < 0 || snapshot.frames <= 0) return -1;
+            double position = start + (end - start) * GetAudibleOffset(snapshot);
+            return std::max(0, (int)position);
+        }
+        return -1;
+    }
+    return -1;
+}
+
+bool AudioEngine::StartPreview(uint32_t id, std::shared_ptr<Preview_Stream> stream, float gain)
+{
+    if (!stream) return false;
+    stream->setup_stream(GetSampleRate());
+
+    Command cmd;
+    cmd.type = CMD_PREVIEW_START;
+    cmd.id = id;
+    cmd.value = GainToCommand(gain);
+    cmd.preview = std::move(stream);
+    uint32_t seq = m_next_seq;
+    if (!Post(std::move(cmd))) return false;
+    m_preview_requests[id] = seq;
+    return true;
+}
+
+bool AudioEngine::StopPreview(uint32_t id)
+{
+    auto it = m_preview_requests.find(id);
+    if (it == m_preview_requests.end()) return true;
+    m_preview_requests.erase(it);
+
+    Command cmd;
+    cmd.type = CMD_PREVIEW_STOP;
+    cmd.id = id;
+    return Post(std::move(cmd));
+}
+
+bool AudioEngine::StopAllPreviews()
+{
+    std::vector<uint32_t> ids;
+    for (const auto& request : m_preview_requests) ids.push_back(request.first);
+    bool posted = true;
+    for (uint32_t id : ids) posted = StopPreview(id) && posted;
+    return posted;
+}
+
+bool AudioEngine::SetPreviewGain(uint32_t id, float gain)
+{
+    if (m_preview_requests.find(id) == m_preview_requests.end()) return true;
+
+    Command cmd;
+    cmd.type = CMD_PREVIEW_GAIN;
+    cmd.id = id;
+    cmd.value = GainToCommand(gain);
+    return Post(std::move(cmd));
+}
+
+bool AudioEngine::IsPreviewPlaying(uint32_t id) const
+{
+    auto it = m_preview_requests.find(id);
+    if (it == m_preview_requests.end()) return false;
+    uint32_t seq = it->second;
+    if (SeqAfter(seq, m_processed_seq.load(std::memory_order_acquire))) return true;
+
+    for (const PreviewStatus& status : m_preview_status) {
+        if (status.active.load(std::memory_order_acquire) &&
+            status.id.load(std::memory_order_relaxed) == id &&
+            status.seq.load(std::memory_order_relaxed) == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int AudioEngine::GetPreviewPosition(uint32_t id) const
+{
+    if (!IsPreviewPlaying(id)) return -1;
+    for (const PreviewStatus& status : m_preview_status) {
+        if (status.active.load(std::memory_order_acquire) && status.id.load(std::memory_order_relaxed) == id) {
+            return status.position.load(std::memory_order_relaxed);
+        }
+    }
+    return -1;
+}
+
+bool AudioEngine::SetMonitors(std::shared_ptr<MonitorSet> set)
+{
+    if (!set) return false;
+    Command cmd;
+    cmd.type = CMD_MONITORS_SET;
+    cmd.monitors = std::move(set);
+    uint32_t seq = m_next_seq;
+    if (!Post(std::move(cmd))) return false;
+    m_monitor_request_seq = seq;
+    return true;
+}
+
+bool AudioEngine::ClearMonitors()
+{
+    if (m_monitor_request_seq == 0) return true;
+    m_monitor_request_seq = 0;
+    Command cmd;
+    cmd.type = CMD_MONITORS_CLEAR;
+    return Post(std::move(cmd));
+}
+
+bool AudioEngine::IsMonitoring() const
+{
+    if (m_monitor_request_seq == 0) return false;
+    if (SeqAfter(m_monitor_request_seq, m_processed_seq.load(std::memory_order_acquire))) return true;
+    return m_monitor_active_seq.load(std::memory_order_acquire) == m_monitor_request_seq;
+}
+
+void AudioEngine::CollectGarbage()
+{
+    std::shared_ptr<Audio_Stream> stream;
+    while (m_retired.Pop(stream)) {
+        stream.reset();
+    }
+    std::shared_ptr<MonitorSet> monitors;
+    while (m_retired_monitors.Pop(monitors)) {
+        monitors.reset();
+    }
+}
+
+//=====================================================================
+// Audio thread
+//=====================================================================
+
+void AudioEngine::setup_stream(uint32_t sample_rate)
+{
+    m_sample_rate.store(sample_rate, std::memory_order_release);
+}
+
+void AudioEngine::stop_stream()
+{
+}
+
+void AudioEngine::Retire(std::shared_ptr<Audio_Stream>&& stream)
+{
+    if (!stream) return;
+    stream->set_finished(true);
+    // If the UI has stalled long enough to fill the queue, dropping the
+    // reference here is the lesser evil.
+    if (!m_retired.Push(std::move(stream))) {
+        stream.reset();
+    }
+}
+
+void AudioEngine::ProcessCommands()
+{
+    Command cmd;
+    while (m_commands.Pop(cmd)) {
+        switch (cmd.type) {
+        case CMD_SONG_PLAY:
+        case CMD_SONG_PLAY_CACHED:
+            ReplaceSong(cmd);
+            m_song_seq = cmd.seq;
+            m_song_frame.store(cmd.value, std::memory_order_release);
+            // As if the song had been at this position for the whole callback
+            m_callback_song_start = cmd.value - m_callback_done;
+            m_song_active_seq.store(cmd.seq, std::memory_order_release);
+            break;
+
+        case CMD_SONG_STOP:
+            m_song_player.reset();
+            m_song_cached.reset();
+            Retire(std::move(m_song));
+            RetireShadow();
+            m_song_cached_seq.store(0, std::memory_order_release);
+            if (m_handover_pending) {
+                m_handover_pending = false;
+                Retire(std::move(m_handover.stream));
+                m_handover.player.reset();
+            }
+            RetireMonitors();
+            m_song_active_seq.store(0, std::memory_order_release);
+            break;
+
+        case CMD_SONG_SEEK:
+            if (m_song_cached) {
+                // The shadow player can't jump with it
+                RetireShadow();
+                m_song_cached->seek(cmd.value);
+                m_song_frame.store(cmd.value, std::memory_order_release);
+                m_callback_song_start = cmd.value - m_callback_done;
+            }
+            break;
+
+        case CMD_SONG_HANDOVER:
+            if (!m_song) {
+                // Song ended or was stopped before the handover arrived
+                Retire(std::move(cmd.stream));
+                cmd.player.reset();
+                break;
+            }
+            if (m_handover_pending) {
+                Retire(std::move(m_handover.stream));
+                m_handover.player.reset();
+            }
+            m_handover = std::move(cmd);
+            m_handover_pending = true;
+            break;
+
+        case CMD_SONG_SHADOW:
+            RetireShadow();
+            if (!m_song_cached) {
+                // Already switched away from the cached song
+                Retire(std::move(cmd.stream));
+                cmd.player.reset();
+                break;
+            }
+            m_shadow = std::move(cmd.stream);
+            m_shadow_player = std::move(cmd.player);
+            m_shadow_player->set_mute_mask(m_mute_mask);
+            m_shadow_frame = cmd.value;
+            m_shadow_active_seq.store(cmd.seq, std::memory_order_release);
+            break;
+
+        case CMD_SET_MUTE:
+            m_mute_mask = (uint32_t)cmd.value;
+            if (m_song_player) {
+                m_song_player->set_mute_mask(m_mute_mask);
+            }
+            if (m_shadow_player) {
+                m_shadow_player->set_mute_mask(m_mute_mask);
+            }
+            // The cached render is the full mix: switch to the shadow player
+            // now if it is exactly where the song is
+            if (m_mute_mask != 0 && m_song_cached && m_shadow &&
+                m_shadow_frame == m_song_frame.load(std::memory_order_relaxed)) {
+                PromoteShadow();
+            }
+            break;
+
+        case CMD_PREVIEW_START: {
+            // Restart in place if this window already has a voice, else take a free slot
+            int slot = -1;
+            for (int i = 0; i < MAX_PREVIEWS && slot < 0; ++i) {
+                if (m_preview_slots[i].stream && m_preview_slots[i].id == cmd.id) slot = i;
+            }
+            for (int i = 0; i < MAX_PREVIEWS && slot < 0; ++i) {
+                if (!m_preview_slots[i].stream) slot = i;
+            }
+            if (slot < 0) {
+                Retire(std::move(cmd.preview));
+                break;
+            }
+            PreviewSlot& s = m_preview_slots[slot];
+            Retire(std::move(s.stream));
+            s.id = cmd.id;
+            s.seq = cmd.seq;
+            s.gain = GainFromCommand(cmd.value);
+            s.stream = std::move(cmd.preview);
+            m_callback_preview_start[slot] = s.stream->get_position();
+            PublishPreview(slot);
+            break;
+        }
+
+        case CMD_MONITORS_SET:
+            RetireMonitors();
+            m_monitors = std::move(cmd.monitors);
+            m_monitor_started = false;
+            m_monitor_frame = m_monitors->start_frame;
+            m_monitor_active_seq.store(cmd.seq, std::memory_order_release);
+            break;
+
+        case CMD_MONITORS_CLEAR:
+            RetireMonitors();
+            break;
+
+        case CMD_PREVIEW_STOP:
+            for (int i = 0; i < MAX_PREVIEWS; ++i) {
+                if (m_preview_slots[i].stream && m_preview_slots[i].id == cmd.id) {
+                    Retire(std::move(m_preview_slots[i].stream));
+                    PublishPreview(i);
+                }
+            }
+            break;
+
+        case CMD_PREVIEW_GAIN:
+            for (int i = 0; i < MAX_PREVIEWS; ++i) {
+                if (m_preview_slots[i].stream && m_preview_slots[i].id == cmd.id) {
+                    m_preview_slots[i].gain = GainFromCommand(cmd.value);
+                }
+            }
+            break;
+        }
+        m_processed_seq.store(cmd.seq, std::memory_order_release);
+    }
+}
+
+void AudioEngine::RetireMonitors()
+{
+    if (m_monitors && !m_retired_monitors.Push(std::move(m_monitors))) {
+        m_monitors.reset();
+    }
+    m_monitor_active_seq.store(0, std::memory_order_release);
+}
+
+void AudioEngine::CopyMonitors(int64_t song_frame, int count)
+{
+    if (!m_monitors) return;
+
+    MonitorSet& set = *m_monitors;
+    if (!m_monitor_started) {
+        int64_t start = set.start_frame;
+        if (song_frame + count <= start) return;    // Not there yet
+        if (song_frame > start) {                   // Prepared too late
+            RetireMonitors();
+            return;
+        }
+        m_monitor.Reset(start);
+        m_monitor_started = true;
+    } else if (song_frame != m_monitor_frame) {
+        // The song jumped; these players no longer line up with it
+        RetireMonitors();
+        return;
+    }
+    m_monitor_frame = song_frame + count;
+
+    // Points the song clock has now passed that the worker has ready. If it
+    // has fallen behind, the rest are picked up by later blocks.
+    int64_t due = (m_monitor_frame - set.start_frame) / ChannelMonitor::DECIMATION;
+    int64_t consumed = set.consumed.load(std::memory_order_relaxed);
+    int64_t available = std::min(due, set.produced.load(std::memory_order_acquire));
+    int take = (int)std::min<int64_t>(available - consumed, ChannelMonitor::MAX_BLOCK_POINTS);
+    if (take <= 0) return;
+
+    // Up to two pieces where the queue wraps
+    int at = (int)(consumed & (MonitorSet::QUEUE_POINTS - 1));
+    int first = std::min(take, MonitorSet::QUEUE_POINTS - at);
+    for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+        if (!set.streams[ch]) continue;
+        m_monitor.Write(ch, 0, set.queue[ch] + at, first);
+        m_monitor.Write(ch, first, set.queue[ch], take - first);
+    }
+    m_monitor.Advance(take);
+    set.consumed.store(consumed + take, std::memory_order_release);
+}
+
+void AudioEngine::RetireShadow()
+{
+    m_shadow_player.reset();
+    Retire(std::move(m_shadow));
+    m_shadow_active_seq.store(0, std::memory_order_release);
+}
+
+void AudioEngine::PromoteShadow()
+{
+    m_song_cached.reset();
+    Retire(std::move(m_song));
+    m_song = std::move(m_shadow);
+    m_song_player = std::move(m_shadow_player);
+    m_song_cached_seq.store(0, std::memory_order_release);
+    m_shadow_active_seq.store(0, std::memory_order_release);
+    // A handover queued for the cached song would only replace this player
+    if (m_handover_pending) {
+        m_handover_pending = false;
+        Retire(std::move(m_handover.stream));
+        m_handover.player.reset();
+    }
+}
+
+void AudioEngine::AdvanceShadow(int64_t song_frame, int count, int channels)
+{
+    int64_t end = song_frame + count;
+    if (m_shadow_frame < song_frame) {
+        // Behind the song clock (it was sent too late); it can't catch up here
+        RetireShadow();
+        return;
+    }
+    if (m_shadow_frame >= end) return;     // Still waiting for the song to reach it
+
+    // Rendered and thrown away, just to keep it in step
+    int frames = (int)(end - m_shadow_frame);
+    std::memset(m_scratch.data(), 0, sizeof(WAVE_32BS) * frames);
+    m_shadow->get_sample(m_scratch.data(), frames, channels);
+    m_shadow_frame = end;
+}
+
+void AudioEngine::ReplaceSong(Command& cmd)
+{
+    m_song_player.reset();
+    m_song_cached.reset();
+    Retire(std::move(m_song));
+    RetireShadow();
+    m_song = std::move(cmd.stream);
+    m_song_player = std::move(cmd.player);
+    m_song_cached = std::move(cmd.cached);
+    m_song_cached_seq.store(m_song_cached ? cmd.seq : 0, std::memory_order_release);
+    if (m_song_player) {
+        m_song_player->set_mute_mask(m_mute_mask);
+    }
+}
+
+void AudioEngine::PublishPreview(int slot)
+{
+    const PreviewSlot& s = m_preview_slots[slot];
+    PreviewStatus& status = m_preview_status[slot];
+    if (s.stream) {
+        status.id.store(s.id, std::memory_order_relaxed);
+        status.seq.store(s.seq, std::memory_order_relaxed);
+        status.position.store(s.stream->get_position(), std::memory_order_relaxed);
+        status.active.store(true, std::memory_order_release);
+    } else {
+        status.active.store(false, std::memory_order_release);
+    }
+}
+
+void AudioEngine::MixVoice(Audio_Stream& stream, WAVE_32BS* output, int count, int channels, float gain)
+{
+    int done = 0;
+    while (done < count) {
+        int block = std::min(count - done, SCRATCH_FRAMES);
+        std::memset(m_scratch.data(), 0, sizeof(WAVE_32BS) * block);
+        stream.get_sample(m_scratch.data(), block, channels);
+        if (gain == 1.0f) {
+            for (int i = 0; i < block; ++i) {
+                output[done + i].L += m_scratch[i].L;
+                output[done + i].R += m_scratch[i].R;
+            }
+        } else {
+            for (int i = 0; i < block; ++i) {
+                output[done + i].L += (int32_t)std::lrintf(m_scratch[i].L * gain);
+                output[done + i].R += (int32_t)std::lrintf(m_scratch[i].R * gain);
+            }
+        }
+        done += block;
+    }
+}
+
+void AudioEngine::MixSong(WAVE_32BS* output, int count, int channels)
+{
+    int64_t frame = m_song_frame.load(std::memory_order_relaxed);
+    int split = count;
+    if (m_handover_pending) {
+        split = (int)std::max<int64_t>(0, std::min<int64_t>(count, m_handover.value - frame));
+    }
+
+    if (split > 0) {
+        MixVoice(*m_song, output, split, channels);
+    }
+    if (split < count) {
+        // The handed-over player is positioned at m_handover.value; if we are
+        // already past it, it simply starts late.
+        m_handover_pending = false;
+        ReplaceSong(m_handover);
+        MixVoice(*m_song, output + split, count - split, channels);
+    }
+    m_song_frame.store(frame + count, std::memory_order_release);
+}
+
+void AudioEngine::PublishClock(int count, int64_t start_us)
+{
+    uint32_t seq = m_clock_seq.load(std::memory_order_relaxed);
+    m_clock_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_clock_time_us.store(start_us, std::memory_order_relaxed);
+    m_clock_frames.store(count, std::memory_order_relaxed);
+    m_clock_song_start.store(m_callback_song_start, std::memory_order_relaxed);
+    m_clock_song_end.store(m_song_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_clock_output_start.store(m_output_frames - count, std::memory_order_relaxed);
+    for (int i = 0; i < MAX_PREVIEWS; ++i) {
+        const PreviewSlot& slot = m_preview_slots[i];
+        m_preview_status[i].clock_start.store(slot.stream ? m_callback_preview_start[i] : -1, std::memory_order_relaxed);
+        m_preview_status[i].clock_end.store(slot.stream ? slot.stream->get_position() : -1, std::memory_order_relaxed);
+    }
+
+    m_clock_seq.store(seq + 2, std::memory_order_release);
+}
+
+void AudioEngine::UpdateStats(int count, int64_t start_us, int64_t end_us)
+{
+    if (m_stat_reset.exchange(false, std::memory_order_acq_rel)) {
+        m_stat_max_period_us.store(0, std::memory_order_relaxed);
+        m_stat_underruns.store(0, std::memory_order_relaxed);
+        m_stat_overloads.store(0, std::memory_order_relaxed);
+        m_last_callback_us = 0;
+    }
+
+    uint32_t rate = GetSampleRate();
+    int64_t buffer_us = (int64_t)count * 1000000 / rate;
+    int64_t render_us = end_us - start_us;
+    m_stat_callback_frames.store(count, std::memory_order_relaxed);
+    m_stat_render_us.store((m_stat_render_us.load(std::memory_order_relaxed) * 15 + render_us) / 16, std::memory_order_relaxed);
+    if (render_us > buffer_us) {
+        m_stat_overloads.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (m_last_callback_us != 0) {
+        int64_t period = start_us - m_last_callback_us;
+        int64_t average = m_stat_period_us.load(std::memory_order_relaxed);
+        average = average ? (average * 15 + period) / 16 : period;
+        m_stat_period_us.store(average, std::memory_order_relaxed);
+        if (period > m_stat_max_period_us.load(std::memory_order_relaxed)) {
+            m_stat_max_period_us.store(period, std::memory_order_relaxed);
+        }
+        // The driver asks for buffer_us of audio every buffer_us on average;
+        // a much longer gap means the device played out everything it had.
+        if (period > buffer_us * UNDERRUN_FACTOR && period > average * UNDERRUN_FACTOR) {
+            m_stat_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    m_last_callback_us = start_us;
+}
+
+int AudioEngine::get_sample(WAVE_32BS* output, int count, int channels)
+{
+    int64_t start_us = NowMicroseconds();
+
+    m_callback_song_start = m_song_frame.load(std::memory_order_relaxed);
+    for (int i = 0; i < MAX_PREVIEWS; ++i) {
+        m_callback_preview_start[i] = m_preview_slots[i].stream ? m_preview_slots[i].stream->get_position() : -1;
+    }
+
+    // Commands are applied between blocks, so a smaller block size lets
+    // play/stop/mute land part-way into a large driver buffer.
+    int block_frames = m_block_frames.load(std::memory_order_acquire);
+    for (m_callback_done = 0; m_callback_done < count; m_callback_done += block_frames) {
+        RenderBlock(output + m_callback_done, std::min(block_frames, count - m_callback_done), channels);
+    }
+    m_callback_done = 0;
+
+    // Analysis happens on the UI side; all the callback does is copy
+    m_tap.Write(output, count);
+    m_recorder.Write(output, count);
+    m_output_frames += count;
+
+    PublishClock(count, start_us);
+    UpdateStats(count, start_us, NowMicroseconds());
+
+    // The engine itself never finishes; Audio_Manager keeps pulling from it
+    return 1;
+}
+
+void AudioEngine::RenderBlock(WAVE_32BS* output, int count, int channels)
+{
+    ProcessCommands();
+
+    std::memset(output, 0, sizeof(WAVE_32BS) * count);
+
+    if (m_song) {
+        int64_t song_frame = m_song_frame.load(std::memory_order_relaxed);
+        MixSong(output, count, channels);
+        if (m_shadow) {
+            AdvanceShadow(song_frame, count, channels);
+        }
+        CopyMonitors(song_frame, count);
+        if (m_song->get_finished()) {
+            m_song_player.reset();
+            m_song_cached.reset();
+            Retire(std::move(m_song));
+            RetireShadow();
+            m_song_cached_seq.store(0, std::memory_order_release);
+            RetireMonitors();
+            m_song_active_seq.store(0, std::memory_order_release);
+        }
+    }
+
+    for (int i = 0; i < MAX_PREVIEWS; ++i) {
+        PreviewSlot& slot = m_preview_slots[i];
+        if (!slot.stream) continue;
+        if (!slot.stream->mix_block(output, count, slot.gain)) {
+            MixVoice(*slot.stream, output, count, channels, slot.gain);
+        }
+        if (slot.stream->get_finished()) {
+            Retire(std::move(slot.stream));
+        }
+        PublishPreview(i);
+    }
+}
@@ -0,0 +1,313 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "audio_manager.h"
+#include "audio_tap.h"
+#include "channel_monitor.h"
+#include "spsc_queue.h"
+#include "wav_recorder.h"
+
+// Forward declarations
+class Emu_Player;
+class CachedSongStream;
+
+// Audio_Stream that reports a playback position (in source samples) back to the UI
+class Preview_Stream : public Audio_Stream
+{
+public:
+    virtual int get_position() const = 0;
+
+    // Add count frames to output, scaled by gain. Streams that can mix in
+    // place return true; the default returns false and the engine mixes
+    // get_sample() output through its scratch buffer instead.
+    virtual bool mix_block(WAVE_32BS* output, int count, float gain) { return false; }
+};
+
+// Single stream registered with Audio_Manager that owns everything the user
+// hears. The UI thread never touches a playing stream directly: it posts
+// commands through a lock-free queue, the audio callback applies them at the
+// start of the next buffer, and positions come back through atomics.
+//
+// All public methods except Get() are meant for the UI thread only.
+class AudioEngine : public Audio_Stream
+{
+public:
+    static const int MAX_PREVIEWS = 8;
+
+    static AudioEngine& Get();
+
+    // Register the engine with Audio_Manager. Call once after the driver is set.
+    void Start();
+
+    uint32_t GetSampleRate() const;
+
+    // YM2612 native output rate (NTSC master clock / 144)
+    static const uint32_t NATIVE_CHIP_RATE = 53267;
+
+    // When enabled, new song players run at NATIVE_CHIP_RATE and are
+    // resampled once by our polyphase filter instead of libvgm's resampler.
+    void SetNativeRate(bool enabled) { m_native_rate.store(enabled, std::memory_order_release); }
+    bool GetNativeRate() const { return m_native_rate.load(std::memory_order_acquire); }
+
+    // Largest block the engine renders between command checks. Smaller blocks
+    // apply play/stop/mute sooner inside a driver buffer.
+    void SetBlockFrames(int frames);
+
+    // Measured on the audio thread
+    struct Stats {
+        int callback_frames;    // Frames requested by the last driver callback
+        double period_ms;       // Average time between callbacks
+        double max_period_ms;   // Longest gap since the last reset
+        double render_ms;       // Average time spent rendering one callback
+        uint32_t underruns;     // Callbacks that arrived too late to keep the device fed
+        uint32_t overloads;     // Callbacks that took longer to render than they play
+    };
+    Stats GetStats() const;
+    void ResetStats();
+
+    // Wrap a player for output at the engine rate (through the native-rate
+    // resampler when enabled) and set it up. Safe to call from any thread.
+    std::shared_ptr<Audio_Stream> PrepareSong(std::shared_ptr<Emu_Player> player) const;
+
+    // Song playback. A seek is a new player created at the target position;
+    // start_frame is the output frame the new player starts at. stream is the
+    // result of PrepareSong(player), possibly already run ahead.
+    bool PlaySong(std::shared_ptr<Emu_Player> player);
+    bool PlaySong(std::shared_ptr<Emu_Player> player, std::shared_ptr<Audio_Stream> stream, int64_t start_frame);
+    bool StopSong();
+    bool SetMuteMask(uint32_t mask);
+    bool IsSongPlaying() const;
+    int64_t GetSongFrame() const;       // Next frame to be rendered
+
+    // Frame the listener is hearing right now: the song clock as of the last
+    // callback, moved along by the time since then and held back by the
+    // output latency. Use this for anything drawn in time with the audio.
+    // -1 when no song is playing.
+    int64_t GetAudibleSongFrame() const;
+
+    // Extra delay applied to visuals on top of the measured driver buffer,
+    // for drivers that queue more than one buffer (e.g. PulseAudio).
+    void SetVisualOffsetMs(int ms) {
+        m_visual_offset_ms.store(std::min(ms, AudioTap::MAX_VISUAL_OFFSET_MS), std::memory_order_relaxed);
+    }
+    int GetVisualOffsetMs() const { return m_visual_offset_ms.load(std::memory_order_relaxed); }
+    double GetOutputLatencyMs() const;
+
+    // Copy of everything the engine outputs, indexed by output frame, and the
+    // output frame being heard right now (same latency rules as above).
+    const AudioTap& GetTap() const { return m_tap; }
+    int64_t GetAudibleOutputFrame() const;
+
+    // Records exactly what the tap sees (song, previews, live mutes) to WAV.
+    // Start/Stop/Update from the UI thread; the callback only feeds it.
+    WavRecorder& GetRecorder() { return m_recorder; }
+
+    // Play a pre-rendered song. Seeks on it are immediate (no new player).
+    // IsPlayingCachedSong() turns false once the engine has switched to a
+    // live player (handover, or a mute taken over by the shadow player).
+    bool PlayCachedSong(std::shared_ptr<CachedSongStream> stream, int64_t start_frame = 0);
+    bool SeekSong(int64_t frame);
+    bool IsPlayingCachedSong() const;
+
+    // Run a live player silently next to the cached song, from at_frame on
+    // (it must already have been run up to there). A mute that arrives while
+    // it is in step switches to it on the spot, since the cached render can
+    // only play the full mix. Dropped when the cached song stops, seeks or is
+    // replaced, or if the player falls out of step; IsShadowing() then turns
+    // false and the caller can prepare a new one.
+    bool ShadowSong(std::shared_ptr<Emu_Player> player, std::shared_ptr<Audio_Stream> stream, int64_t at_frame);
+    bool IsShadowing() const;
+
+    // Replace the current song with a live player that has already been run
+    // up to at_frame. The swap happens exactly when the song clock reaches
+    // at_frame, so the change is seamless; if that moment has already passed
+    // the player is swapped in at once.
+    bool HandoverSong(std::shared_ptr<Emu_Player> player, std::shared_ptr<Audio_Stream> stream, int64_t at_frame);
+
+    // PCM previews, keyed by the owning window's id. Any number of windows
+    // (up to MAX_PREVIEWS) play at once, each at its own gain.
+    bool StartPreview(uint32_t id, std::shared_ptr<Preview_Stream> stream, float gain = 1.0f);
+    bool StopPreview(uint32_t id);
+    bool StopAllPreviews();
+    bool SetPreviewGain(uint32_t id, float gain);
+    bool IsPreviewPlaying(uint32_t id) const;
+    int GetPreviewPosition(uint32_t id) const;
+    int GetAudiblePreviewPosition(uint32_t id) const;  // Latency-compensated, -1 if none
+
+    // Per-channel monitoring. The points the set's worker renders ahead are
+    // copied into GetMonitor() as the song clock passes them, from
+    // set->start_frame on. The set is dropped whenever the song is stopped or
+    // jumps (seek, restart); IsMonitoring() then turns false and the caller
+    // stops the worker and can prepare a new set.
+    bool SetMonitors(std::shared_ptr<MonitorSet> set);
+    bool ClearMonitors();
+    bool IsMonitoring() const;
+    const ChannelMonitor& GetMonitor() const { return m_monitor; }
+
+    // Release streams the audio thread has finished with. Call once per UI frame
+    // so that no stream is ever destroyed inside the audio callback.
+    void CollectGarbage();
+
+    // Audio_Stream
+    void setup_stream(uint32_t sample_rate) override;
+    int get_sample(WAVE_32BS* output, int count, int channels) override;
+    void stop_stream() override;
+
+    AudioEngine();
+    ~AudioEngine();
+
+private:
+    enum CommandType {
+        CMD_SONG_PLAY,
+        CMD_SONG_STOP,
+        CMD_SONG_PLAY_CACHED,
+        CMD_SONG_SEEK,
+        CMD_SONG_HANDOVER,
+        CMD_SONG_SHADOW,
+        CMD_SET_MUTE,
+        CMD_PREVIEW_START,
+        CMD_PREVIEW_STOP,
+        CMD_PREVIEW_GAIN,
+        CMD_MONITORS_SET,
+        CMD_MONITORS_CLEAR
+    };
+
+    struct Command {
+        CommandType type = CMD_SONG_STOP;
+        uint32_t seq = 0;
+        uint32_t id = 0;
+        int64_t value = 0;
+        std::shared_ptr<Audio_Stream> stream;
+        std::shared_ptr<Emu_Player> player;
+        std::shared_ptr<Preview_Stream> preview;
+        std::shared_ptr<CachedSongStream> cached;
+        std::shared_ptr<MonitorSet> monitors;
+    };
+
+    // Audio-thread state for one preview voice
+    struct PreviewSlot {
+        uint32_t id = 0;
+        uint32_t seq = 0;
+        float gain = 1.0f;
+        std::shared_ptr<Preview_Stream> stream;
+    };
+
+    // Published to the UI thread after every buffer
+    struct PreviewStatus {
+        std::atomic<uint32_t> id{0};
+        std::atomic<uint32_t> seq{0};
+        std::atomic<int> position{-1};
+        std::atomic<bool> active{false};
+        // Positions at the start and end of the last callback (under m_clock_seq)
+        std::atomic<int> clock_start{-1};
+        std::atomic<int> clock_end{-1};
+    };
+
+    // Consistent copy of the last callback's timing
+    struct ClockSnapshot {
+        int64_t time_us;
+        int frames;
+        int64_t song_start;
+        int64_t song_end;
+        int64_t output_start;
+    };
+
+    bool Post(Command&& cmd);
+    void ProcessCommands();
+    void Retire(std::shared_ptr<Audio_Stream>&& stream);
+    void MixVoice(Audio_Stream& stream, WAVE_32BS* output, int count, int channels, float gain = 1.0f);
+    void PublishPreview(int slot);
+    void ReplaceSong(Command& cmd);
+    void MixSong(WAVE_32BS* output, int count, int channels);
+    void RenderBlock(WAVE_32BS* output, int count, int channels);
+    void AdvanceShadow(int64_t song_frame, int count, int channels);
+    void PromoteShadow();
+    void RetireShadow();
+    void UpdateStats(int count, int64_t start_us, int64_t end_us);
+    void PublishClock(int count, int64_t start_us);
+    void CopyMonitors(int64_t song_frame, int count);
+    void RetireMonitors();
+    bool ReadClock(ClockSnapshot& snapshot) const;
+    double GetAudibleOffset(const ClockSnapshot& snapshot) const;
+
+    // UI -> audio
+    SpscQueue<Command, 64> m_commands;
+    // audio -> UI: streams to be destroyed outside the callback
+    SpscQueue<std::shared_ptr<Audio_Stream>, 256> m_retired;
+    SpscQueue<std::shared_ptr<MonitorSet>, 16> m_retired_monitors;
+
+    // Audio thread only
+    std::shared_ptr<Audio_Stream> m_song;
+    std::shared_ptr<Emu_Player> m_song_player;
+    std::shared_ptr<CachedSongStream> m_song_cached;
+    Command m_handover;                 // Pending CMD_SONG_HANDOVER, if any
+    bool m_handover_pending;
+    std::shared_ptr<Audio_Stream> m_shadow;
+    std::shared_ptr<Emu_Player> m_shadow_player;
+    int64_t m_shadow_frame;             // Next song frame the shadow player renders
+    uint32_t m_song_seq;
+    uint32_t m_mute_mask;
+    PreviewSlot m_preview_slots[MAX_PREVIEWS];
+    std::vector<WAVE_32BS> m_scratch;
+
+    int64_t m_last_callback_us;
+    int m_callback_done;                // Frames rendered so far in this callback
+    int64_t m_callback_song_start;      // Song frame at this callback's start
+    int m_callback_preview_start[MAX_PREVIEWS];
+    std::shared_ptr<MonitorSet> m_monitors;
+    bool m_monitor_started;
+    int64_t m_monitor_frame;            // Song frame the monitors have been copied up to
+    ChannelMonitor m_monitor;
+    AudioTap m_tap;
+    WavRecorder m_recorder;
+    int64_t m_output_frames;            // Total frames output since start-up
+
+    // Settings (UI -> audio)
+    std::atomic<bool> m_native_rate;
+    std::atomic<int> m_block_frames;
+    std::atomic<int> m_visual_offset_ms;
+
+    // Return channel
+    std::atomic<uint32_t> m_sample_rate;
+    std::atomic<uint32_t> m_processed_seq;
+    std::atomic<uint32_t> m_song_active_seq;
+    std::atomic<uint32_t> m_song_cached_seq;    // Song seq while the cached stream plays
+    std::atomic<uint32_t> m_shadow_active_seq;
+    std::atomic<int64_t> m_song_frame;
+    std::atomic<uint32_t> m_monitor_active_seq;
+    PreviewStatus m_preview_status[MAX_PREVIEWS];
+    std::atomic<int> m_stat_callback_frames;
+    std::atomic<int64_t> m_stat_period_us;      // Exponential moving averages
+    std::atomic<int64_t> m_stat_max_period_us;
+    std::atomic<int64_t> m_stat_render_us;
+    std::atomic<uint32_t> m_stat_underruns;
+    std::atomic<uint32_t> m_stat_overloads;
+    std::atomic<bool> m_stat_reset;
+
+    // Audio clock, written with a sequence lock (odd while being updated)
+    std::atomic<uint32_t> m_clock_seq;
+    std::atomic<int64_t> m_clock_time_us;
+    std::atomic<int> m_clock_frames;
+    std::atomic<int64_t> m_clock_song_start;
+    std::atomic<int64_t> m_clock_song_end;
+    std::atomic<int64_t> m_clock_output_start;
+
+    // UI thread only
+    uint32_t m_next_seq;
+    uint32_t m_song_request_seq;            // 0 when stopped
+    bool m_song_request_cached;
+    uint32_t m_shadow_request_seq;          // 0 when no shadow player was sent
+    uint32_t m_mute_request_seq;
+    uint32_t m_mute_request_mask;
+    uint32_t m_monitor_request_seq;         // 0 when not monitoring
+    std::map<uint32_t, uint32_t> m_preview_requests;  // id -> seq of the last start
+    bool m_started;
+};
+
+#endif // AUDIO_ENGINE_H
@@ -0,0 +1,682 @@
+#include "audio_file.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include "background_task.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_FILE_SSE2 1
+#endif
+
+// Single-file decoders, compiled into this translation unit when CMake
+// finds them under deps/
+#ifdef HAVE_DR_MP3
+#define DR_MP3_IMPLEMENTATION
+#include "dr_mp3.h"
+#endif
+#ifdef HAVE_DR_FLAC
+#define DR_FLAC_IMPLEMENTATION
+#include "dr_flac.h"
+#endif
+#ifdef HAVE_STB_VORBIS
+#include "stb_vorbis.c"
+#endif
+
+#if !defined(__EMSCRIPTEN__) && (!defined(HAVE_DR_MP3) || !defined(HAVE_DR_FLAC) || !defined(HAVE_STB_VORBIS))
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#define AUDIO_FILE_EXTERNAL 1
+#endif
+
+// WAV data is little-endian, as is every platform the editor builds for, so
+// samples are loaded with memcpy rather than assembled byte by byte.
+
+namespace {
+const uint16_t WAVE_FORMAT_PCM = 1;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+const uint16_t MAX_CHANNELS = 32;
+const uint32_t MAX_SAMPLE_RATE = 1000000;
+
+// The data chunk is converted through a buffer of this size, so loading
+// costs the decoded size plus this rather than the file size on top
+const size_t READ_BLOCK_BYTES = 1 << 20;
+
+// Frames pulled from a compressed decoder per call
+const size_t DECODE_BLOCK_FRAMES = 4096;
+
+// Upper bound on the up-front allocation from a decoder's length estimate
+// (an hour at 48 kHz), so a corrupt header can't demand gigabytes
+const uint64_t MAX_RESERVE_FRAMES = (uint64_t)48000 * 60 * 60;
+
+enum SampleType {
+    SAMPLE_U8,
+    SAMPLE_S16,             // Also 24/32-bit PCM: only their top 16 bits are kept
+    SAMPLE_F32,
+    SAMPLE_F64,
+};
+
+struct Format {
+    SampleType type;
+    int channels;
+    int container_bytes;    // Bytes per sample in the stream
+    int offset;             // Where in the sample the bytes that are kept start
+};
+
+uint16_t ReadU16(const char* p)
+{
+    return (uint16_t)((uint8_t)p[0] | ((uint8_t)p[1] << 8));
+}
+
+uint32_t ReadU32(const char* p)
+{
+    return (uint32_t)ReadU16(p) | ((uint32_t)ReadU16(p + 2) << 16);
+}
+
+inline int32_t LoadS16(const uint8_t* p)
+{
+    int16_t value;
+    memcpy(&value, p, 2);
+    return value;
+}
+
+inline int32_t LoadU8(const uint8_t* p)
+{
+    return ((int32_t)p[0] - 128) * 256;
+}
+
+inline int32_t LoadF32(const uint8_t* p)
+{
+    float value;
+    memcpy(&value, p, 4);
+    // NaN fails both comparisons and becomes silence
+    if (!(value > -1.0f)) return value <= -1.0f ? -32768 : 0;
+    if (!(value < 1.0f)) return 32767;
+    return (int32_t)(value * 32768.0f);
+}
+
+inline int32_t LoadF64(const uint8_t* p)
+{
+    double value;
+    memcpy(&value, p, 8);
+    if (!(value > -1.0)) return value <= -1.0 ? -32768 : 0;
+    if (!(value < 1.0)) return 32767;
+    return (int32_t)(value * 32768.0);
+}
+
+#ifdef AUDIO_FILE_SSE2
+// Sums each adjacent pair of 16-bit lanes into a 32-bit lane and halves it
+// toward zero like the scalar division: add 1 to negative sums first
+inline __m128i AveragePairs(__m128i x)
+{
+    __m128i sum = _mm_madd_epi16(x, _mm_set1_epi16(1));
+    return _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+}
+
+// The loaders below return four consecutive samples as 32-bit lanes holding
+// the same value the scalar Load* gives, and may read up to 16 bytes
+
+// 24-bit: shift the top two bytes of sample j into the top half of lane j
+inline __m128i Load24x4(const uint8_t* p)
+{
+    const __m128i top = _mm_set_epi32(0, 0, 0, (int)0xFFFF0000);
+    __m128i x = _mm_loadu_si128((const __m128i*)p);
+    __m128i lanes = _mm_and_si128(_mm_slli_si128(x, 1), top);
+    lanes = _mm_or_si128(lanes, _mm_and_si128(_mm_slli_si128(x, 2), _mm_slli_si128(top, 4)));
+    lanes = _mm_or_si128(lanes, _mm_and_si128(_mm_slli_si128(x, 3), _mm_slli_si128(top, 8)));
+    lanes = _mm_or_si128(lanes, _mm_and_si128(_mm_slli_si128(x, 4), _mm_slli_si128(top, 12)));
+    return _mm_srai_epi32(lanes, 16);
+}
+
+inline __m128i Load32x4(const uint8_t* p)
+{
+    return _mm_srai_epi32(_mm_loadu_si128((const __m128i*)p), 16);
+}
+
+// Same clamping as LoadF32; the min turns NaN into 32767, so it is masked
+// back to silence afterwards
+inline __m128i LoadF32x4(const uint8_t* p)
+{
+    __m128 value = _mm_loadu_ps((const float*)p);
+    __m128 scaled = _mm_mul_ps(value, _mm_set1_ps(32768.0f));
+    scaled = _mm_max_ps(_mm_min_ps(scaled, _mm_set1_ps(32767.0f)), _mm_set1_ps(-32768.0f));
+    return _mm_and_si128(_mm_cvttps_epi32(scaled), _mm_castps_si128(_mm_cmpord_ps(value, value)));
+}
+
+// Converts 8 frames at a time of mono or stereo data, stopping while the
+// loader's 16-byte reads still stay inside src. Returns the frames done.
+template <__m128i (*Load4)(const uint8_t*), int Bytes>
+size_t ConvertBlocks(const uint8_t* src, size_t frames, int channels, short* out)
+{
+    const size_t samples = frames * channels;
+    const size_t block = 8 * channels;
+    size_t i = 0;
+    for (; (i + block) * Bytes + (16 - 4 * Bytes) <= samples * Bytes; i += block) {
+        const uint8_t* p = src + i * Bytes;
+        // Every value fits 16 bits, so the saturating packs are exact
+        __m128i a = _mm_packs_epi32(Load4(p), Load4(p + 4 * Bytes));
+        if (channels == 1) {
+            _mm_storeu_si128((__m128i*)(out + i), a);
+            continue;
+        }
+        __m128i b = _mm_packs_epi32(Load4(p + 8 * Bytes), Load4(p + 12 * Bytes));
+        _mm_storeu_si128((__m128i*)(out + i / 2), _mm_packs_epi32(AveragePairs(a), AveragePairs(b)));
+    }
+    return i / channels;
+}
+#endif
+
+// The SSE2 kernels for 24/32-bit PCM and float, mono or stereo. Returns
+// how many leading frames were converted; the caller does the rest.
+size_t ConvertVector(const uint8_t* src, size_t frames, const Format& format, short* out)
+{
+#ifdef AUDIO_FILE_SSE2
+    if (format.channels <= 2) {
+        if (format.type == SAMPLE_S16 && format.container_bytes == 3) {
+            return ConvertBlocks<Load24x4, 3>(src, frames, format.channels, out);
+        }
+        if (format.type == SAMPLE_S16 && format.container_bytes == 4) {
+            return ConvertBlocks<Load32x4, 4>(src, frames, format.channels, out);
+        }
+        if (format.type == SAMPLE_F32) {
+            return ConvertBlocks<LoadF32x4, 4>(src, frames, format.channels, out);
+        }
+    }
+#else
+    (void)src; (void)frames; (void)format; (void)out;
+#endif
+    return 0;
+}
+
+// Interleaved stereo 16-bit: (l + r) / 2
+void ConvertStereo16(const uint8_t* src, size_t frames, short* out)
+{
+    size_t i = 0;
+#ifdef AUDIO_FILE_SSE2
+    for (; i + 8 <= frames; i += 8) {
+        __m128i a = AveragePairs(_mm_loadu_si128((const __m128i*)(src + i * 4)));
+        __m128i b = AveragePairs(_mm_loadu_si128((const __m128i*)(src + i * 4 + 16)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+    }
+#endif
+    for (; i < frames; ++i) {
+        out[i] = (short)((LoadS16(src + i * 4) + LoadS16(src + i * 4 + 2)) / 2);
+    }
+}
+
+// Everything else: load each channel, sum and average. Channels is a
+// template argument for the common layouts so the inner loop unrolls.
+template <int32_t (*Load)(const uint8_t*), int Channels>
+void ConvertFrames(const uint8_t* src, size_t frames, const Format& format, short* out)
+{
+    const int channels = Channels > 0 ? Channels : format.channels;
+    const size_t stride = (size_t)channels * format.container_bytes;
+    src += format.offset;
+    for (size_t i = 0; i < frames; ++i, src += stride) {
+        int32_t sum = 0;
+        for (int ch = 0; ch < channels; ++ch) {
+            sum += Load(src + ch * format.container_bytes);
+        }
+        out[i] = (short)(sum / channels);
+    }
+}
+
+template <int32_t (*Load)(const uint8_t*)>
+void ConvertChannels(const uint8_t* src, size_t frames, const Format& format, short* out)
+{
+    switch (format.channels) {
+    case 1: ConvertFrames<Load, 1>(src, frames, format, out); break;
+    case 2: ConvertFrames<Load, 2>(src, frames, format, out); break;
+    default: ConvertFrames<Load, 0>(src, frames, format, out); break;
+    }
+}
+
+// Convert whole frames of src into mono 16-bit
+void Convert(const uint8_t* src, size_t frames, const Format& format, short* out)
+{
+    const size_t done = ConvertVector(src, frames, format, out);
+    src += done * format.channels * format.container_bytes;
+    frames -= done;
+    out += done;
+    switch (format.type) {
+    case SAMPLE_U8:
+        ConvertChannels<LoadU8>(src, frames, format, out);
+        break;
+    case SAMPLE_S16:
+        if (format.container_bytes == 2 && format.channels == 1) {
+            memcpy(out, src, frames * 2);
+        } else if (format.container_bytes == 2 && format.channels == 2) {
+            ConvertStereo16(src, frames, out);
+        } else {
+            ConvertChannels<LoadS16>(src, frames, format, out);
+        }
+        break;
+    case SAMPLE_F32:
+        ConvertChannels<LoadF32>(src, frames, format, out);
+        break;
+    case SAMPLE_F64:
+        ConvertChannels<LoadF64>(src, frames, format, out);
+        break;
+    }
+}
+
+bool ParseFormat(uint16_t tag, int bits, int channels, Format& format, std::string& error)
+{
+    format.channels = channels;
+    format.container_bytes = bits / 8;
+    format.offset = 0;
+    if (tag == WAVE_FORMAT_PCM) {
+        if (bits != 8 && bits != 16 && bits != 24 && bits != 32) {
+            error = "Unsupported bit depth: " + std::to_string(bits);
+            return false;
+        }
+        // 24/32-bit keep their top two bytes, the same as shifting down
+        format.type = bits == 8 ? SAMPLE_U8 : SAMPLE_S16;
+        format.offset = bits == 8 ? 0 : format.container_bytes - 2;
+        return true;
+    }
+    if (tag == WAVE_FORMAT_IEEE_FLOAT) {
+        if (bits != 32 && bits != 64) {
+            error = "Unsupported float bit depth: " + std::to_string(bits);
+            return false;
+        }
+        format.type = bits == 32 ? SAMPLE_F32 : SAMPLE_F64;
+        return true;
+    }
+    error = "Unsupported audio format (PCM and float only): " + std::to_string(tag);
+    return false;
+}
+
+// Where decoded samples go: straight into audio.samples, or a block at a
+// time to options.on_samples. Also reports progress and checks for
+// cancellation after each block.
+class Output {
+public:
+    Output(DecodedAudio& audio, const DecodeOptions& options)
+        : m_audio(audio), m_options(options), m_frames(0), m_total(0) {}
+
+    // total_frames is exact when known up front, otherwise an estimate
+    // (0 if there is none) that is only trusted up to MAX_RESERVE_FRAMES
+    void Begin(int sample_rate, int channels, uint64_t total_frames, bool exact)
+    {
+        m_audio.samples.clear();
+        m_audio.sample_rate = sample_rate;
+        m_audio.channels = channels;
+        m_total = total_frames;
+        if (m_options.on_format) {
+            m_options.on_format(sample_rate, channels, total_frames);
+        }
+        if (!m_options.on_samples) {
+            m_audio.samples.reserve((size_t)(exact ? total_frames : std::min(total_frames, MAX_RESERVE_FRAMES)));
+        }
+    }
+
+    // Room for count samples, valid until the next Commit()
+    short* Claim(size_t count)
+    {
+        if (m_options.on_samples) {
+            m_block.resize(count);
+            return m_block.data();
+        }
+        m_audio.samples.resize(m_frames + count);
+        return m_audio.samples.data() + m_frames;
+    }
+
+    // The first count claimed samples are done. Returns false if cancelled.
+    bool Commit(size_t count)
+    {
+        if (m_options.on_samples) {
+            if (count > 0) m_options.on_samples(m_block.data(), count);
+        } else {
+            m_audio.samples.resize(m_frames + count);
+        }
+        m_frames += count;
+        BackgroundTask* task = m_options.task;
+        if (!task) return true;
+        if (m_total > 0) task->SetProgress((float)std::min(1.0, (double)m_frames / m_total));
+        return !task->IsCancelled();
+    }
+
+    size_t GetFrames() const { return m_frames; }
+
+private:
+    DecodedAudio& m_audio;
+    const DecodeOptions& m_options;
+    std::vector<short> m_block;
+    size_t m_frames;
+    uint64_t m_total;
+};
+
+enum FileType {
+    FILE_WAV,
+    FILE_MP3,
+    FILE_FLAC,
+    FILE_OGG,
+};
+
+FileType DetectFileType(const char* head, size_t size, const std::string& path)
+{
+    if (size >= 4 && memcmp(head, "RIFF", 4) == 0) return FILE_WAV;
+    if (size >= 4 && memcmp(head, "fLaC", 4) == 0) return FILE_FLAC;
+    if (size >= 4 && memcmp(head, "OggS", 4) == 0) return FILE_OGG;
+    // ID3 tag, or a bare MPEG frame sync
+    if (size >= 3 && memcmp(head, "ID3", 3) == 0) return FILE_MP3;
+    if (size >= 2 && (uint8_t)head[0] == 0xFF && ((uint8_t)head[1] & 0xE0) == 0xE0) return FILE_MP3;
+
+    std::string ext;
+    size_t dot_pos = path.find_last_of('.');
+    if (dot_pos != std::string::npos) ext = path.substr(dot_pos + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+    if (ext == "mp3") return FILE_MP3;
+    if (ext == "flac") return FILE_FLAC;
+    if (ext == "ogg") return FILE_OGG;
+    // Anything else gets the WAV decoder's diagnosis
+    return FILE_WAV;
+}
+
+// Pull interleaved 16-bit frames from read(buffer, frames) until it comes
+// up short, downmixing each block into output. total_frames is the
+// decoder's length estimate, 0 if it has none.
+template <class ReadFrames>
+bool DecodeFrames(int channels, int sample_rate, uint64_t total_frames, ReadFrames read,
+                  Output& output, std::string& error)
+{
+    if (channels <= 0 || channels > MAX_CHANNELS || sample_rate <= 0 || (uint32_t)sample_rate > MAX_SAMPLE_RATE) {
+        error = "Invalid audio format (channels or sample rate out of range)";
+        return false;
+    }
+    Format format = { SAMPLE_S16, channels, 2, 0 };
+    std::vector<short> block(DECODE_BLOCK_FRAMES * channels);
+    output.Begin(sample_rate, channels, total_frames, false);
+    while (true) {
+        size_t got = std::min(read(block.data(), DECODE_BLOCK_FRAMES), DECODE_BLOCK_FRAMES);
+        if (got == 0) break;
+        Convert((const uint8_t*)block.data(), got, format, output.Claim(got));
+        if (!output.Commit(got)) {
+            error = "Cancelled";
+            return false;
+        }
+        if (got < DECODE_BLOCK_FRAMES) break;
+    }
+    if (output.GetFrames() == 0) {
+        error = "No audio data found in file";
+        return false;
+    }
+    return true;
+}
+
+#ifdef HAVE_DR_MP3
+bool DecodeMp3(const std::string& path, Output& output, std::string& error)
+{
+    drmp3 mp3;
+    if (!drmp3_init_file(&mp3, path.c_str(), nullptr)) {
+        error = "Not a valid MP3 file";
+        return false;
+    }
+    // MP3 has no reliable length without decoding it, so no estimate
+    bool ok = DecodeFrames(mp3.channels, mp3.sampleRate, 0, [&](short* out, size_t frames) {
+        return (size_t)drmp3_read_pcm_frames_s16(&mp3, frames, out);
+    }, output, error);
+    drmp3_uninit(&mp3);
+    return ok;
+}
+#endif
+
+#ifdef HAVE_DR_FLAC
+bool DecodeFlac(const std::string& path, Output& output, std::string& error)
+{
+    drflac* flac = drflac_open_file(path.c_str(), nullptr);
+    if (!flac) {
+        error = "Not a valid FLAC file";
+        return false;
+    }
+    bool ok = DecodeFrames(flac->channels, flac->sampleRate, flac->totalPCMFrameCount, [&](short* out, size_t frames) {
+        return (size_t)drflac_read_pcm_frames_s16(flac, frames, out);
+    }, output, error);
+    drflac_close(flac);
+    return ok;
+}
+#endif
+
+#ifdef HAVE_STB_VORBIS
+bool DecodeVorbis(const std::string& path, Output& output, std::string& error)
+{
+    int open_error = 0;
+    stb_vorbis* vorbis = stb_vorbis_open_filename(path.c_str(), &open_error, nullptr);
+    if (!vorbis) {
+        error = "Not a valid Ogg Vorbis file";
+        return false;
+    }
+    stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+    bool ok = DecodeFrames(info.channels, (int)info.sample_rate, stb_vorbis_stream_length_in_samples(vorbis),
+        [&](short* out, size_t frames) {
+            int got = stb_vorbis_get_samples_short_interleaved(vorbis, info.channels, out, (int)(frames * info.channels));
+            return (size_t)std::max(0, got);
+        }, output, error);
+    stb_vorbis_close(vorbis);
+    return ok;
+}
+#endif
+
+#if !defined(HAVE_DR_MP3) || !defined(HAVE_DR_FLAC) || !defined(HAVE_STB_VORBIS)
+// A format without a built-in decoder: native builds convert it to a
+// temporary 16-bit WAV with ffmpeg, or sox if that fails, at the source's
+// own rate and channel count, then decode that
+bool DecodeExternal(const std::string& path, const char* name, DecodedAudio& audio, std::string& error,
+                    const DecodeOptions& options)
+{
+#ifdef AUDIO_FILE_EXTERNAL
+    std::error_code ec;
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path(ec);
+    if (ec) {
+        error = "No temporary directory to convert the file in";
+        return false;
+    }
+    const std::string temp_wav = (temp_dir / (std::filesystem::path(path).filename().string() + ".temp.wav")).string();
+
+    std::string cmd = "ffmpeg -i \"" + path + "\" -f wav -acodec pcm_s16le -y \"" + temp_wav + "\" 2>&1";
+    if (system(cmd.c_str()) != 0) {
+        cmd = "sox \"" + path + "\" -b 16 \"" + temp_wav + "\" 2>&1";
+        if (system(cmd.c_str()) != 0) {
+            remove(temp_wav.c_str());
+            error = std::string(name) + " conversion failed. Please install ffmpeg or sox.";
+            return false;
+        }
+    }
+
+    bool ok = false;
+    {
+        std::ifstream file(temp_wav, std::ios::binary);
+        if (file) {
+            ok = DecodeWav(file, audio, error, options);
+        } else {
+            error = "Failed to open converted audio file";
+        }
+    }
+    remove(temp_wav.c_str());
+    return ok;
+#else
+    (void)path; (void)audio; (void)options;
+    error = std::string(name) + " support is not included in this build";
+    return false;
+#endif
+}
+#endif
+} // namespace
+
+bool DecodeWav(std::istream& in, DecodedAudio& audio, std::string& error, const DecodeOptions& options)
+{
+    // Everything below is bounded by the real size, not by header fields
+    std::streamoff start = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff end = in.tellg();
+    in.seekg(start);
+    if (start < 0 || end < start) {
+        error = "Failed to read audio file";
+        return false;
+    }
+    auto remaining = [&]() -> uint64_t {
+        std::streamoff at = in.tellg();
+        return (at < 0 || at > end) ? 0 : (uint64_t)(end - at);
+    };
+
+    char header[12];
+    if (!in.read(header, 12) || memcmp(header, "RIFF", 4) != 0) {
+        error = "Not a valid WAV file (RIFF header missing)";
+        return false;
+    }
+    if (memcmp(header + 8, "WAVE", 4) != 0) {
+        error = "Not a valid WAV file (WAVE header missing)";
+        return false;
+    }
+
+    uint16_t num_channels = 0;
+    uint32_t sample_rate_val = 0;
+    uint16_t bits_per_sample = 0;
+    uint16_t audio_format = 0;
+    bool found_fmt = false;
+
+    while (remaining() >= 8) {
+        char chunk[8];
+        in.read(chunk, 8);
+        uint32_t chunk_size = ReadU32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || chunk_size > remaining()) {
+                error = "Invalid WAV format (bad fmt chunk)";
+                return false;
+            }
+            // 40 bytes is WAVE_FORMAT_EXTENSIBLE's size
+            char fmt[40];
+            uint32_t fmt_bytes = std::min<uint32_t>(chunk_size, sizeof(fmt));
+            in.read(fmt, fmt_bytes);
+            audio_format = ReadU16(fmt);
+            num_channels = ReadU16(fmt + 2);
+            sample_rate_val = ReadU32(fmt + 4);
+            bits_per_sample = ReadU16(fmt + 14);
+            if (audio_format == WAVE_FORMAT_EXTENSIBLE) {
+                if (fmt_bytes < 40) {
+                    error = "Invalid WAV format (bad fmt chunk)";
+                    return false;
+                }
+                // The actual format tag starts the sub-format GUID
+                audio_format = ReadU16(fmt + 24);
+            }
+            in.seekg((chunk_size - fmt_bytes) + (chunk_size & 1), std::ios::cur);
+            found_fmt = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            if (!found_fmt || num_channels == 0 || num_channels > MAX_CHANNELS ||
+                sample_rate_val == 0 || sample_rate_val > MAX_SAMPLE_RATE) {
+                error = "Invalid WAV format (missing format info)";
+                return false;
+            }
+            Format format;
+            if (!ParseFormat(audio_format, bits_per_sample, num_channels, format, error)) {
+                return false;
+            }
+
+            // A data chunk that claims more than the file holds (streaming
+            // writers leave 0xFFFFFFFF) is read up to the end of the file
+            size_t frame_bytes = (size_t)num_channels * format.container_bytes;
+            uint64_t available = std::min<uint64_t>(chunk_size, remaining());
+            size_t frames = (size_t)(available / frame_bytes);
+            if (frames == 0) break;
+
+            // One allocation for the output; the source goes through a
+            // fixed-size block in whole frames
+            Output output(audio, options);
+            output.Begin((int)sample_rate_val, num_channels, frames, true);
+            size_t block_frames = std::max<size_t>(1, READ_BLOCK_BYTES / frame_bytes);
+            std::vector<uint8_t> block(std::min(frames, block_frames) * frame_bytes);
+            while (output.GetFrames() < frames) {
+                size_t count = std::min(block_frames, frames - output.GetFrames());
+                in.read((char*)block.data(), (std::streamsize)(count * frame_bytes));
+                size_t got = (size_t)in.gcount() / frame_bytes;
+                Convert(block.data(), got, format, output.Claim(got));
+                if (!output.Commit(got)) {
+                    error = "Cancelled";
+                    return false;
+                }
+                if (got < count) break;
+            }
+            if (output.GetFrames() == 0) break;
+            return true;
+        }
+        else {
+            if (chunk_size > remaining()) break;
+            in.seekg(chunk_size + (chunk_size & 1), std::ios::cur);
+        }
+    }
+
+    error = "No audio data found in WAV file";
+    return false;
+}
+
+bool DecodeAudioFile(const std::string& path, DecodedAudio& audio, std::string& error, const DecodeOptions& options)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "Failed to open audio file";
+        return false;
+    }
+    char head[4] = {};
+    file.read(head, sizeof(head));
+    size_t head_size = (size_t)file.gcount();
+    file.clear();
+    file.seekg(0);
+
+    switch (DetectFileType(head, head_size, path)) {
+    case FILE_MP3: {
+#ifdef HAVE_DR_MP3
+        Output output(audio, options);
+        return DecodeMp3(path, output, error);
+#else
+        return DecodeExternal(path, "MP3", audio, error, options);
+#endif
+    }
+    case FILE_FLAC: {
+#ifdef HAVE_DR_FLAC
+        Output output(audio, options);
+        return DecodeFlac(path, output, error);
+#else
+        return DecodeExternal(path, "FLAC", audio, error, options);
+#endif
+    }
+    case FILE_OGG: {
+#ifdef HAVE_STB_VORBIS
+        Output output(audio, options);
+        return DecodeVorbis(path, output, error);
+#else
+        return DecodeExternal(path, "Ogg Vorbis", audio, error, options);
+#endif
+    }
+    case FILE_WAV:
+    default:
+        return DecodeWav(file, audio, error, options);
+    }
+}
+
+const char* GetAudioFileFilter()
+{
+#ifdef AUDIO_FILE_EXTERNAL
+    // Whatever isn't built in can still go through ffmpeg or sox
+    return ".wav;.mp3;.flac;.ogg";
+#else
+    return ".wav"
+#ifdef HAVE_DR_MP3
+        ";.mp3"
+#endif
+#ifdef HAVE_DR_FLAC
+        ";.flac"
+#endif
+#ifdef HAVE_STB_VORBIS
+        ";.ogg"
+#endif
+        ;
+#endif
+}
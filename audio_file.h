@@ -0,0 +1,54 @@
+#ifndef AUDIO_FILE_H
+#define AUDIO_FILE_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Audio as the PCM tool works on it: one channel of 16-bit samples (sources
+// with more channels are averaged down) at the source's rate.
+struct DecodedAudio {
+    std::vector<short> samples;
+    int sample_rate = 0;
+    int channels = 0;       // Of the source, before the downmix
+};
+
+class BackgroundTask;
+
+// Optional hooks for decoding on a worker thread. With a task, progress is
+// reported to it and cancelling it stops the decode ("Cancelled"). With
+// on_samples, each decoded block is handed over as soon as it is ready
+// instead of collecting in audio.samples, so the caller can show a file as
+// it loads; on_format is called once before the first block. total_frames
+// is exact for WAV and an estimate (0 if unknown) for compressed formats.
+struct DecodeOptions {
+    BackgroundTask* task = nullptr;
+    std::function<void(int sample_rate, int channels, uint64_t total_frames)> on_format;
+    std::function<void(const short* samples, size_t count)> on_samples;
+};
+
+// Decode an uncompressed WAV: 8/16/24/32-bit PCM or 32/64-bit float, plain
+// or WAVE_FORMAT_EXTENSIBLE. The data chunk is read in large blocks and
+// converted straight into the output, which is allocated once. Chunk sizes
+// are checked against what is actually in the stream, so truncated or lying
+// headers produce an error or a shorter result, never an out-of-bounds read
+// or a loop that runs past the end. On failure error is set to a message for
+// the status bar.
+bool DecodeWav(std::istream& in, DecodedAudio& audio, std::string& error,
+               const DecodeOptions& options = DecodeOptions());
+
+// Decode any file the PCM tool can load: WAV, MP3, FLAC or Ogg Vorbis. The
+// format comes from the file's signature, or its extension if that is
+// inconclusive. Compressed formats are decoded in-process, straight into
+// the output, when their decoder was found at configure time (HAVE_DR_MP3,
+// HAVE_DR_FLAC, HAVE_STB_VORBIS). Otherwise native builds convert them
+// through ffmpeg or sox and WASM builds report that the format is missing.
+bool DecodeAudioFile(const std::string& path, DecodedAudio& audio, std::string& error,
+                     const DecodeOptions& options = DecodeOptions());
+
+// File dialog filter listing the extensions DecodeAudioFile accepts
+const char* GetAudioFileFilter();
+
+#endif // AUDIO_FILE_H
@@ -0,0 +1,157 @@
+#include "audio_settings_window.h"
+#include <imgui.h>
+#include <cstdio>
+#include "audio_engine.h"
+#include "chip_cores.h"
+#include "config.h"
+
+namespace {
+const int SAMPLE_RATES[] = { 22050, 32000, 44100, 48000, 88200, 96000 };
+const int SAMPLE_RATE_COUNT = sizeof(SAMPLE_RATES) / sizeof(SAMPLE_RATES[0]);
+
+const int BUFFER_SIZES[] = { 64, 128, 256, 512, 1024, 2048, 4096 };
+const int BUFFER_SIZE_COUNT = sizeof(BUFFER_SIZES) / sizeof(BUFFER_SIZES[0]);
+}
+
+AudioSettingsWindow::AudioSettingsWindow()
+    : m_rate_change_pending(false), m_core_change_pending(false), m_open(false), m_request_focus(false)
+{
+    UserConfig cfg = LoadUserConfig();
+    m_sample_rate = cfg.audioSampleRate;
+    m_buffer_frames = cfg.audioBufferFrames;
+    m_native_rate = cfg.audioNativeRate;
+    m_visual_offset_ms = cfg.audioVisualOffsetMs;
+    m_ym2612_core = ChipCores::FromConfigKey(cfg.audioYm2612Core);
+}
+
+bool AudioSettingsWindow::ConsumeRateChange(int& sample_rate)
+{
+    if (!m_rate_change_pending) return false;
+    m_rate_change_pending = false;
+    sample_rate = m_sample_rate;
+    return true;
+}
+
+bool AudioSettingsWindow::ConsumeCoreChange()
+{
+    if (!m_core_change_pending) return false;
+    m_core_change_pending = false;
+    return true;
+}
+
+void AudioSettingsWindow::Save()
+{
+    // Keep the other settings that live in the same file
+    UserConfig cfg = LoadUserConfig();
+    cfg.audioSampleRate = m_sample_rate;
+    cfg.audioBufferFrames = m_buffer_frames;
+    cfg.audioNativeRate = m_native_rate;
+    cfg.audioVisualOffsetMs = m_visual_offset_ms;
+    cfg.audioYm2612Core = ChipCores::GetConfigKey((ChipCores::Ym2612Core)m_ym2612_core);
+    SaveUserConfig(cfg);
+}
+
+void AudioSettingsWindow::Render()
+{
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(420, 300), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("Audio Settings", &m_open)) {
+        AudioEngine& engine = AudioEngine::Get();
+        char label[32];
+
+        snprintf(label, sizeof(label), "%d Hz", m_sample_rate);
+        if (ImGui::BeginCombo("Output rate", label)) {
+            for (int i = 0; i < SAMPLE_RATE_COUNT; ++i) {
+                snprintf(label, sizeof(label), "%d Hz", SAMPLE_RATES[i]);
+                if (ImGui::Selectable(label, SAMPLE_RATES[i] == m_sample_rate) && SAMPLE_RATES[i] != m_sample_rate) {
+                    m_sample_rate = SAMPLE_RATES[i];
+                    m_rate_change_pending = true;
+                    Save();
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        snprintf(label, sizeof(label), "%d frames", m_buffer_frames);
+        if (ImGui::BeginCombo("Block size", label)) {
+            for (int i = 0; i < BUFFER_SIZE_COUNT; ++i) {
+                snprintf(label, sizeof(label), "%d frames", BUFFER_SIZES[i]);
+                if (ImGui::Selectable(label, BUFFER_SIZES[i] == m_buffer_frames)) {
+                    m_buffer_frames = BUFFER_SIZES[i];
+                    engine.SetBlockFrames(m_buffer_frames);
+                    Save();
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("How often, within each driver buffer, play/stop/mute\ncommands are picked up by the audio thread.");
+        }
+
+        if (ImGui::Checkbox("Native chip rate", &m_native_rate)) {
+            engine.SetNativeRate(m_native_rate);
+            Save();
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Run the emulator at the YM2612's own %u Hz and resample\nonce with a polyphase filter. Applies from the next Play.",
+                              AudioEngine::NATIVE_CHIP_RATE);
+        }
+
+        ChipCores::Ym2612Core selected = (ChipCores::Ym2612Core)m_ym2612_core;
+        if (ImGui::BeginCombo("YM2612 core", ChipCores::GetName(selected))) {
+            for (int i = 0; i < ChipCores::YM2612_CORE_COUNT; ++i) {
+                ChipCores::Ym2612Core core = (ChipCores::Ym2612Core)i;
+                if (ImGui::Selectable(ChipCores::GetName(core), i == m_ym2612_core) && i != m_ym2612_core) {
+                    m_ym2612_core = i;
+                    ChipCores::SetYm2612Core(core);
+                    m_core_change_pending = true;
+                    Save();
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", ChipCores::GetDescription(core));
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        ImGui::Separator();
+
+        AudioEngine::Stats stats = engine.GetStats();
+        double rate = engine.GetSampleRate();
+        ImGui::Text("Device rate:     %u Hz", engine.GetSampleRate());
+        ImGui::Text("Driver buffer:   %d frames (%.1f ms)", stats.callback_frames,
+                    stats.callback_frames * 1000.0 / rate);
+        ImGui::Text("Callback period: %.1f ms avg, %.1f ms max", stats.period_ms, stats.max_period_ms);
+        ImGui::Text("Render time:     %.2f ms per callback", stats.render_ms);
+        if (stats.underruns > 0) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "Underruns:       %u", stats.underruns);
+        } else {
+            ImGui::Text("Underruns:       0");
+        }
+        ImGui::Text("Overloads:       %u", stats.overloads);
+        if (ImGui::Button("Reset counters")) {
+            engine.ResetStats();
+        }
+
+        ImGui::Separator();
+        if (ImGui::SliderInt("Visual offset", &m_visual_offset_ms, -200, AudioTap::MAX_VISUAL_OFFSET_MS, "%d ms")) {
+            engine.SetVisualOffsetMs(m_visual_offset_ms);
+        }
+        if (ImGui::IsItemDeactivatedAfterEdit()) {
+            Save();
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Cursors and meters are delayed by one driver buffer plus this offset.\n"
+                              "Raise it if visuals still lead the audio (e.g. PulseAudio with deep queues).");
+        }
+        ImGui::Text("Visual latency:  %.1f ms", engine.GetOutputLatencyMs());
+    }
+    ImGui::End();
+}
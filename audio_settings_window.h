@@ -0,0 +1,40 @@
+#ifndef AUDIO_SETTINGS_WINDOW_H
+#define AUDIO_SETTINGS_WINDOW_H
+
+// Output sample rate, engine block size, native-rate chip rendering and the
+// YM2612 emulator core, plus live latency/underrun figures from the audio
+// engine.
+class AudioSettingsWindow {
+public:
+    AudioSettingsWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+    // True once after the user changed the output rate. Playback has to be
+    // stopped and the driver reopened, which the Editor does.
+    bool ConsumeRateChange(int& sample_rate);
+
+    // True once after the user picked another YM2612 core. Only players set
+    // up afterwards use it, so the Editor restarts playback.
+    bool ConsumeCoreChange();
+
+private:
+    void Save();
+
+    int m_sample_rate;
+    int m_buffer_frames;
+    bool m_native_rate;
+    int m_visual_offset_ms;
+
+    int m_ym2612_core;
+
+    bool m_rate_change_pending;
+    bool m_core_change_pending;
+
+    bool m_open;
+    bool m_request_focus;
+};
+
+#endif // AUDIO_SETTINGS_WINDOW_H
@@ -0,0 +1,83 @@
+#ifndef AUDIO_TAP_H
+#define AUDIO_TAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "audio_manager.h"
+
+// Ring buffer copy of the engine's final output. The audio thread only
+// memcpys each buffer in and advances a counter; readers copy whatever
+// window they need and afterwards check that the writer did not lap them.
+class AudioTap {
+public:
+    // Largest piece published at once. Write() splits longer buffers, so a
+    // piece being copied in never reaches further than this past the
+    // published count, and readers can allow for it.
+    static const int MAX_BLOCK = 4096;
+
+    // Readers fetch windows ending at the audible frame, which trails the
+    // written count by the driver buffer plus the visual offset. The ring
+    // holds the worst case of both at the highest output rate, plus the
+    // largest window and the block in flight.
+    static const int MAX_RATE = 96000;
+    static const int MAX_VISUAL_OFFSET_MS = 500;
+    static const int MAX_DRIVER_FRAMES = 16384;
+    static const int MAX_WINDOW = 8192;     // Largest spectrum FFT
+    static const int CAPACITY = 131072;     // Frames, power of two
+    static const int MAX_READ = CAPACITY - MAX_BLOCK;
+    static_assert((int64_t)MAX_RATE * MAX_VISUAL_OFFSET_MS / 1000 + MAX_DRIVER_FRAMES + MAX_WINDOW + MAX_BLOCK <= CAPACITY,
+                  "tap ring too small for the largest window at the largest latency");
+
+    AudioTap() : m_written(0) {
+        std::memset(m_frames, 0, sizeof(m_frames));
+    }
+
+    AudioTap(const AudioTap&) = delete;
+    AudioTap& operator=(const AudioTap&) = delete;
+
+    // Audio thread
+    void Write(const WAVE_32BS* frames, int count) {
+        int64_t written = m_written.load(std::memory_order_relaxed);
+        if (count > CAPACITY) {
+            frames += count - CAPACITY;
+            written += count - CAPACITY;
+            count = CAPACITY;
+        }
+        while (count > 0) {
+            int block = std::min(count, MAX_BLOCK);
+            int start = (int)(written & (CAPACITY - 1));
+            int first = std::min(block, CAPACITY - start);
+            std::memcpy(m_frames + start, frames, sizeof(WAVE_32BS) * first);
+            std::memcpy(m_frames, frames + first, sizeof(WAVE_32BS) * (block - first));
+            written += block;
+            m_written.store(written, std::memory_order_release);
+            frames += block;
+            count -= block;
+        }
+    }
+
+    // Total frames written since start-up
+    int64_t GetWritten() const { return m_written.load(std::memory_order_acquire); }
+
+    // Copy the count frames (at most MAX_READ) ending at output frame end into
+    // out. Returns false if any of them are not in the ring: not yet written,
+    // or overwritten while copying, counting the piece the writer may be
+    // copying in past the published count.
+    bool Read(int64_t end, WAVE_32BS* out, int count) const {
+        int64_t first = end - count;
+        if (count > MAX_READ || first < 0 || end > GetWritten()) return false;
+        int start = (int)(first & (CAPACITY - 1));
+        int part = std::min(count, CAPACITY - start);
+        std::memcpy(out, m_frames + start, sizeof(WAVE_32BS) * part);
+        std::memcpy(out + part, m_frames, sizeof(WAVE_32BS) * (count - part));
+        return GetWritten() + MAX_BLOCK - first <= CAPACITY;
+    }
+
+private:
+    WAVE_32BS m_frames[CAPACITY];
+    std::atomic<int64_t> m_written;
+};
+
+#endif // AUDIO_TAP_H
@@ -0,0 +1,61 @@
+#ifndef BACKGROUND_TASK_H
+#define BACKGROUND_TASK_H
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// One job at a time on a worker thread, with cooperative cancellation and a
+// progress value the UI can poll. Emscripten builds have no pthreads, so
+// there the job simply runs to completion inside Start().
+class BackgroundTask {
+public:
+    typedef std::function<void(BackgroundTask& task)> Job;
+
+    BackgroundTask() : m_cancel(false), m_running(false), m_progress(0.0f) {}
+    ~BackgroundTask() { Cancel(); Join(); }
+
+    BackgroundTask(const BackgroundTask&) = delete;
+    BackgroundTask& operator=(const BackgroundTask&) = delete;
+
+    // Cancels and waits for any previous job before starting the new one.
+    void Start(Job job) {
+        Cancel();
+        Join();
+        m_cancel = false;
+        m_progress = 0.0f;
+        m_running = true;
+#ifdef __EMSCRIPTEN__
+        Run(job);
+#else
+        m_thread = std::thread([this, job]() { Run(job); });
+#endif
+    }
+
+    void Cancel() { m_cancel = true; }
+    void Join() {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    bool IsRunning() const { return m_running; }
+    float GetProgress() const { return m_progress; }
+
+    // For use inside the job
+    bool IsCancelled() const { return m_cancel; }
+    void SetProgress(float progress) { m_progress = progress; }
+
+private:
+    void Run(const Job& job) {
+        job(*this);
+        m_running = false;
+    }
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel;
+    std::atomic<bool> m_running;
+    std::atomic<float> m_progress;
+};
+
+#endif // BACKGROUND_TASK_H
@@ -0,0 +1,377 @@
+// Micro-benchmarks for the editor's hot paths. Built with
+// -DMDSDRV_EDITOR_BUILD_BENCH=ON; `cmake --build . --target bench` runs it and
+// writes bench.json in the build directory.
+//
+//   mdsdrv_bench [--scale N] [--reps N] [--filter text] [--out file.json]
+//
+// Inputs are generated from a fixed seed, so a given scale always measures
+// the same documents, WAV files and songs. --scale multiplies their size.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_common.h"
+#include "core_benchmark.h"
+#include "pattern_editor.h"
+#include "pcm_preview_stream.h"
+#include "pcm_tool_window.h"
+#include "platform/mdsdrv.h"
+#include "riff.h"
+#include "song.h"
+#include "zero_crossing.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+const uint32_t SEED = 0x6d647364;   // "mdsd"
+const int JSON_SCHEMA = 1;
+
+struct Options {
+    int scale = 1;
+    int reps = 5;
+    std::string filter;
+    std::string out;
+};
+
+struct Result {
+    std::string name;
+    std::string variant;
+    int64_t bytes;                  // Input size per iteration, 0 if not meaningful
+    std::vector<double> ms;         // One entry per timed iteration
+};
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc) {
+            options.scale = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--reps" && i + 1 < argc) {
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.out = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+// Friend of PatternEditor and PCMToolWindow, so the private hot paths can be
+// timed as the UI calls them.
+class HotPathBench {
+public:
+    explicit HotPathBench(const Options& options)
+        : m_options(options), m_failed(false)
+    {
+        m_dir = fs::temp_directory_path() / ("mdsdrv-bench-" + std::to_string(SEED));
+        fs::create_directories(m_dir);
+    }
+
+    ~HotPathBench()
+    {
+        std::error_code ec;
+        fs::remove_all(m_dir, ec);
+    }
+
+    void ScanForPatterns()
+    {
+        for (size_t kib : { (size_t)64, (size_t)1024 }) {
+            std::string text = GenerateDocument(kib * 1024 * m_options.scale, 60, SEED);
+            PatternEditor editor;
+            size_t found = 0;
+            Run("scan_for_patterns", SizeLabel(text.size()), text.size(), nullptr, [&]() {
+                found = editor.ScanForPatterns(text).size();
+            });
+            if (found != 60) Fail("scan_for_patterns found " + std::to_string(found) + " of 60 patterns");
+        }
+    }
+
+    void ApplyPatternChanges()
+    {
+        std::string text = GenerateDocument((size_t)256 * 1024 * m_options.scale, 60, SEED);
+        PatternEditor editor;
+        // Existing macro: in-place line replacement
+        // Missing macro: rescans the document to find where to insert it
+        for (int macro : { 730, 761 }) {
+            Run("apply_pattern_changes", std::string(macro == 730 ? "replace, " : "insert, ") + SizeLabel(text.size()),
+                text.size(),
+                [&]() {
+                    editor.m_editor_text = text;
+                    editor.m_modified_editor_text = text;
+                    editor.m_selected_pattern_macro = macro;
+                    editor.m_pattern_name = "bench";
+                    editor.m_mml_output = "@2 o4 l8 c d e f | g a b > c";
+                },
+                [&]() { editor.ApplyPatternChanges(); });
+            if (editor.m_editor_text.find("*" + std::to_string(macro) + " @2 o4 l8 c d e f | g a b > c; bench") == std::string::npos) {
+                Fail("apply_pattern_changes did not write *" + std::to_string(macro));
+            }
+        }
+    }
+
+    void LoadFile()
+    {
+        const int rate = 44100;
+        std::vector<int32_t> signal = GenerateSignal(rate, (int64_t)30 * rate * m_options.scale, SEED);
+        for (int bits : { 8, 16, 24, 32 }) {
+            fs::path path = m_dir / ("load_" + std::to_string(bits) + ".wav");
+            int64_t bytes = WriteWav(path, signal, rate, bits);
+            PCMToolWindow window;
+            std::string filename = path.string();
+            Run("pcm_load_file", std::to_string(bits) + "-bit stereo, " + SizeLabel(bytes), bytes, nullptr,
+                [&]() { window.LoadFile(filename.c_str()); });
+            if (window.m_status_message.compare(0, 6, "Loaded") != 0 || window.m_pcm_data.size() != signal.size() / 2) {
+                Fail("pcm_load_file " + std::to_string(bits) + "-bit: " + window.m_status_message);
+            }
+        }
+    }
+
+    void ResampleAndSave()
+    {
+        struct Case { int rate; bool double_speed; ResampleQuality quality; };
+        for (Case c : { Case{ 44100, false, ResampleQuality::Normal }, Case{ 32000, false, ResampleQuality::Normal },
+                        Case{ 44100, true, ResampleQuality::Normal }, Case{ 48000, false, ResampleQuality::High } }) {
+            std::vector<int32_t> signal = GenerateSignal(c.rate, (int64_t)60 * c.rate * m_options.scale, SEED);
+            PCMToolWindow window;
+            std::vector<short> samples(signal.size() / 2);
+            for (size_t i = 0; i < samples.size(); ++i) samples[i] = (short)(signal[i * 2] >> 16);
+            window.m_pcm_data = SampleBuffer(std::move(samples));
+            window.m_sample_rate = c.rate;
+            window.m_channels = 1;
+            std::string filename = (m_dir / "resampled.wav").string();
+            char variant[64];
+            snprintf(variant, sizeof(variant), "%d->17500%s %s, %d s", c.rate, c.double_speed ? " x2" : "",
+                     GetResampleQualityName(c.quality), 60 * m_options.scale);
+            Run("pcm_resample_and_save", variant, (int64_t)window.m_pcm_data.size() * 2,
+                [&]() {
+                    window.m_start_point = 0;
+                    window.m_end_point = (int)window.m_pcm_data.size();
+                    window.m_double_speed = c.double_speed;
+                    window.m_resample_quality = c.quality;
+                },
+                [&]() { window.ResampleAndSave(filename.c_str()); });
+            if (window.m_status_message.compare(0, 8, "Exported") != 0) {
+                Fail("pcm_resample_and_save: " + window.m_status_message);
+            }
+        }
+    }
+
+    // Four looping previews at different rates and gains, mixed the way the
+    // engine's callback does it: 10 s of 44.1 kHz output in 512-frame blocks
+    void PreviewMix()
+    {
+        const int rate = 44100;
+        const int blocks = 10 * rate / 512 * m_options.scale;
+        std::vector<int32_t> signal = GenerateSignal(rate, (int64_t)30 * rate, SEED);
+        std::vector<short> samples(signal.size() / 2);
+        for (size_t i = 0; i < samples.size(); ++i) samples[i] = (short)(signal[i * 2] >> 16);
+        SampleBuffer buffer(std::move(samples));
+
+        std::vector<std::shared_ptr<PCM_Preview_Stream>> streams;
+        std::vector<WAVE_32BS> output(512);
+        Run("pcm_preview_mix", "4 voices, " + std::to_string(10 * m_options.scale) + " s", 0,
+            [&]() {
+                streams.clear();
+                for (int source_rate : { 17500, 22050, 44100, 48000 }) {
+                    streams.push_back(std::make_shared<PCM_Preview_Stream>(buffer, 0, (int)buffer.size(), source_rate, true));
+                    streams.back()->setup_stream(rate);
+                }
+            },
+            [&]() {
+                for (int block = 0; block < blocks; ++block) {
+                    std::fill(output.begin(), output.end(), WAVE_32BS{ 0, 0 });
+                    for (size_t v = 0; v < streams.size(); ++v) {
+                        streams[v]->mix_block(output.data(), (int)output.size(), 0.25f * (v + 1));
+                    }
+                }
+            });
+    }
+
+    // Handle drags with zero-crossing snapping on a 5-minute file: one
+    // search per mouse move at the largest radius, over the generated
+    // signal and over a DC offset with no crossing to find
+    void ZeroCrossingSnap()
+    {
+        const int rate = 44100;
+        const int moves = 10000 * m_options.scale;
+        std::vector<int32_t> signal = GenerateSignal(rate, (int64_t)300 * rate, SEED);
+        std::vector<short> samples(signal.size() / 2);
+        for (size_t i = 0; i < samples.size(); ++i) samples[i] = (short)(signal[i * 2] >> 16);
+        std::vector<short> silence(samples.size(), 64);
+
+        for (const std::vector<short>* data : { &samples, &silence }) {
+            size_t checksum = 0;
+            Run("pcm_zero_crossing_snap", std::string(data == &samples ? "signal" : "no crossings") + ", " +
+                std::to_string(moves) + " moves", 0, nullptr,
+                [&]() {
+                    size_t step = data->size() / moves;
+                    for (int move = 0; move < moves; ++move) {
+                        checksum += FindZeroCrossing(data->data(), data->size(), move * step, MAX_ZERO_CROSSING_RADIUS);
+                    }
+                });
+            if (checksum == 0) Fail("pcm_zero_crossing_snap: no positions returned");
+        }
+    }
+
+    void Linker()
+    {
+        const int count = 16 * m_options.scale;
+        std::vector<std::shared_ptr<Song>> songs;
+        for (int i = 0; i < count; ++i) {
+            std::string error;
+            std::shared_ptr<Song> song = CompileBenchmarkSong(GenerateSong(i, SEED), error);
+            if (!song) {
+                Fail("mdsdrv_linker: song " + std::to_string(i) + ": " + error);
+                return;
+            }
+            songs.push_back(song);
+        }
+
+        std::vector<RIFF> mds;
+        Run("mdsdrv_convert", std::to_string(count) + " songs", 0, nullptr, [&]() {
+            mds.clear();
+            for (auto& song : songs) {
+                MDSDRV_Converter converter(*song);
+                mds.push_back(converter.get_mds());
+            }
+        });
+
+        size_t seq_bytes = 0;
+        std::vector<RIFF> inputs;
+        Run("mdsdrv_linker", std::to_string(count) + " songs", 0,
+            [&]() { inputs = mds; },
+            [&]() {
+                MDSDRV_Linker linker;
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    linker.add_song(inputs[i], "song" + std::to_string(i));
+                }
+                seq_bytes = linker.get_seq_data().size() + linker.get_pcm_data().size();
+            });
+        if (seq_bytes == 0) Fail("mdsdrv_linker produced no data");
+    }
+
+    bool Failed() const { return m_failed; }
+
+    void PrintSummary() const
+    {
+        for (const Result& result : m_results) {
+            std::vector<double> ms = result.ms;
+            std::sort(ms.begin(), ms.end());
+            fprintf(stderr, "%-24s %-32s %10.3f ms (min %.3f)\n", result.name.c_str(), result.variant.c_str(),
+                    ms[ms.size() / 2], ms.front());
+        }
+    }
+
+    std::string ToJson() const
+    {
+        std::ostringstream out;
+        out << "{\n  \"schema\": " << JSON_SCHEMA << ",\n  \"scale\": " << m_options.scale
+            << ",\n  \"repetitions\": " << m_options.reps << ",\n  \"seed\": " << SEED
+#ifdef NDEBUG
+            << ",\n  \"optimized\": true"
+#else
+            << ",\n  \"optimized\": false"
+#endif
+            << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+            << ",\n  \"failed\": " << (m_failed ? "true" : "false") << ",\n  \"results\": [";
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            const Result& result = m_results[i];
+            std::vector<double> ms = result.ms;
+            std::sort(ms.begin(), ms.end());
+            double mean = 0.0;
+            for (double value : ms) mean += value;
+            mean /= ms.size();
+            double median = ms[ms.size() / 2];
+            char numbers[256];
+            snprintf(numbers, sizeof(numbers),
+                     "\"iterations\": %d, \"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, \"max_ms\": %.4f",
+                     (int)ms.size(), ms.front(), median, mean, ms.back());
+            out << (i ? "," : "") << "\n    { \"name\": \"" << JsonEscape(result.name) << "\", \"variant\": \""
+                << JsonEscape(result.variant) << "\", \"bytes\": " << result.bytes << ", " << numbers;
+            if (result.bytes > 0 && median > 0.0) {
+                char rate[48];
+                snprintf(rate, sizeof(rate), ", \"mib_per_s\": %.2f", result.bytes / 1048576.0 / (median / 1000.0));
+                out << rate;
+            }
+            out << " }";
+        }
+        out << "\n  ]\n}\n";
+        return out.str();
+    }
+
+private:
+    // One untimed warm-up, then reps timed runs; setup runs before each and
+    // is not timed.
+    void Run(const std::string& name, const std::string& variant, int64_t bytes,
+             const std::function<void()>& setup, const std::function<void()>& body)
+    {
+        if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) return;
+        Result result{ name, variant, bytes, {} };
+        for (int i = 0; i <= m_options.reps; ++i) {
+            if (setup) setup();
+            auto start = std::chrono::steady_clock::now();
+            body();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (i > 0) result.ms.push_back(ms);
+        }
+        m_results.push_back(result);
+    }
+
+    void Fail(const std::string& message)
+    {
+        std::cerr << "FAIL " << message << std::endl;
+        m_failed = true;
+    }
+
+    Options m_options;
+    fs::path m_dir;
+    std::vector<Result> m_results;
+    bool m_failed;
+};
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::cerr << "usage: mdsdrv_bench [--scale N] [--reps N] [--filter text] [--out file.json]" << std::endl;
+        return 2;
+    }
+
+    HotPathBench bench(options);
+    bench.ScanForPatterns();
+    bench.ApplyPatternChanges();
+    bench.LoadFile();
+    bench.ResampleAndSave();
+    bench.PreviewMix();
+    bench.ZeroCrossingSnap();
+    bench.Linker();
+    bench.PrintSummary();
+
+    std::string json = bench.ToJson();
+    if (options.out.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(options.out);
+        out << json;
+        if (!out) {
+            std::cerr << "Could not write " << options.out << std::endl;
+            return 2;
+        }
+    }
+    return bench.Failed() ? 1 : 0;
+}
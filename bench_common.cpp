@@ -0,0 +1,146 @@
+#include "bench_common.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "core_benchmark.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+const char* NOTES[] = { "c", "d", "e", "f", "g", "a", "b", "c+", "d+", "f+", "g+", "a+" };
+
+std::string RandomPhrase(BenchRandom& random, int notes)
+{
+    std::string phrase;
+    for (int i = 0; i < notes; ++i) {
+        if (i > 0 && i % 8 == 0) phrase += " |";
+        int pick = random.Range(16);
+        phrase += " ";
+        if (pick < 12) {
+            phrase += NOTES[pick];
+        } else if (pick < 14) {
+            phrase += "r";
+        } else {
+            phrase += pick == 14 ? "> c <" : "< g >";
+        }
+    }
+    return phrase;
+}
+
+void WriteLE(std::ofstream& out, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) out.put((char)((value >> (i * 8)) & 0xff));
+}
+} // namespace
+
+std::string GenerateDocument(size_t target_bytes, int patterns, uint32_t seed)
+{
+    BenchRandom random(seed);
+    std::string text = "#title Synthetic benchmark\n#author mdsdrv_bench\n\n";
+    for (int p = 0; p < patterns; ++p) {
+        text += "*" + std::to_string(701 + p) + " @" + std::to_string(1 + random.Range(3)) + " o" +
+                std::to_string(3 + random.Range(3)) + " l8" + RandomPhrase(random, 32) + "; pattern " +
+                std::to_string(p + 1) + "\n";
+    }
+    text += "\n";
+    const char tracks[] = "ABCDEFGHI";
+    while (text.size() < target_bytes) {
+        if (random.Range(8) == 0) {
+            text += "; section " + std::to_string(random.Next() % 1000) + " uses *" +
+                    std::to_string(701 + random.Range(std::max(1, patterns))) + "\n";
+            continue;
+        }
+        text += tracks[random.Range(9)];
+        text += " ";
+        for (int i = 0; i < 8; ++i) {
+            text += " *" + std::to_string(701 + random.Range(std::max(1, patterns)));
+        }
+        text += RandomPhrase(random, 8) + "\n";
+    }
+    return text;
+}
+
+std::string GenerateSong(int index, uint32_t seed)
+{
+    BenchRandom random(seed + index * 7919);
+    const std::vector<CoreBenchmarkSong>& corpus = GetCoreBenchmarkCorpus();
+    std::string mml = corpus[index % corpus.size()].mml;
+    mml += "A o4 l16" + RandomPhrase(random, 64 + random.Range(64)) + "\n";
+    return mml;
+}
+
+std::vector<int32_t> GenerateSignal(int rate, int64_t frames, uint32_t seed)
+{
+    BenchRandom random(seed);
+    std::vector<int32_t> samples((size_t)frames * 2);
+    double phase_l = 0.0, phase_r = 0.0;
+    for (int64_t i = 0; i < frames; ++i) {
+        phase_l += 2.0 * 3.14159265358979 * 440.0 / rate;
+        phase_r += 2.0 * 3.14159265358979 * 659.25 / rate;
+        int noise = (int)(random.Next() & 0xfff) - 0x800;
+        samples[(size_t)i * 2] = (int32_t)(std::sin(phase_l) * 1.5e9) + noise * 64;
+        samples[(size_t)i * 2 + 1] = (int32_t)(std::sin(phase_r) * 1.5e9) + noise * 64;
+    }
+    return samples;
+}
+
+int64_t WriteWav(const fs::path& path, const std::vector<int32_t>& samples, int rate, int bits)
+{
+    const int channels = 2;
+    const int bytes_per_sample = bits / 8;
+    uint32_t data_size = (uint32_t)(samples.size() * bytes_per_sample);
+
+    std::ofstream out(path, std::ios::binary);
+    out.write("RIFF", 4);
+    WriteLE(out, data_size + 36, 4);
+    out.write("WAVEfmt ", 8);
+    WriteLE(out, 16, 4);
+    WriteLE(out, 1, 2);
+    WriteLE(out, channels, 2);
+    WriteLE(out, rate, 4);
+    WriteLE(out, rate * channels * bytes_per_sample, 4);
+    WriteLE(out, channels * bytes_per_sample, 2);
+    WriteLE(out, bits, 2);
+    out.write("data", 4);
+    WriteLE(out, data_size, 4);
+
+    std::vector<char> buffer(samples.size() * bytes_per_sample);
+    char* at = buffer.data();
+    for (int32_t sample : samples) {
+        uint32_t value = (uint32_t)sample >> (32 - bits);
+        if (bits == 8) value ^= 0x80;     // 8-bit WAV is unsigned
+        for (int b = 0; b < bytes_per_sample; ++b) *at++ = (char)((value >> (b * 8)) & 0xff);
+    }
+    out.write(buffer.data(), buffer.size());
+    return (int64_t)buffer.size() + 44;
+}
+
+std::string JsonEscape(const std::string& text)
+{
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string SizeLabel(int64_t bytes)
+{
+    char buffer[32];
+    if (bytes >= (1 << 20)) {
+        snprintf(buffer, sizeof(buffer), "%.0f MiB", bytes / 1048576.0);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%.0f KiB", bytes / 1024.0);
+    }
+    return buffer;
+}
@@ -0,0 +1,43 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Input generators shared by the benchmark tools. Everything is derived from
+// the seed, so a given size always produces the same bytes on every platform.
+
+// xorshift32
+struct BenchRandom {
+    uint32_t state;
+    explicit BenchRandom(uint32_t seed) : state(seed ? seed : 1) {}
+    uint32_t Next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    int Range(int n) { return (int)(Next() % (uint32_t)n); }
+};
+
+// An editor document of roughly target_bytes: pattern macros *701..*7xx at
+// the start of lines, then track lines that reference them mid-line (which
+// ScanForPatterns has to look at and reject), plus comments.
+std::string GenerateDocument(size_t target_bytes, int patterns, uint32_t seed);
+
+// A compilable song: one of the core benchmark songs plus a random melody
+std::string GenerateSong(int index, uint32_t seed);
+
+// A stereo two-tone signal with a little noise, as full-scale 32-bit samples
+std::vector<int32_t> GenerateSignal(int rate, int64_t frames, uint32_t seed);
+
+// Store a signal from GenerateSignal as a PCM WAV at 8, 16, 24 or 32 bits.
+// Returns the file size.
+int64_t WriteWav(const std::filesystem::path& path, const std::vector<int32_t>& samples, int rate, int bits);
+
+std::string JsonEscape(const std::string& text);
+std::string SizeLabel(int64_t bytes);   // "64 KiB", "3 MiB"
+
+#endif // BENCH_COMMON_H
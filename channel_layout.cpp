@@ -0,0 +1,21 @@
+#include "channel_layout.h"
+
+namespace ChannelLayout {
+
+const Channel CHANNELS[COUNT] = {
+    { "FM1",  'A', CHIP_FM },
+    { "FM2",  'B', CHIP_FM },
+    { "FM3",  'C', CHIP_FM },
+    { "FM4",  'D', CHIP_FM },
+    { "FM5",  'E', CHIP_FM },
+    { "FM6",  'F', CHIP_FM },
+    { "PSG1", 'G', CHIP_PSG },
+    { "PSG2", 'H', CHIP_PSG },
+    { "PSG3", 'I', CHIP_PSG },
+    { "PSG4", 'J', CHIP_PSG },
+    { "PCM1", 'K', CHIP_PCM },
+    { "PCM2", 'L', CHIP_PCM },
+    { "PCM3", 'M', CHIP_PCM },
+};
+
+} // namespace ChannelLayout
@@ -0,0 +1,29 @@
+#ifndef CHANNEL_LAYOUT_H
+#define CHANNEL_LAYOUT_H
+
+#include <cstdint>
+
+// MDSDRV track letters and the sound chip channels they drive.
+namespace ChannelLayout {
+    enum Chip {
+        CHIP_FM,
+        CHIP_PSG,
+        CHIP_PCM
+    };
+
+    struct Channel {
+        const char* name;  // Short label for the UI (FM1, PSG4, PCM2, ...)
+        char track;        // MML track letter
+        Chip chip;
+    };
+
+    static const int COUNT = 13;
+    extern const Channel CHANNELS[COUNT];
+
+    // Bit for a channel in a driver mute mask (bit index is the track id, 'A' == 0)
+    inline uint32_t TrackBit(int channel) {
+        return 1u << (CHANNELS[channel].track - 'A');
+    }
+}
+
+#endif // CHANNEL_LAYOUT_H
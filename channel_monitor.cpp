@@ -0,0 +1,162 @@
+#include "channel_monitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "audio_engine.h"
+#include "background_task.h"
+#include "emu_player.h"
+
+namespace {
+// Emulator output is 16-bit audio scaled up by 8 bits
+const int SAMPLE_SHIFT = 8;
+const int32_t FULL_SCALE = 32767;
+
+// FillMonitorSet renders this many points per channel at a time, and
+// sleeps this long whenever its queue is full
+const int FILL_CHUNK_POINTS = 64;
+const int FILL_WAIT_MS = 5;
+}
+
+ChannelMonitor::ChannelMonitor()
+    : m_generation(0), m_base_frame(0), m_written(0)
+{
+    std::memset(m_rings, 0, sizeof(m_rings));
+    for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+        m_clip_count[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void ChannelMonitor::Reset(int64_t start_frame)
+{
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    m_base_frame.store(start_frame, std::memory_order_release);
+    m_written.store(0, std::memory_order_release);
+}
+
+void ChannelMonitor::Write(int channel, int at, const Point* points, int count)
+{
+    Point* ring = m_rings[channel];
+    int64_t index = m_written.load(std::memory_order_relaxed) + at;
+    bool clipped = false;
+    for (int i = 0; i < count; ++i) {
+        ring[(index + i) & (RING_POINTS - 1)] = points[i];
+        clipped |= points[i].clipped != 0;
+    }
+
+    // Counted here as well so the UI can't miss a clip between two frames
+    if (clipped) {
+        m_clip_count[channel].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ChannelMonitor::Advance(int points)
+{
+    m_written.fetch_add(points, std::memory_order_release);
+}
+
+//=====================================================================
+
+void SetUpMonitorSet(MonitorSet& set, std::shared_ptr<Song> song, uint32_t channel_mask)
+{
+    for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+        if (!(channel_mask & (1u << ch))) continue;
+        std::shared_ptr<Emu_Player> player = std::make_shared<Emu_Player>(song, 0);
+        // Solo: every other track muted
+        player->set_mute_mask(~ChannelLayout::TrackBit(ch));
+        set.players[ch] = player;
+        set.streams[ch] = AudioEngine::Get().PrepareSong(player);
+    }
+    set.start_frame = 0;
+}
+
+namespace {
+void FastForward(Audio_Stream& stream, int64_t frames, const BackgroundTask& task)
+{
+    const int BLOCK = 4096;
+    std::vector<WAVE_32BS> scratch(BLOCK);
+    while (frames > 0 && !task.IsCancelled()) {
+        int count = (int)std::min<int64_t>(BLOCK, frames);
+        std::memset(scratch.data(), 0, sizeof(WAVE_32BS) * count);
+        stream.get_sample(scratch.data(), count, 2);
+        frames -= count;
+    }
+}
+// One point from DECIMATION frames of emulator output
+ChannelMonitor::Point Decimate(const WAVE_32BS* frames)
+{
+    int32_t min = FULL_SCALE;
+    int32_t max = -FULL_SCALE - 1;
+    int64_t sum_squares = 0;
+    bool clipped = false;
+    for (int i = 0; i < ChannelMonitor::DECIMATION; ++i) {
+        int32_t l = frames[i].L >> SAMPLE_SHIFT;
+        int32_t r = frames[i].R >> SAMPLE_SHIFT;
+        int32_t mono = (l + r) / 2;
+        min = std::min(min, mono);
+        max = std::max(max, mono);
+        sum_squares += (int64_t)mono * mono;
+        if (l >= FULL_SCALE || l <= -FULL_SCALE || r >= FULL_SCALE || r <= -FULL_SCALE) {
+            clipped = true;
+        }
+    }
+    ChannelMonitor::Point point;
+    point.min = (int16_t)std::max(min, -FULL_SCALE - 1);
+    point.max = (int16_t)std::min(max, FULL_SCALE);
+    point.rms = (uint16_t)std::min<double>(std::sqrt((double)sum_squares / ChannelMonitor::DECIMATION), 65535.0);
+    point.clipped = clipped ? 1 : 0;
+    return point;
+}
+} // namespace
+
+bool AdvanceMonitorSet(MonitorSet& set, int64_t target_frame, BackgroundTask& task)
+{
+    int64_t frames = target_frame - set.start_frame;
+    if (frames > 0) {
+#ifdef __EMSCRIPTEN__
+        for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+            if (set.streams[ch]) FastForward(*set.streams[ch], frames, task);
+        }
+#else
+        // The players are independent, so the work splits cleanly per channel
+        std::vector<std::thread> threads;
+        for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+            if (!set.streams[ch]) continue;
+            Audio_Stream* stream = set.streams[ch].get();
+            threads.emplace_back([stream, frames, &task]() { FastForward(*stream, frames, task); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+#endif
+    }
+    if (task.IsCancelled()) return false;
+    set.start_frame = std::max(set.start_frame, target_frame);
+    return true;
+}
+
+void FillMonitorSet(MonitorSet& set, BackgroundTask& task)
+{
+    static_assert(MonitorSet::QUEUE_POINTS % FILL_CHUNK_POINTS == 0, "chunks must not wrap the queue");
+    std::vector<WAVE_32BS> scratch(FILL_CHUNK_POINTS * ChannelMonitor::DECIMATION);
+    while (!task.IsCancelled()) {
+        int64_t produced = set.produced.load(std::memory_order_relaxed);
+        if (produced + FILL_CHUNK_POINTS - set.consumed.load(std::memory_order_acquire) > MonitorSet::QUEUE_POINTS) {
+            // Far enough ahead; wait for the song to catch up
+            std::this_thread::sleep_for(std::chrono::milliseconds(FILL_WAIT_MS));
+            continue;
+        }
+        int at = (int)(produced & (MonitorSet::QUEUE_POINTS - 1));
+        for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+            if (!set.streams[ch]) continue;
+            std::memset(scratch.data(), 0, sizeof(WAVE_32BS) * scratch.size());
+            set.streams[ch]->get_sample(scratch.data(), (int)scratch.size(), 2);
+            for (int p = 0; p < FILL_CHUNK_POINTS; ++p) {
+                set.queue[ch][at + p] = Decimate(scratch.data() + p * ChannelMonitor::DECIMATION);
+            }
+        }
+        set.produced.store(produced + FILL_CHUNK_POINTS, std::memory_order_release);
+    }
+}
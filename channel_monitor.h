@@ -0,0 +1,106 @@
+#ifndef CHANNEL_MONITOR_H
+#define CHANNEL_MONITOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "audio_manager.h"
+#include "channel_layout.h"
+
+// Forward declarations
+class Emu_Player;
+class Song;
+class BackgroundTask;
+
+// Decimated per-channel history written by the audio thread. Each channel
+// has a ring of points; the audio thread only ever stores into it and bumps
+// one counter (wait-free), readers index straight into the ring and check
+// afterwards that what they read was not overwritten. The points themselves
+// are rendered ahead of time by a MonitorSet's worker, so the audio thread
+// only copies them in.
+class ChannelMonitor {
+public:
+    static const int DECIMATION = 16;       // Output frames per point
+    static const int RING_POINTS = 8192;    // Per channel, power of two
+    // Most points stored past GetWrittenPoints() before Advance() publishes them
+    static const int MAX_BLOCK_POINTS = 256;
+
+    struct Point {
+        int16_t min;
+        int16_t max;
+        uint16_t rms;
+        uint16_t clipped;   // Non-zero if any frame hit full scale
+    };
+
+    ChannelMonitor();
+
+    // Audio thread. Write() stores count points at GetWrittenPoints() + at;
+    // Advance() then publishes the block.
+    void Reset(int64_t start_frame);
+    void Write(int channel, int at, const Point* points, int count);
+    void Advance(int points);
+
+    // Any thread. Points are numbered from the last Reset(); point i covers
+    // song frames [GetBaseFrame() + i * DECIMATION, ... + DECIMATION).
+    uint32_t GetGeneration() const { return m_generation.load(std::memory_order_acquire); }
+    int64_t GetBaseFrame() const { return m_base_frame.load(std::memory_order_acquire); }
+    int64_t GetWrittenPoints() const { return m_written.load(std::memory_order_acquire); }
+    const Point& GetPoint(int channel, int64_t index) const { return m_rings[channel][index & (RING_POINTS - 1)]; }
+    uint32_t GetClipCount(int channel) const { return m_clip_count[channel].load(std::memory_order_relaxed); }
+
+    // Oldest point that a block being written right now cannot reach
+    int64_t GetFirstSafePoint() const {
+        return std::max<int64_t>(0, GetWrittenPoints() + MAX_BLOCK_POINTS - (RING_POINTS - 1));
+    }
+
+    // True if points [first, end) were still intact after being read, given
+    // the generation seen before reading. The block the writer may be
+    // storing ahead of the published count is allowed for.
+    bool IsIntact(uint32_t generation, int64_t first) const {
+        return GetGeneration() == generation && GetWrittenPoints() + MAX_BLOCK_POINTS - first <= RING_POINTS - 1;
+    }
+
+private:
+    Point m_rings[ChannelLayout::COUNT][RING_POINTS];
+
+    std::atomic<uint32_t> m_generation;
+    std::atomic<int64_t> m_base_frame;
+    std::atomic<int64_t> m_written;
+    std::atomic<uint32_t> m_clip_count[ChannelLayout::COUNT];
+};
+
+// Solo players for the channels being monitored, and the points they have
+// rendered so far. Set up on a worker, which then keeps rendering ahead of
+// the song (FillMonitorSet); the audio engine takes points from the queue
+// as the song clock passes them, starting at start_frame.
+struct MonitorSet {
+    static const int QUEUE_POINTS = 8192;   // Per channel, power of two
+
+    std::shared_ptr<Emu_Player> players[ChannelLayout::COUNT];
+    std::shared_ptr<Audio_Stream> streams[ChannelLayout::COUNT];    // Empty when not monitored
+    int64_t start_frame = 0;
+
+    // Point i covers song frames [start_frame + i * DECIMATION, ...). The
+    // worker writes points [produced, consumed + QUEUE_POINTS), the audio
+    // thread reads [consumed, produced).
+    ChannelMonitor::Point queue[ChannelLayout::COUNT][QUEUE_POINTS];
+    std::atomic<int64_t> produced{0};
+    std::atomic<int64_t> consumed{0};
+    std::atomic<bool> ready{false};     // Set by the worker once start_frame is final
+};
+
+// Create solo players in set for the channels whose bit (1 << channel
+// index) is set in channel_mask, positioned at the start of the song.
+void SetUpMonitorSet(MonitorSet& set, std::shared_ptr<Song> song, uint32_t channel_mask);
+
+// Run every player in the set silently up to target_frame, one thread per
+// channel on native builds. Returns false if the task was cancelled.
+bool AdvanceMonitorSet(MonitorSet& set, int64_t target_frame, BackgroundTask& task);
+
+// Render points from start_frame on, staying at most QUEUE_POINTS ahead of
+// what the engine has taken, until the task is cancelled. Needs a real
+// worker thread, so not available on Emscripten builds.
+void FillMonitorSet(MonitorSet& set, BackgroundTask& task);
+
+#endif // CHANNEL_MONITOR_H
@@ -0,0 +1,86 @@
+#include "chip_cores.h"
+#include <atomic>
+
+extern "C" {
+#include "emu/EmuCores.h"
+#include "emu/SoundDevs.h"
+#include "emu/SoundEmu.h"
+
+// libvgm's own SndEmu_Start, renamed when SoundEmu.c is compiled (see
+// CMakeLists.txt) so the one below can pick the core first.
+UINT8 SndEmu_Start_Default(UINT8 deviceID, const DEV_GEN_CFG* cfg, DEV_INFO* retDevInf);
+}
+
+namespace ChipCores {
+
+namespace {
+struct CoreInfo {
+    const char* name;
+    const char* key;
+    const char* description;
+    UINT32 fcc;
+};
+
+const CoreInfo CORES[YM2612_CORE_COUNT] = {
+    { "Genesis Plus GX", "gpgx", "Fast; good for editing", FCC_GPGX },
+    { "Nuked OPN2", "nuked", "Cycle-accurate; best for final renders", FCC_NUKE },
+    { "MAME", "mame", "MAME's OPN core", FCC_MAME },
+};
+
+std::atomic<int> g_core(YM2612_GPGX);
+thread_local int t_override = -1;
+} // namespace
+
+const char* GetName(Ym2612Core core) { return CORES[core].name; }
+const char* GetConfigKey(Ym2612Core core) { return CORES[core].key; }
+const char* GetDescription(Ym2612Core core) { return CORES[core].description; }
+
+Ym2612Core FromConfigKey(const std::string& key)
+{
+    for (int i = 0; i < YM2612_CORE_COUNT; ++i) {
+        if (key == CORES[i].key) return (Ym2612Core)i;
+    }
+    return YM2612_GPGX;
+}
+
+void SetYm2612Core(Ym2612Core core)
+{
+    g_core.store(core, std::memory_order_relaxed);
+}
+
+Ym2612Core GetYm2612Core()
+{
+    return (Ym2612Core)g_core.load(std::memory_order_relaxed);
+}
+
+Ym2612Core GetActiveYm2612Core()
+{
+    return t_override >= 0 ? (Ym2612Core)t_override : GetYm2612Core();
+}
+
+ScopedYm2612Core::ScopedYm2612Core(Ym2612Core core) : m_previous(t_override)
+{
+    t_override = core;
+}
+
+ScopedYm2612Core::~ScopedYm2612Core()
+{
+    t_override = m_previous;
+}
+
+} // namespace ChipCores
+
+// Every device Emu_Player starts goes through here. Only the YM2612 core is
+// changed; the config belongs to the caller and is restored afterwards.
+extern "C" UINT8 SndEmu_Start(UINT8 deviceID, const DEV_GEN_CFG* cfg, DEV_INFO* retDevInf)
+{
+    if (deviceID != DEVID_YM2612 || !cfg) {
+        return SndEmu_Start_Default(deviceID, cfg, retDevInf);
+    }
+    DEV_GEN_CFG* config = const_cast<DEV_GEN_CFG*>(cfg);
+    UINT32 previous = config->emuCore;
+    config->emuCore = ChipCores::CORES[ChipCores::GetActiveYm2612Core()].fcc;
+    UINT8 result = SndEmu_Start_Default(deviceID, config, retDevInf);
+    config->emuCore = previous;
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef CHIP_CORES_H
+#define CHIP_CORES_H
+
+#include <cstdint>
+#include <string>
+
+// Runtime choice of libvgm's YM2612 emulator core. libvgm picks a core when a
+// device is started, so the selection applies to every player set up after
+// the change (playback, pre-rendering, monitors), not to running ones.
+namespace ChipCores {
+
+enum Ym2612Core {
+    YM2612_GPGX,    // Genesis Plus GX: fast, the long-standing default
+    YM2612_NUKED,   // Nuked OPN2: cycle-accurate, several times slower
+    YM2612_MAME,    // MAME's OPN core
+    YM2612_CORE_COUNT
+};
+
+const char* GetName(Ym2612Core core);          // For display
+const char* GetConfigKey(Ym2612Core core);     // For the config file
+const char* GetDescription(Ym2612Core core);
+Ym2612Core FromConfigKey(const std::string& key);   // Unknown keys give GPGX
+
+// Process-wide selection, used by players set up on any thread
+void SetYm2612Core(Ym2612Core core);
+Ym2612Core GetYm2612Core();
+
+// Core that players set up on the calling thread will use: the override of
+// the innermost ScopedYm2612Core if any, otherwise the global selection.
+Ym2612Core GetActiveYm2612Core();
+
+// Overrides the core for players set up on this thread while in scope (for
+// benchmarks and offline renders that must not follow the UI setting).
+class ScopedYm2612Core {
+public:
+    explicit ScopedYm2612Core(Ym2612Core core);
+    ~ScopedYm2612Core();
+
+    ScopedYm2612Core(const ScopedYm2612Core&) = delete;
+    ScopedYm2612Core& operator=(const ScopedYm2612Core&) = delete;
+
+private:
+    int m_previous;
+};
+
+} // namespace ChipCores
+
+#endif // CHIP_CORES_H
@@ -22,6 +22,30 @@ int ClampDimension(int value) {
     return value;
 }
 
+int ClampSampleRate(int value) {
+    const int minRate = 8000;
+    const int maxRate = 192000;
+    if (value < minRate) return minRate;
+    if (value > maxRate) return maxRate;
+    return value;
+}
+
+int ClampBufferFrames(int value) {
+    const int minFrames = 32;
+    const int maxFrames = 4096;
+    if (value < minFrames) return minFrames;
+    if (value > maxFrames) return maxFrames;
+    return value;
+}
+
+int ClampVisualOffset(int value) {
+    const int minOffset = -200;
+    const int maxOffset = 500;
+    if (value < minOffset) return minOffset;
+    if (value > maxOffset) return maxOffset;
+    return value;
+}
+
 float ClampUiScale(float value) {
     const float minScale = 0.5f;
     const float maxScale = 3.0f;
@@ -71,6 +95,16 @@ UserConfig LoadUserConfig() {
             } else if (line.rfind("ui_scale=", 0) == 0) {
                 float value = std::stof(line.substr(9));
                 config.uiScale = ClampUiScale(value);
+            } else if (line.rfind("audio_sample_rate=", 0) == 0) {
+                config.audioSampleRate = ClampSampleRate(std::stoi(line.substr(18)));
+            } else if (line.rfind("audio_buffer_frames=", 0) == 0) {
+                config.audioBufferFrames = ClampBufferFrames(std::stoi(line.substr(20)));
+            } else if (line.rfind("audio_native_rate=", 0) == 0) {
+                config.audioNativeRate = std::stoi(line.substr(18)) != 0;
+            } else if (line.rfind("audio_visual_offset_ms=", 0) == 0) {
+                config.audioVisualOffsetMs = ClampVisualOffset(std::stoi(line.substr(23)));
+            } else if (line.rfind("audio_ym2612_core=", 0) == 0) {
+                config.audioYm2612Core = line.substr(18);
             }
         }
     } catch (...) {
@@ -94,6 +128,11 @@ void SaveUserConfig(const UserConfig& config) {
         out << "window_width=" << ClampDimension(config.windowWidth) << "\n";
         out << "window_height=" << ClampDimension(config.windowHeight) << "\n";
         out << "ui_scale=" << ClampUiScale(config.uiScale) << "\n";
+        out << "audio_sample_rate=" << ClampSampleRate(config.audioSampleRate) << "\n";
+        out << "audio_buffer_frames=" << ClampBufferFrames(config.audioBufferFrames) << "\n";
+        out << "audio_native_rate=" << (config.audioNativeRate ? 1 : 0) << "\n";
+        out << "audio_visual_offset_ms=" << ClampVisualOffset(config.audioVisualOffsetMs) << "\n";
+        out << "audio_ym2612_core=" << config.audioYm2612Core << "\n";
     } catch (...) {
         // Ignore save errors to avoid crashing the UI over config persistence
     }
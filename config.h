@@ -2,12 +2,18 @@
 #define CONFIG_H
 
 #include <filesystem>
+#include <string>
 
 struct UserConfig {
     int theme = 0;           // 0=Dark,1=Light,2=Classic
     int windowWidth = 1280;
     int windowHeight = 720;
     float uiScale = 1.0f;
+    int audioSampleRate = 44100;
+    int audioBufferFrames = 1024;   // Engine block size between command checks
+    bool audioNativeRate = false;   // Run chips at native rate, resample once
+    int audioVisualOffsetMs = 0;    // Extra delay for playback cursors and meters
+    std::string audioYm2612Core = "gpgx";  // ChipCores config key
 };
 
 std::filesystem::path GetUserConfigPath();
@@ -0,0 +1,205 @@
+#include "core_benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include "background_task.h"
+#include "emu_player.h"
+#include "song.h"
+#include "song_manager.h"
+
+namespace {
+// Fixed rate so results compare across machines and output settings
+const uint32_t SAMPLE_RATE = 44100;
+const int BLOCK_FRAMES = 4096;
+
+// Emulator output is 16-bit audio scaled up by 8 bits
+const int SAMPLE_SHIFT = 8;
+
+const int COMPILE_TIMEOUT_MS = 5000;
+
+const ChipCores::Ym2612Core REFERENCE_CORE = ChipCores::YM2612_NUKED;
+
+const char* FM_PATCHES =
+    "@1 fm\n"
+    "  4  6\n"
+    " 31  8  0  6  2 24  0  1  3  0\n"
+    " 31 10  0  7  2 12  0  2  7  0\n"
+    " 31  8  0  6  2 24  0  1  3  0\n"
+    " 31 10  0  7  2 12  0  2  7  0\n"
+    "@2 fm\n"
+    "  7  0\n"
+    " 31 12  4  8  4  4  0  1  0  0\n"
+    " 31 12  4  8  4  4  0  3  0  0\n"
+    " 31 12  4  8  4  4  0  5  0  0\n"
+    " 31 12  4  8  4  4  0  7  0  0\n"
+    "@3 fm\n"
+    "  2  5\n"
+    " 28  4  2  6  1 30  1  1  3  0\n"
+    " 28  6  2  6  1 40  1  3  7  0\n"
+    " 28  4  2  6  1 22  1  1  0  0\n"
+    " 31  9  4  8  2  0  1  1  0  0\n";
+} // namespace
+
+const std::vector<CoreBenchmarkSong>& GetCoreBenchmarkCorpus()
+{
+    static const std::vector<CoreBenchmarkSong> corpus = {
+        { "FM chords", std::string(FM_PATCHES) +
+            "ABCDEF t140 l8\n"
+            "A @1 o4 [c e g > c < g e]16\n"
+            "B @1 o4 [e g > c e c < g]16\n"
+            "C @1 o3 [g > c e g e c <]16\n"
+            "D @3 o2 l4 [c c g g a a f f]8\n"
+            "E @2 o5 l16 [c d e f g a b > c < b a g f e d c r]8\n"
+            "F @2 o5 l16 r32 [c d e f g a b > c < b a g f e d c r]8\n" },
+        { "FM and PSG", std::string(FM_PATCHES) +
+            "@10 psg 15 13 11 9 7 5 3 1\n"
+            "ABCGHI t160 l8\n"
+            "A @3 o2 [c c > c < c f f > f < f]8\n"
+            "B @1 o4 l4 [e g a g f a g e]4\n"
+            "C @2 o5 l16 [c e g > c < g e c e]16\n"
+            "G @10 o5 l16 [c e g b > c < b g e]16\n"
+            "H @10 o4 l8 [g b > d < b]16\n"
+            "I @10 o3 l4 [c e f g]8\n" },
+        { "Fast arpeggios", std::string(FM_PATCHES) +
+            "ABCDEF t180 l32\n"
+            "A @2 o4 [c e g > c e g c < g e c < g e]24\n"
+            "B @2 o4 [d f a > d f a d < a f d < a f]24\n"
+            "C @2 o4 [e g b > e g b e < b g e < b g]24\n"
+            "D @1 o3 l8 [c g > c < g]24\n"
+            "E @3 o2 l16 [c c c r]48\n"
+            "F @1 o5 l16 [g f e d c d e f]24\n" },
+    };
+    return corpus;
+}
+
+std::shared_ptr<Song> CompileBenchmarkSong(const std::string& mml, std::string& error)
+{
+    Song_Manager manager;
+    manager.compile(mml, "benchmark.mml");
+    int waited = 0;
+    while (manager.get_compile_in_progress() && waited < COMPILE_TIMEOUT_MS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        waited += 5;
+    }
+    if (manager.get_compile_result() != Song_Manager::COMPILE_OK) {
+        error = manager.get_error_message();
+        if (error.empty()) error = "Compile did not finish";
+        return nullptr;
+    }
+    return manager.get_song();
+}
+
+namespace {
+struct Difference {
+    int max = 0;
+    double sum_squares = 0.0;
+    int64_t differing = 0;
+    int64_t samples = 0;
+};
+
+// Render one song on the current thread's core. With reference == nullptr
+// the output is appended to out; otherwise it is compared against reference
+// starting at offset. Returns the wall time spent rendering.
+double RenderSong(std::shared_ptr<Song> song, int64_t frames, std::vector<int16_t>* out,
+                  const std::vector<int16_t>* reference, size_t offset, Difference& diff,
+                  const BackgroundTask& task)
+{
+    std::shared_ptr<Emu_Player> player = std::make_shared<Emu_Player>(song, 0);
+    player->setup_stream(SAMPLE_RATE);
+
+    std::vector<WAVE_32BS> buffer(BLOCK_FRAMES);
+    double seconds = 0.0;
+    for (int64_t done = 0; done < frames && !task.IsCancelled(); done += BLOCK_FRAMES) {
+        int count = (int)std::min<int64_t>(BLOCK_FRAMES, frames - done);
+        std::memset(buffer.data(), 0, sizeof(WAVE_32BS) * count);
+
+        auto start = std::chrono::steady_clock::now();
+        player->get_sample(buffer.data(), count, 2);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (int i = 0; i < count; ++i) {
+            int16_t l = (int16_t)std::max(-32768, std::min(32767, buffer[i].L >> SAMPLE_SHIFT));
+            int16_t r = (int16_t)std::max(-32768, std::min(32767, buffer[i].R >> SAMPLE_SHIFT));
+            if (!reference) {
+                out->push_back(l);
+                out->push_back(r);
+                continue;
+            }
+            size_t at = offset + (size_t)(done + i) * 2;
+            int dl = std::abs(l - (*reference)[at]);
+            int dr = std::abs(r - (*reference)[at + 1]);
+            diff.max = std::max(diff.max, std::max(dl, dr));
+            diff.sum_squares += (double)dl * dl + (double)dr * dr;
+            diff.differing += (dl != 0) + (dr != 0);
+            diff.samples += 2;
+        }
+    }
+    return seconds;
+}
+} // namespace
+
+bool RunCoreBenchmark(const std::vector<CoreBenchmarkSong>& songs, int seconds_per_song,
+                      std::vector<CoreBenchmarkResult>& results, std::string& error, BackgroundTask& task)
+{
+    results.clear();
+    std::vector<std::shared_ptr<Song>> compiled;
+    for (const CoreBenchmarkSong& entry : songs) {
+        std::string message;
+        std::shared_ptr<Song> song = CompileBenchmarkSong(entry.mml, message);
+        if (!song) {
+            error = entry.name + ": " + message;
+            return false;
+        }
+        compiled.push_back(song);
+    }
+
+    // Reference first, then the others in menu order
+    std::vector<ChipCores::Ym2612Core> cores = { REFERENCE_CORE };
+    for (int i = 0; i < ChipCores::YM2612_CORE_COUNT; ++i) {
+        if (i != REFERENCE_CORE) cores.push_back((ChipCores::Ym2612Core)i);
+    }
+
+    const int64_t frames = (int64_t)seconds_per_song * SAMPLE_RATE;
+    std::vector<int16_t> reference;
+    reference.reserve((size_t)(frames * 2 * compiled.size()));
+    int steps = (int)(cores.size() * compiled.size());
+    int step = 0;
+
+    for (ChipCores::Ym2612Core core : cores) {
+        ChipCores::ScopedYm2612Core scoped(core);
+        CoreBenchmarkResult result;
+        result.core = core;
+        result.render_seconds = 0.0;
+        Difference diff;
+
+        for (size_t s = 0; s < compiled.size(); ++s) {
+            bool is_reference = (core == REFERENCE_CORE);
+            result.render_seconds += RenderSong(compiled[s], frames,
+                                                is_reference ? &reference : nullptr,
+                                                is_reference ? nullptr : &reference,
+                                                (size_t)(s * frames * 2), diff, task);
+            if (task.IsCancelled()) {
+                error = "Cancelled";
+                return false;
+            }
+            task.SetProgress((float)++step / steps);
+        }
+
+        result.audio_seconds = (double)frames * compiled.size() / SAMPLE_RATE;
+        result.speed = result.render_seconds > 0.0 ? result.audio_seconds / result.render_seconds : 0.0;
+        result.ms_per_audio_second = result.audio_seconds > 0.0 ? result.render_seconds * 1000.0 / result.audio_seconds : 0.0;
+        result.max_difference = diff.max;
+        if (diff.samples > 0 && diff.sum_squares > 0.0) {
+            double rms = std::sqrt(diff.sum_squares / diff.samples);
+            result.rms_difference_db = 20.0 * std::log10(rms / 32768.0);
+        } else {
+            result.rms_difference_db = -std::numeric_limits<double>::infinity();
+        }
+        result.differing_percent = diff.samples > 0 ? 100.0 * diff.differing / diff.samples : 0.0;
+        results.push_back(result);
+    }
+    return true;
+}
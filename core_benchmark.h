@@ -0,0 +1,42 @@
+#ifndef CORE_BENCHMARK_H
+#define CORE_BENCHMARK_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "chip_cores.h"
+
+// Forward declarations
+class Song;
+class BackgroundTask;
+
+struct CoreBenchmarkSong {
+    std::string name;
+    std::string mml;
+};
+
+struct CoreBenchmarkResult {
+    ChipCores::Ym2612Core core;
+    double audio_seconds;           // Rendered, over the whole corpus
+    double render_seconds;          // Wall time spent in the emulator
+    double speed;                   // Audio seconds per render second
+    double ms_per_audio_second;     // Render time per second of audio
+    // Against the reference core (Nuked OPN2), 16-bit sample units
+    int max_difference;
+    double rms_difference_db;       // dBFS; -inf when identical
+    double differing_percent;       // Samples that are not bit-identical
+};
+
+// Fixed songs that exercise FM, PSG and mixed writes
+const std::vector<CoreBenchmarkSong>& GetCoreBenchmarkCorpus();
+
+// Compile MML text into a song outside the editor's own Song_Manager.
+std::shared_ptr<Song> CompileBenchmarkSong(const std::string& mml, std::string& error);
+
+// Render seconds_per_song of every song on every YM2612 core, on this thread
+// (one core at a time, so timings don't compete). Returns one result per
+// core, reference core first. Runs on a BackgroundTask.
+bool RunCoreBenchmark(const std::vector<CoreBenchmarkSong>& songs, int seconds_per_song,
+                      std::vector<CoreBenchmarkResult>& results, std::string& error, BackgroundTask& task);
+
+#endif // CORE_BENCHMARK_H
@@ -0,0 +1,112 @@
+#include "core_benchmark_window.h"
+#include <imgui.h>
+#include <cmath>
+#include <cstdio>
+
+CoreBenchmarkWindow::CoreBenchmarkWindow()
+    : m_seconds(20), m_include_current(false), m_run_requested(false), m_running(false),
+      m_open(false), m_request_focus(false), m_task_ok(false)
+{
+    m_status_message = "Ready";
+}
+
+bool CoreBenchmarkWindow::ConsumeRunRequest()
+{
+    bool requested = m_run_requested;
+    m_run_requested = false;
+    return requested;
+}
+
+void CoreBenchmarkWindow::Start(const std::string& current_mml)
+{
+    m_task_songs = GetCoreBenchmarkCorpus();
+    if (!current_mml.empty()) {
+        m_task_songs.push_back(CoreBenchmarkSong{ "Current song", current_mml });
+    }
+    int seconds = m_seconds;
+    m_running = true;
+    m_status_message = "Running...";
+    m_task.Start([this, seconds](BackgroundTask& task) {
+        m_task_ok = RunCoreBenchmark(m_task_songs, seconds, m_task_results, m_task_error, task);
+    });
+}
+
+void CoreBenchmarkWindow::Render()
+{
+    if (m_running && !m_task.IsRunning()) {
+        m_task.Join();
+        m_running = false;
+        if (m_task_ok) {
+            m_results = m_task_results;
+            char buffer[96];
+            snprintf(buffer, sizeof(buffer), "%d songs x %d s per core", (int)m_task_songs.size(), m_seconds);
+            m_status_message = buffer;
+        } else {
+            m_status_message = "Benchmark failed: " + m_task_error;
+        }
+    }
+
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(620, 280), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("YM2612 Core Benchmark", &m_open)) {
+        ImGui::SliderInt("Seconds per song", &m_seconds, 5, 120);
+        ImGui::Checkbox("Include current song", &m_include_current);
+
+        if (m_running) {
+            ImGui::ProgressBar(m_task.GetProgress(), ImVec2(200.0f, 0.0f), "Rendering...");
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                m_task.Cancel();
+            }
+        } else if (ImGui::Button("Run")) {
+            if (m_include_current) {
+                m_run_requested = true;
+            } else {
+                Start(std::string());
+            }
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted(m_status_message.c_str());
+
+        if (!m_results.empty() && ImGui::BeginTable("results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Core");
+            ImGui::TableSetupColumn("Speed");
+            ImGui::TableSetupColumn("CPU per s");
+            ImGui::TableSetupColumn("Max diff");
+            ImGui::TableSetupColumn("RMS diff");
+            ImGui::TableSetupColumn("Differing");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < m_results.size(); ++i) {
+                const CoreBenchmarkResult& result = m_results[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s%s", ChipCores::GetName(result.core), i == 0 ? " (ref)" : "");
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1fx", result.speed);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f ms", result.ms_per_audio_second);
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", result.max_difference);
+                ImGui::TableNextColumn();
+                if (std::isinf(result.rms_difference_db)) {
+                    ImGui::TextUnformatted("-");
+                } else {
+                    ImGui::Text("%.1f dBFS", result.rms_difference_db);
+                }
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", result.differing_percent);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TextDisabled("Speed is audio time rendered per second of wall time on one thread.\n"
+                            "Differences are against the reference core, in 16-bit sample units.");
+    }
+    ImGui::End();
+}
@@ -0,0 +1,43 @@
+#ifndef CORE_BENCHMARK_WINDOW_H
+#define CORE_BENCHMARK_WINDOW_H
+
+#include <string>
+#include <vector>
+#include "background_task.h"
+#include "core_benchmark.h"
+
+// Renders the benchmark corpus (optionally plus the song being edited) on
+// every YM2612 core and shows speed and how far each core is from the
+// reference. The Editor supplies the current text via ConsumeRunRequest().
+class CoreBenchmarkWindow {
+public:
+    CoreBenchmarkWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+    // True once after Run was pressed with "Include current song" checked
+    bool ConsumeRunRequest();
+    void Start(const std::string& current_mml);
+
+private:
+    int m_seconds;
+    bool m_include_current;
+    bool m_run_requested;
+    bool m_running;
+    std::string m_status_message;
+    std::vector<CoreBenchmarkResult> m_results;
+
+    bool m_open;
+    bool m_request_focus;
+
+    // Owned by the job while it runs
+    std::vector<CoreBenchmarkSong> m_task_songs;
+    std::vector<CoreBenchmarkResult> m_task_results;
+    std::string m_task_error;
+    bool m_task_ok;
+    BackgroundTask m_task;          // After the fields above, so it is joined first
+};
+
+#endif // CORE_BENCHMARK_WINDOW_H
@@ -8,13 +8,29 @@
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <ctime>
+#include <cstring>
 #include "song_manager.h"
+#include "emu_player.h"
 #include "audio_manager.h"
 #include "imguifilesystem.h"
 #include "export_window.h"
 #include "pcm_tool_window.h"
 #include "mdsbin_export_window.h"
+#include "vgm_export_window.h"
+#include "core_benchmark_window.h"
+#include "chip_cores.h"
 #include "pattern_editor.h"
+#include "mixer_window.h"
+#include "timeline_window.h"
+#include "audio_settings_window.h"
+#include "scope_window.h"
+#include "spectrum_window.h"
+#include "channel_monitor.h"
+#include "audio_engine.h"
+#include "background_task.h"
+#include "song_cache.h"
 #include "theme.h"
 #include "config.h"
 #include "core.h"
@@ -27,8 +43,44 @@
 #include <memory>
 #include <cstdlib>
 #include <climits>
+#include <functional>
 
-Editor::Editor() : m_unsavedChanges(false), m_isPlaying(false), m_debug(false),
+namespace {
+// Upper bound on how much of a (usually looping) song is pre-rendered
+const int CACHE_MAX_SECONDS = 300;
+// How far ahead of the audio clock a live player is positioned before it
+// takes over from (or starts shadowing) the cached render
+const int HANDOVER_LEAD_MS = 250;
+// Same for the per-channel monitor players, which take longer to catch up
+const int MONITOR_LEAD_MS = 500;
+// Without worker threads (Emscripten) a live player is fast-forwarded from
+// the frame loop, for at most this long per frame
+const int LIVE_SLICE_MS = 8;
+
+// Emulate a live player silently from position towards target, a block at a
+// time. A handover or shadow player chases a target that keeps moving with
+// the audio clock, lead ahead of it. Stops early once stop() returns true;
+// returns the new position.
+template <class Stop>
+int64_t FastForwardLive(Audio_Stream& stream, int64_t position, int64_t& target, int64_t lead, bool chase, Stop stop)
+{
+    std::vector<WAVE_32BS> scratch(SongCache::BLOCK_FRAMES);
+    while (position < target && !stop()) {
+        int count = (int)std::min<int64_t>(SongCache::BLOCK_FRAMES, target - position);
+        std::memset(scratch.data(), 0, sizeof(WAVE_32BS) * count);
+        stream.get_sample(scratch.data(), count, 2);
+        position += count;
+        if (chase) {
+            target = std::max(target, AudioEngine::Get().GetSongFrame() + lead);
+        }
+    }
+    return position;
+}
+}
+
+Editor::Editor() : m_unsavedChanges(false), m_isPlaying(false), m_appliedMuteMask(0),
+                   m_liveFrame(0), m_liveTarget(0), m_liveLead(0), m_liveMode(LIVE_RESTART), m_livePending(false),
+                   m_monitorMask(0), m_monitorPending(false), m_debug(false),
                    m_showOpenDialog(false), m_showSaveDialog(false), m_showSaveAsDialog(false),
                    m_showConfirmNewDialog(false), m_showConfirmOpenDialog(false),
                    m_pendingNewFile(false), m_pendingOpenFile(false),
@@ -40,6 +92,16 @@ Editor::Editor() : m_unsavedChanges(false), m_isPlaying(false), m_debug(false),
     m_pcmToolWindow = std::make_unique<PCMToolWindow>();
     m_mdsBinExportWindow = std::make_unique<MDSBinExportWindow>();
     m_patternEditor = std::make_unique<PatternEditor>();
+    m_mixerWindow = std::make_unique<MixerWindow>();
+    m_timelineWindow = std::make_unique<TimelineWindow>();
+    m_audioSettingsWindow = std::make_unique<AudioSettingsWindow>();
+    m_scopeWindow = std::make_unique<ScopeWindow>();
+    m_spectrumWindow = std::make_unique<SpectrumWindow>();
+    m_vgmExportWindow = std::make_unique<VgmExportWindow>();
+    m_coreBenchmarkWindow = std::make_unique<CoreBenchmarkWindow>();
+    m_monitorTask = std::make_unique<BackgroundTask>();
+    m_cacheTask = std::make_unique<BackgroundTask>();
+    m_liveTask = std::make_unique<BackgroundTask>();
     
     // Apply initial theme (higher-contrast dark)
     Theme::ApplyLight();
@@ -66,9 +128,19 @@ Editor::Editor() : m_unsavedChanges(false), m_isPlaying(false), m_debug(false),
 
 Editor::~Editor() {
     StopMML();
+    // Workers hold players and the cache; stop them before those go away
+    m_monitorTask.reset();
+    m_liveTask.reset();
+    m_cacheTask.reset();
+    m_vgmExportWindow.reset();
+    m_coreBenchmarkWindow.reset();
 }
 
 void Editor::Render() {
+    // Free streams the audio thread is done with (never inside the callback)
+    AudioEngine::Get().CollectGarbage();
+    AudioEngine::Get().GetRecorder().Update();
+
     RenderMenuBar();
     RenderTextEditor();
     //RenderStatusBar();
@@ -79,6 +151,15 @@ void Editor::Render() {
     RenderThemeWindow();
     RenderPCMToolWindow();
     RenderPatternEditor();
+    RenderMixerWindow();
+    RenderTimelineWindow();
+    RenderAudioSettingsWindow();
+    RenderScopeWindow();
+    RenderVgmExportWindow();
+    RenderCoreBenchmarkWindow();
+    if (m_spectrumWindow) {
+        m_spectrumWindow->Render();
+    }
 }
 
 void Editor::RenderMenuBar() {
@@ -132,6 +213,11 @@ void Editor::RenderMenuBar() {
                 m_showThemeWindow = true;
                 m_themeRequestFocus = true;
             }
+            if (ImGui::MenuItem("Audio Settings...")) {
+                if (m_audioSettingsWindow) {
+                    m_audioSettingsWindow->SetOpen(true);
+                }
+            }
             ImGui::EndMenu();
         }
         
@@ -146,6 +232,11 @@ void Editor::RenderMenuBar() {
                     m_mdsBinExportWindow->SetOpen(true);
                 }
             }
+            if (ImGui::MenuItem("VGM export...")) {
+                if (m_vgmExportWindow) {
+                    m_vgmExportWindow->SetOpen(true);
+                }
+            }
             if (ImGui::MenuItem("PCM Tool...")) {
                 if (m_pcmToolWindow) {
                     m_pcmToolWindow->SetOpen(true);
@@ -163,6 +254,31 @@ void Editor::RenderMenuBar() {
                     m_patternEditor->SetOpen(true);
                 }
             }
+            if (ImGui::MenuItem("Channel Mixer...")) {
+                if (m_mixerWindow) {
+                    m_mixerWindow->SetOpen(true);
+                }
+            }
+            if (ImGui::MenuItem("Timeline...")) {
+                if (m_timelineWindow) {
+                    m_timelineWindow->SetOpen(true);
+                }
+            }
+            if (ImGui::MenuItem("Channel Scopes...")) {
+                if (m_scopeWindow) {
+                    m_scopeWindow->SetOpen(true);
+                }
+            }
+            if (ImGui::MenuItem("Spectrum Analyzer...")) {
+                if (m_spectrumWindow) {
+                    m_spectrumWindow->SetOpen(true);
+                }
+            }
+            if (ImGui::MenuItem("YM2612 Core Benchmark...")) {
+                if (m_coreBenchmarkWindow) {
+                    m_coreBenchmarkWindow->SetOpen(true);
+                }
+            }
             ImGui::EndMenu();
         }
         
@@ -241,13 +357,41 @@ void Editor::RenderTextEditor() {
     const float buttonWidth = 80.0f;
     const float buttonHeight = 26.0f;
     float debugWidth = ImGui::GetFrameHeight() + style.ItemInnerSpacing.x + ImGui::CalcTextSize("Debug").x;
-    float clusterWidth = debugWidth + spacing + buttonWidth + spacing + buttonWidth;
+    float clusterWidth = debugWidth + spacing + buttonWidth + spacing + buttonWidth + spacing + buttonWidth;
+
+    // Recording status sits just left of the buttons
+    WavRecorder& recorder = AudioEngine::Get().GetRecorder();
+    std::string recordStatus = m_recordMessage;
+    if (recorder.IsRecording()) {
+        WavRecorder::Stats stats = recorder.GetStats();
+        double seconds = (double)stats.frames / std::max<uint32_t>(1, recorder.GetSampleRate());
+        recordStatus = recorder.IsStopping() ? "Finishing recording..." : "REC";
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer), " %d:%04.1f", (int)seconds / 60, std::fmod(seconds, 60.0));
+        recordStatus += buffer;
+        if (stats.dropped_blocks > 0) {
+            snprintf(buffer, sizeof(buffer), " (%u blocks dropped)", stats.dropped_blocks);
+            recordStatus += buffer;
+        }
+    }
+    if (!recordStatus.empty()) {
+        clusterWidth += ImGui::CalcTextSize(recordStatus.c_str()).x + spacing;
+    }
 
     float startX = ImGui::GetCursorPosX();
     float fullWidth = ImGui::GetContentRegionAvail().x;
     float targetX = startX + std::max(0.0f, fullWidth - clusterWidth - horizontalPadding);
     ImGui::SetCursorPosX(targetX);
 
+    if (!recordStatus.empty()) {
+        ImGui::AlignTextToFramePadding();
+        if (recorder.IsRecording()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", recordStatus.c_str());
+        } else {
+            ImGui::TextUnformatted(recordStatus.c_str());
+        }
+        ImGui::SameLine();
+    }
     ImGui::Checkbox("Debug", &m_debug);
     ImGui::SameLine();
     if (ImGui::Button("Play", ImVec2(buttonWidth, buttonHeight))) {
@@ -260,6 +404,25 @@ void Editor::RenderTextEditor() {
         StopMML();
     }
 
+    ImGui::SameLine();
+
+    bool recording = recorder.IsRecording() && !recorder.IsStopping();
+    if (recording) {
+        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.75f, 0.15f, 0.15f, 1.0f));
+    }
+    if (ImGui::Button(recording ? "Stop Rec" : "Record", ImVec2(buttonWidth, buttonHeight))) {
+        ToggleRecording();
+    }
+    if (recording) {
+        ImGui::PopStyleColor();
+    }
+    if (ImGui::IsItemHovered() && recorder.IsRecording()) {
+        WavRecorder::Stats stats = recorder.GetStats();
+        ImGui::SetTooltip("%s\nDropped: %u blocks (%lld frames)\nMost blocks queued: %d of %d",
+                          recorder.GetPath().c_str(), stats.dropped_blocks, (long long)stats.dropped_frames,
+                          stats.max_fill, WavRecorder::RING_BLOCKS);
+    }
+
     ImGui::End();
 }
 
@@ -593,6 +756,324 @@ void Editor::RenderPatternEditor() {
     }
 }
 
+void Editor::RenderMixerWindow() {
+    if (m_mixerWindow) {
+        m_mixerWindow->Render();
+
+        // Push mute/solo changes straight to the running player; no recompile needed
+        if (m_mixerWindow->GetMuteMask() != m_appliedMuteMask) {
+            ApplyMuteMask();
+        }
+    }
+}
+
+void Editor::ApplyMuteMask() {
+    uint32_t mask = m_mixerWindow ? m_mixerWindow->GetMuteMask() : 0;
+    m_appliedMuteMask = mask;
+
+    // The engine applies the mask on the audio thread before its next buffer,
+    // and keeps it for any player started later.
+    AudioEngine::Get().SetMuteMask(mask);
+    DebugLog("Applied mute mask " + std::to_string(mask));
+
+    // The cached render is the full mix, so muting needs the live emulator
+    // back. The engine switches to its shadow player as the mask arrives;
+    // only without one in step does a fresh player have to catch up.
+    if (mask != 0 && AudioEngine::Get().IsPlayingCachedSong()) {
+        StartLivePlayer(AudioEngine::Get().GetSongFrame(), LIVE_HANDOVER);
+    }
+}
+
+void Editor::RenderTimelineWindow() {
+    if (!m_timelineWindow) return;
+
+    AudioEngine& engine = AudioEngine::Get();
+    if (m_isPlaying && !engine.IsSongPlaying() && !m_livePending) {
+        m_isPlaying = false;
+    }
+    PostLivePlayer();
+
+    // Keep a live player running silently next to the cached render, ready
+    // for a mute. If a mute found none in step, hand over the slow way.
+    if (engine.IsPlayingCachedSong() && !m_livePending && !m_timelineWindow->IsScrubbing()) {
+        if (m_appliedMuteMask != 0) {
+            StartLivePlayer(engine.GetSongFrame(), LIVE_HANDOVER);
+        } else if (!engine.IsShadowing()) {
+            StartLivePlayer(engine.GetSongFrame(), LIVE_SHADOW);
+        }
+    }
+
+    m_timelineWindow->SetCache(m_songCache);
+    m_timelineWindow->SetRenderProgress(m_cacheTask->IsRunning(), m_cacheTask->GetProgress());
+    m_timelineWindow->SetPlayFrame(m_isPlaying ? engine.GetAudibleSongFrame() : -1);
+    m_timelineWindow->Render();
+
+    int64_t frame;
+    bool scrubbing;
+    if (m_timelineWindow->ConsumeSeek(frame, scrubbing)) {
+        SeekTo(frame);
+    }
+}
+
+void Editor::RenderAudioSettingsWindow() {
+    if (!m_audioSettingsWindow) return;
+    m_audioSettingsWindow->Render();
+
+    int sampleRate;
+    if (m_audioSettingsWindow->ConsumeRateChange(sampleRate)) {
+        // Players and previews are set up for one rate; stop everything and
+        // reopen the driver
+        StopMML();
+        AudioEngine::Get().StopAllPreviews();
+        if (AudioEngine::Get().GetRecorder().IsRecording()) {
+            AudioEngine::Get().GetRecorder().Stop();
+            m_recordMessage = "Recording stopped (output rate changed)";
+        }
+        Audio_Manager& audioManager = Audio_Manager::get();
+        Audio_Manager::set_sample_rate(sampleRate);
+        audioManager.set_driver(audioManager.get_driver(), audioManager.get_device());
+        AudioEngine::Get().setup_stream(sampleRate);
+        AudioEngine::Get().ResetStats();
+        DebugLog("Output sample rate changed to " + std::to_string(sampleRate));
+    }
+
+    if (m_audioSettingsWindow->ConsumeCoreChange()) {
+        // Running players keep the core they were started with
+        StopMML();
+        DebugLog(std::string("YM2612 core set to ") + ChipCores::GetName(ChipCores::GetYm2612Core()));
+    }
+}
+
+void Editor::RenderVgmExportWindow() {
+    if (!m_vgmExportWindow) return;
+    m_vgmExportWindow->SetSourcePath(m_filepath);
+    m_vgmExportWindow->Render();
+
+    if (m_vgmExportWindow->ConsumeExportRequest()) {
+        std::shared_ptr<Song> song = CompileSong();
+        if (song) {
+            m_vgmExportWindow->StartExport(song);
+        } else {
+            m_vgmExportWindow->SetError("Compile failed: " + m_songManager->get_error_message());
+        }
+    }
+}
+
+void Editor::RenderCoreBenchmarkWindow() {
+    if (!m_coreBenchmarkWindow) return;
+    m_coreBenchmarkWindow->Render();
+    if (m_coreBenchmarkWindow->ConsumeRunRequest()) {
+        m_coreBenchmarkWindow->Start(m_text);
+    }
+}
+
+void Editor::RenderScopeWindow() {
+    if (!m_scopeWindow) return;
+
+    AudioEngine& engine = AudioEngine::Get();
+    uint32_t mask = m_scopeWindow->GetChannelMask();
+    bool playing = m_isPlaying && engine.IsSongPlaying();
+    bool wanted = m_scopeWindow->IsOpen() && playing && mask != 0;
+
+    // Hand the set to the engine from this thread (single producer) once the
+    // worker has caught up with the song; it keeps feeding the set after that
+    if (m_monitorPending && m_preparedMonitors->ready.load(std::memory_order_acquire)) {
+        m_monitorPending = false;
+        if (wanted && m_monitorMask == mask) {
+            engine.SetMonitors(m_preparedMonitors);
+        }
+        m_preparedMonitors.reset();
+    } else if (m_monitorPending && !m_monitorTask->IsRunning()) {
+        // Cancelled before it was ready
+        m_monitorTask->Join();
+        m_monitorPending = false;
+        m_preparedMonitors.reset();
+    }
+
+    if (!wanted || mask != m_monitorMask) {
+        m_monitorTask->Cancel();
+        engine.ClearMonitors();
+    }
+    // The engine drops a set when the song jumps or ends; stop feeding it
+    if (!m_monitorPending && !engine.IsMonitoring()) {
+        m_monitorTask->Cancel();
+    }
+
+#ifdef __EMSCRIPTEN__
+    // Monitors are rendered by a worker running alongside the song, which
+    // the single-threaded build does not have
+    m_scopeWindow->SetMonitorState(playing, false);
+#else
+    // Monitors drop out whenever the song jumps; rebuild them once the user
+    // has let go of the timeline
+    bool scrubbing = m_timelineWindow && m_timelineWindow->IsScrubbing();
+    if (wanted && !engine.IsMonitoring() && !m_monitorPending && !scrubbing && m_playingSong) {
+        StartMonitors();
+    }
+
+    m_scopeWindow->SetMonitorState(playing, engine.IsMonitoring());
+#endif
+    m_scopeWindow->Render();
+}
+
+void Editor::StartMonitors() {
+    m_monitorMask = m_scopeWindow->GetChannelMask();
+    m_monitorPending = true;
+    m_preparedMonitors = std::make_shared<MonitorSet>();
+
+    std::shared_ptr<MonitorSet> set = m_preparedMonitors;
+    std::shared_ptr<Song> song = m_playingSong;
+    uint32_t mask = m_monitorMask;
+    int64_t lead = (int64_t)AudioEngine::Get().GetSampleRate() * MONITOR_LEAD_MS / 1000;
+
+    m_monitorTask->Start([set, song, mask, lead](BackgroundTask& task) {
+        SetUpMonitorSet(*set, song, mask);
+
+        // Catch up with the song clock, then make sure we are still ahead
+        int64_t target = AudioEngine::Get().GetSongFrame() + lead;
+        while (true) {
+            if (!AdvanceMonitorSet(*set, target, task)) return;
+            int64_t now = AudioEngine::Get().GetSongFrame();
+            if (now + lead / 4 < target) break;
+            target = now + lead;
+        }
+        set->ready.store(true, std::memory_order_release);
+
+        // Then stay ahead of the engine until the set is no longer played
+        FillMonitorSet(*set, task);
+    });
+    DebugLog("Preparing channel monitors");
+}
+
+bool Editor::IsCacheUsable() const {
+    return m_songCache && m_songCache->IsComplete() &&
+           m_songCache->GetSourceHash() == GetCacheKey() &&
+           m_songCache->GetSampleRate() == AudioEngine::Get().GetSampleRate() &&
+           m_timelineWindow && m_timelineWindow->GetPlayFromCache() &&
+           m_appliedMuteMask == 0;
+}
+
+size_t Editor::GetCacheKey() const {
+    // A render made in the other output mode sounds slightly different
+    size_t key = std::hash<std::string>()(m_text);
+    if (AudioEngine::Get().GetNativeRate()) {
+        key ^= (size_t)0x9e3779b9;
+    }
+    // ...as does one made on another YM2612 core
+    key += (size_t)ChipCores::GetYm2612Core() * 0x85ebca6b;
+    return key;
+}
+
+void Editor::StartCacheRender(std::shared_ptr<Song> song, size_t source_hash) {
+    uint32_t rate = AudioEngine::Get().GetSampleRate();
+    m_songCache = std::make_shared<SongCache>(rate, (int64_t)rate * CACHE_MAX_SECONDS, source_hash);
+    if (m_timelineWindow) {
+        m_timelineWindow->SetTempoFromMML(m_text);
+    }
+
+    std::shared_ptr<SongCache> cache = m_songCache;
+    m_cacheTask->Start([song, cache](BackgroundTask& task) {
+        SongCache::Render(song, *cache, task);
+    });
+    DebugLog("Started background render of the song cache");
+}
+
+void Editor::SeekTo(int64_t frame) {
+    AudioEngine& engine = AudioEngine::Get();
+
+    if (engine.IsPlayingCachedSong()) {
+        // A shadow player being prepared is for the old position
+        if (m_livePending && m_liveMode == LIVE_SHADOW) {
+            m_liveTask->Cancel();
+            m_livePending = false;
+        }
+        engine.SeekSong(frame);
+        return;
+    }
+    if (IsCacheUsable()) {
+        m_liveTask->Cancel();
+        m_livePending = false;
+        m_isPlaying = engine.PlayCachedSong(std::make_shared<CachedSongStream>(m_songCache, frame), frame);
+        return;
+    }
+    // Nothing to seek in without a cache: run a fresh player up to the target
+    if (m_playingSong) {
+        StartLivePlayer(frame, LIVE_RESTART);
+    }
+}
+
+void Editor::StartLivePlayer(int64_t frame, LiveMode mode) {
+    if (!m_playingSong) return;
+
+    // Only one live player can be in preparation; a newer request replaces it
+    m_liveTask->Cancel();
+    m_liveTask->Join();
+    m_livePlayer.reset();
+    m_liveStream.reset();
+    m_livePending = true;
+    m_liveMode = mode;
+
+    // Handover and shadow players join a song that keeps playing
+    bool chase = mode != LIVE_RESTART;
+    std::shared_ptr<Song> song = m_playingSong;
+    uint32_t rate = AudioEngine::Get().GetSampleRate();
+    int64_t lead = chase ? (int64_t)rate * HANDOVER_LEAD_MS / 1000 : 0;
+
+#ifdef __EMSCRIPTEN__
+    // A job would run inline and freeze the page for the whole fast-forward;
+    // PostLivePlayer runs the player a slice per frame instead
+    m_livePlayer = std::make_shared<Emu_Player>(song, 0);
+    m_liveStream = AudioEngine::Get().PrepareSong(m_livePlayer);
+    m_liveFrame = 0;
+    m_liveTarget = frame + lead;
+    m_liveLead = lead;
+#else
+    m_liveTask->Start([this, song, frame, lead, chase](BackgroundTask& task) {
+        auto player = std::make_shared<Emu_Player>(song, 0);
+        std::shared_ptr<Audio_Stream> stream = AudioEngine::Get().PrepareSong(player);
+
+        int64_t target = frame + lead;
+        int64_t position = FastForwardLive(*stream, 0, target, lead, chase, [&task]() { return task.IsCancelled(); });
+        if (task.IsCancelled()) return;
+        m_liveFrame = position;
+        m_liveStream = stream;
+        m_livePlayer = player;
+    });
+#endif
+}
+
+void Editor::PostLivePlayer() {
+    if (!m_livePending) return;
+#ifdef __EMSCRIPTEN__
+    if (m_livePlayer) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(LIVE_SLICE_MS);
+        m_liveFrame = FastForwardLive(*m_liveStream, m_liveFrame, m_liveTarget, m_liveLead, m_liveMode != LIVE_RESTART,
+                                      [deadline]() { return std::chrono::steady_clock::now() >= deadline; });
+        if (m_liveFrame < m_liveTarget) return;
+    }
+#else
+    if (m_liveTask->IsRunning()) return;
+    m_liveTask->Join();
+#endif
+    m_livePending = false;
+    if (!m_livePlayer) return;
+
+    AudioEngine& engine = AudioEngine::Get();
+    if (m_liveMode == LIVE_HANDOVER) {
+        engine.HandoverSong(m_livePlayer, m_liveStream, m_liveFrame);
+        DebugLog("Handing over to live player at frame " + std::to_string(m_liveFrame));
+    } else if (m_liveMode == LIVE_SHADOW) {
+        // Dropped if the cached song stopped or jumped in the meantime
+        engine.ShadowSong(m_livePlayer, m_liveStream, m_liveFrame);
+        DebugLog("Shadowing the cached song from frame " + std::to_string(m_liveFrame));
+    } else {
+        m_isPlaying = engine.PlaySong(m_livePlayer, m_liveStream, m_liveFrame);
+        DebugLog("Live player started at frame " + std::to_string(m_liveFrame));
+    }
+    m_livePlayer.reset();
+    m_liveStream.reset();
+}
+
 void Editor::DebugLog(const std::string& message) {
     if (!m_debug) return;
     std::cout << "[Editor DEBUG] " << message << std::endl;
@@ -650,16 +1131,35 @@ void Editor::PlayMML() {
     if (result == Song_Manager::COMPILE_OK) {
         DebugLog("Compilation successful! Starting playback...");
         
-        // Check audio manager status
-        Audio_Manager& am = Audio_Manager::get();
-        
         // Check if we have a song
         auto song = m_songManager->get_song();
+        m_playingSong = song;
         
         try {
-            m_songManager->play(0);
-            m_isPlaying = true;
-            DebugLog("Playback started successfully");
+            if (IsCacheUsable()) {
+                // Already rendered this exact text: play it back from memory
+                auto stream = std::make_shared<CachedSongStream>(m_songCache, 0);
+                m_isPlaying = AudioEngine::Get().PlayCachedSong(stream);
+                DebugLog("Playing from song cache");
+            } else {
+                // The player is built here and handed to the audio engine; the
+                // audio callback picks it up at the start of its next buffer.
+                auto player = std::make_shared<Emu_Player>(song, 0);
+                m_isPlaying = AudioEngine::Get().PlaySong(player);
+            }
+            DebugLog(m_isPlaying ? "Playback started successfully" : "ERROR: Audio engine rejected playback");
+
+            // Refresh the cache in the background whenever the text has changed.
+            // Not on Emscripten, where the render would run inline and hold
+            // up the page for the length of the song.
+#ifndef __EMSCRIPTEN__
+            size_t sourceHash = GetCacheKey();
+            if (!m_songCache || m_songCache->GetSourceHash() != sourceHash ||
+                m_songCache->GetSampleRate() != AudioEngine::Get().GetSampleRate() ||
+                (!m_songCache->IsComplete() && !m_cacheTask->IsRunning())) {
+                StartCacheRender(song, sourceHash);
+            }
+#endif
         } catch (const std::exception& e) {
             DebugLog("ERROR: Exception during play(): " + std::string(e.what()));
             m_isPlaying = false;
@@ -675,10 +1175,72 @@ void Editor::PlayMML() {
     }
 }
 
+std::string Editor::MakeRecordingPath() const {
+    // Next to the MML file (or in the working directory), named by time
+    std::filesystem::path dir = m_filepath.empty() ? std::filesystem::current_path()
+                                                    : std::filesystem::path(m_filepath).parent_path();
+    std::string stem = m_filepath.empty() ? "untitled" : std::filesystem::path(m_filepath).stem().string();
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+    return (dir / (stem + "_rec_" + stamp + ".wav")).string();
+}
+
+void Editor::ToggleRecording() {
+    WavRecorder& recorder = AudioEngine::Get().GetRecorder();
+    if (recorder.IsRecording()) {
+        if (!recorder.IsStopping()) {
+            recorder.Stop();
+            WavRecorder::Stats stats = recorder.GetStats();
+            m_recordMessage = "Saved " + std::filesystem::path(recorder.GetPath()).filename().string();
+            if (stats.dropped_blocks > 0) {
+                m_recordMessage += " (" + std::to_string(stats.dropped_blocks) + " blocks dropped)";
+            }
+        }
+        return;
+    }
+
+    std::string error;
+    std::string path = MakeRecordingPath();
+    if (recorder.Start(path, AudioEngine::Get().GetSampleRate(), error)) {
+        m_recordMessage.clear();
+        DebugLog("Recording to " + path);
+    } else {
+        m_recordMessage = error;
+        DebugLog("ERROR: " + error);
+    }
+}
+
+std::shared_ptr<Song> Editor::CompileSong() {
+    if (!m_songManager) return nullptr;
+
+    std::string filename = m_filepath.empty() ? "untitled.mml" : m_filepath;
+    m_songManager->compile(m_text, filename);
+
+    // Same wait as PlayMML(); compiling is quick next to rendering
+    int timeout = 200;
+    while (m_songManager->get_compile_in_progress() && timeout > 0) {
+        --timeout;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (m_songManager->get_compile_result() != Song_Manager::COMPILE_OK) {
+        DebugLog("ERROR: Compilation failed: " + m_songManager->get_error_message());
+        return nullptr;
+    }
+    return m_songManager->get_song();
+}
+
 void Editor::StopMML() {
+    // Drop any live player still being prepared for a seek or handover
+    if (m_liveTask) {
+        m_liveTask->Cancel();
+    }
+    m_livePending = false;
+
     if (m_songManager && m_isPlaying) {
         DebugLog("Stopping playback...");
-        m_songManager->stop();
+        AudioEngine::Get().StopSong();
         m_isPlaying = false;
         m_highlights.clear(); // Clear highlights when stopping
         DebugLog("Playback stopped");
@@ -7,6 +7,7 @@
 #include <list>
 #include <map>
 #include <unordered_set>
+#include <cstdint>
 #include "config.h"
 
 // Forward declarations
@@ -15,6 +16,18 @@ class ExportWindow;
 class PCMToolWindow;
 class MDSBinExportWindow;
 class PatternEditor;
+class MixerWindow;
+class TimelineWindow;
+class AudioSettingsWindow;
+class ScopeWindow;
+class SpectrumWindow;
+class VgmExportWindow;
+class CoreBenchmarkWindow;
+struct MonitorSet;
+class SongCache;
+class BackgroundTask;
+class Emu_Player;
+class Audio_Stream;
 class Song;
 
 class Editor {
@@ -40,8 +53,46 @@ private:
     std::unique_ptr<PCMToolWindow> m_pcmToolWindow;
     std::unique_ptr<MDSBinExportWindow> m_mdsBinExportWindow;
     std::unique_ptr<PatternEditor> m_patternEditor;
+    std::unique_ptr<MixerWindow> m_mixerWindow;
+    std::unique_ptr<TimelineWindow> m_timelineWindow;
+    std::unique_ptr<AudioSettingsWindow> m_audioSettingsWindow;
+    std::unique_ptr<ScopeWindow> m_scopeWindow;
+    std::unique_ptr<SpectrumWindow> m_spectrumWindow;
+    std::unique_ptr<VgmExportWindow> m_vgmExportWindow;
+    std::unique_ptr<CoreBenchmarkWindow> m_coreBenchmarkWindow;
     std::list<std::shared_ptr<PCMToolWindow>> m_pcmToolWindows;
     bool m_isPlaying;
+    uint32_t m_appliedMuteMask; // Mute mask last pushed to the player
+
+    // Pre-rendered song for the timeline and instant seeking
+    std::shared_ptr<SongCache> m_songCache;
+    std::unique_ptr<BackgroundTask> m_cacheTask;
+    std::shared_ptr<Song> m_playingSong;
+
+    // What a live player being prepared is for
+    enum LiveMode {
+        LIVE_RESTART,   // Start playing at m_liveFrame (seek without a cache)
+        LIVE_HANDOVER,  // Take over from the cached render at m_liveFrame
+        LIVE_SHADOW,    // Run silently next to the cached render, so mutes are instant
+    };
+
+    // Live player being fast-forwarded on a worker; posted to the engine from
+    // the UI thread once ready (the command queue has a single producer).
+    std::unique_ptr<BackgroundTask> m_liveTask;
+    std::shared_ptr<Emu_Player> m_livePlayer;
+    std::shared_ptr<Audio_Stream> m_liveStream;
+    int64_t m_liveFrame;
+    int64_t m_liveTarget;   // Emscripten only: where the sliced fast-forward is heading
+    int64_t m_liveLead;
+    LiveMode m_liveMode;
+    bool m_livePending;
+
+    // Per-channel monitor players, prepared on a worker like the live player
+    std::unique_ptr<BackgroundTask> m_monitorTask;
+    std::shared_ptr<MonitorSet> m_preparedMonitors;
+    uint32_t m_monitorMask;     // Channels of the set being prepared or played
+    bool m_monitorPending;
+    std::string m_recordMessage;    // Last recording result, shown in the control bar
     bool m_debug;
     bool m_showThemeWindow;
     bool m_themeRequestFocus;
@@ -72,9 +123,26 @@ private:
     void RenderThemeWindow();
     void RenderPCMToolWindow();
     void RenderPatternEditor();
+    void RenderMixerWindow();
+    void RenderTimelineWindow();
+    void RenderAudioSettingsWindow();
+    void RenderScopeWindow();
+    void RenderVgmExportWindow();
+    void RenderCoreBenchmarkWindow();
+    void StartMonitors();
+    void ToggleRecording();
+    std::string MakeRecordingPath() const;
     bool CheckUnsavedChanges();
     void UpdateBuffer();
     void PlayMML();
+    std::shared_ptr<Song> CompileSong();
+    void ApplyMuteMask();
+    bool IsCacheUsable() const;
+    size_t GetCacheKey() const;
+    void StartCacheRender(std::shared_ptr<Song> song, size_t source_hash);
+    void SeekTo(int64_t frame);
+    void StartLivePlayer(int64_t frame, LiveMode mode);
+    void PostLivePlayer();
     void DebugLog(const std::string& message);
     
     // Note highlighting during playback
@@ -83,6 +151,8 @@ private:
     
     // Helper for macro highlighting
     static unsigned int GetSubroutineLengthHelper(Song& song, unsigned int param, unsigned int max_recursion);
+
+    friend class UiFrameBench;  // ui_bench.cpp opens the tool windows directly
 };
 
 #endif // EDITOR_H
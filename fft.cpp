@@ -0,0 +1,106 @@
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double PI = 3.14159265358979323846;
+}
+
+FFT::FFT(int size) : m_size(0), m_window_type(WINDOW_RECTANGULAR), m_window_gain(1.0f)
+{
+    Resize(size);
+}
+
+void FFT::Resize(int size)
+{
+    int n = 1;
+    int bits = 0;
+    while (n < size) {
+        n <<= 1;
+        ++bits;
+    }
+    if (n == m_size) return;
+    m_size = n;
+
+    m_twiddles.resize(n / 2);
+    for (int i = 0; i < n / 2; ++i) {
+        double angle = -2.0 * PI * i / n;
+        m_twiddles[i] = std::complex<float>((float)std::cos(angle), (float)std::sin(angle));
+    }
+
+    m_bit_reverse.resize(n);
+    for (int i = 0; i < n; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bit_reverse[i] = reversed;
+    }
+
+    m_buffer.resize(n);
+    m_window.clear();   // Rebuilt on next use
+}
+
+void FFT::Transform(std::complex<float>* data) const
+{
+    const int n = m_size;
+    for (int i = 0; i < n; ++i) {
+        int j = m_bit_reverse[i];
+        if (j > i) std::swap(data[i], data[j]);
+    }
+
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len / 2;
+        int stride = n / len;
+        for (int start = 0; start < n; start += len) {
+            for (int k = 0; k < half; ++k) {
+                std::complex<float> w = m_twiddles[k * stride];
+                std::complex<float> a = data[start + k];
+                std::complex<float> b = data[start + k + half] * w;
+                data[start + k] = a + b;
+                data[start + k + half] = a - b;
+            }
+        }
+    }
+}
+
+void FFT::MakeWindow(Window window, int size, std::vector<float>& out)
+{
+    out.resize(size);
+    for (int i = 0; i < size; ++i) {
+        double x = 2.0 * PI * i / size;
+        switch (window) {
+        case WINDOW_HANN:
+            out[i] = (float)(0.5 - 0.5 * std::cos(x));
+            break;
+        case WINDOW_BLACKMAN_HARRIS:
+            out[i] = (float)(0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x));
+            break;
+        default:
+            out[i] = 1.0f;
+            break;
+        }
+    }
+}
+
+void FFT::PowerSpectrum(const float* input, Window window, float* power)
+{
+    if (m_window.size() != (size_t)m_size || window != m_window_type) {
+        MakeWindow(window, m_size, m_window);
+        m_window_type = window;
+        double sum = 0.0;
+        for (float w : m_window) sum += w;
+        // Coherent gain: a sine of amplitude 1 gives |X| = sum / 2
+        m_window_gain = (float)(sum / 2.0);
+    }
+
+    for (int i = 0; i < m_size; ++i) {
+        m_buffer[i] = std::complex<float>(input[i] * m_window[i], 0.0f);
+    }
+    Transform(m_buffer.data());
+
+    float scale = 1.0f / (m_window_gain * m_window_gain);
+    for (int i = 0; i <= m_size / 2; ++i) {
+        power[i] = std::norm(m_buffer[i]) * scale;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// In-place iterative radix-2 FFT with precomputed twiddles and bit-reversal
+// table. Sizes are powers of two; one instance is reused for one size.
+class FFT {
+public:
+    enum Window {
+        WINDOW_RECTANGULAR,
+        WINDOW_HANN,
+        WINDOW_BLACKMAN_HARRIS
+    };
+
+    explicit FFT(int size = 1024);
+
+    void Resize(int size);
+    int GetSize() const { return m_size; }
+
+    // Forward transform of data (GetSize() values)
+    void Transform(std::complex<float>* data) const;
+
+    // Window the real input, transform it, and write GetSize()/2 + 1 power
+    // values (|X|^2, normalised so a full-scale sine peaks near 1.0).
+    void PowerSpectrum(const float* input, Window window, float* power);
+
+    static void MakeWindow(Window window, int size, std::vector<float>& out);
+
+private:
+    int m_size;
+    std::vector<std::complex<float>> m_twiddles;
+    std::vector<int> m_bit_reverse;
+
+    // Scratch for PowerSpectrum
+    Window m_window_type;
+    std::vector<float> m_window;
+    float m_window_gain;
+    std::vector<std::complex<float>> m_buffer;
+};
+
+#endif // FFT_H
@@ -0,0 +1,77 @@
+// Replay driver for the fuzz targets on compilers without libFuzzer. Runs
+// every file given (directories are walked) through LLVMFuzzerTestOneInput
+// once and reports throughput, so the seed corpus and any crash reproducers
+// can be checked with a regular build.
+//
+//   fuzz_<target> [--slow-ms N] <file or dir>...
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int main(int argc, char** argv)
+{
+    double slow_ms = 1000.0;
+    std::vector<fs::path> inputs;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--slow-ms" && i + 1 < argc) {
+            slow_ms = std::atof(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '-') {
+            // libFuzzer flags passed by the run_fuzz_* targets
+            continue;
+        } else if (fs::is_directory(arg)) {
+            for (const auto& item : fs::recursive_directory_iterator(arg)) {
+                if (item.is_regular_file()) inputs.push_back(item.path());
+            }
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        fprintf(stderr, "usage: %s [--slow-ms N] <file or dir>...\n", argv[0]);
+        return 2;
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    size_t total_bytes = 0;
+    size_t slow = 0;
+    double total_ms = 0.0;
+    double slowest_ms = 0.0;
+    fs::path slowest;
+    for (const fs::path& path : inputs) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        auto start = std::chrono::steady_clock::now();
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        total_ms += ms;
+        total_bytes += data.size();
+        if (ms > slowest_ms) {
+            slowest_ms = ms;
+            slowest = path;
+        }
+        if (ms > slow_ms) {
+            fprintf(stderr, "SLOW %s: %.1f ms\n", path.string().c_str(), ms);
+            ++slow;
+        }
+    }
+
+    double seconds = total_ms / 1000.0;
+    printf("%zu inputs, %.2f MB in %.3f s: %.0f execs/s, %.2f MB/s\n", inputs.size(), total_bytes / 1e6, seconds,
+           seconds > 0.0 ? inputs.size() / seconds : 0.0, seconds > 0.0 ? total_bytes / 1e6 / seconds : 0.0);
+    printf("slowest: %s (%.1f ms)\n", slowest.string().c_str(), slowest_ms);
+    return slow ? 1 : 0;
+}
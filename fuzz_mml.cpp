@@ -0,0 +1,34 @@
+// libFuzzer target for the MML compile path: the input is compiled line by
+// line as the editor does, then converted to MDSDRV sequence data.
+// Compile errors are expected and ignored; crashes and hangs are not.
+// Built with -DMDSDRV_EDITOR_BUILD_FUZZ=ON.
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include "mml_input.h"
+#include "platform/mdsdrv.h"
+#include "riff.h"
+#include "song.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    std::string text((const char*)data, size);
+    try {
+        Song song;
+        MML_Input input(&song);
+        size_t start = 0;
+        int line = 1;
+        while (start <= text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) end = text.size();
+            input.read_line(text.substr(start, end - start), line++);
+            start = end + 1;
+        }
+        MDSDRV_Converter converter(song);
+        RIFF mds = converter.get_mds();
+        (void)mds;
+    } catch (std::exception&) {
+    }
+    return 0;
+}
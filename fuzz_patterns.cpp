@@ -0,0 +1,32 @@
+// libFuzzer target for the pattern editor's MML parsing: the input is treated
+// as an editor document, scanned for *7xx pattern macros, and each pattern
+// found is loaded into the grid. Built with -DMDSDRV_EDITOR_BUILD_FUZZ=ON.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "pattern_editor.h"
+
+namespace {
+// LoadPattern rebuilds the grid; a handful per input covers it without
+// letting a document full of macros dominate the run time
+const size_t MAX_LOADS = 8;
+} // namespace
+
+// Friend of PatternEditor, so the private parsers can be driven directly
+class PatternFuzzer {
+public:
+    static void Run(const std::string& text)
+    {
+        PatternEditor editor;
+        std::vector<PatternEditor::PatternInfo> patterns = editor.ScanForPatterns(text);
+        for (size_t i = 0; i < patterns.size() && i < MAX_LOADS; ++i) {
+            editor.LoadPattern(patterns[i]);
+        }
+    }
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    PatternFuzzer::Run(std::string((const char*)data, size));
+    return 0;
+}
@@ -0,0 +1,21 @@
+// libFuzzer target for the WAV decoder behind PCMToolWindow::LoadFile.
+// Built with -DMDSDRV_EDITOR_BUILD_FUZZ=ON; see README.md.
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include "audio_file.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    std::istringstream in(std::string((const char*)data, size), std::ios::binary);
+    DecodedAudio audio;
+    std::string error;
+    if (DecodeWav(in, audio, error)) {
+        // A successful decode never returns more frames than the input holds
+        if (audio.samples.empty() || audio.samples.size() > size) __builtin_trap();
+    } else if (error.empty()) {
+        __builtin_trap();
+    }
+    return 0;
+}
@@ -0,0 +1,294 @@
+// Golden-render regression check. Renders a corpus of MML songs through the
+// emulated chips, one solo pass per channel, and compares per-block hashes
+// against stored goldens. Built with -DMDSDRV_EDITOR_BUILD_GOLDEN=ON.
+//
+//   golden_render [--update] [--seconds N] [--jobs N] [--core gpgx|nuked|mame] <dir>
+//
+// The corpus is the built-in benchmark songs plus every .mml file in <dir>;
+// goldens are stored in <dir> as <song>.golden. --update rewrites them.
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "channel_layout.h"
+#include "chip_cores.h"
+#include "core_benchmark.h"
+#include "emu_player.h"
+#include "song.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+const uint32_t SAMPLE_RATE = 44100;
+const int BLOCK_FRAMES = 1024;      // About 23 ms; the resolution of a reported mismatch
+const int FORMAT_VERSION = 1;
+
+// Emulator output is 16-bit audio scaled up by 8 bits
+const int SAMPLE_SHIFT = 8;
+
+struct Options {
+    bool update = false;
+    int seconds = 30;
+    int jobs = 0;
+    ChipCores::Ym2612Core core = ChipCores::YM2612_GPGX;
+    std::string dir;
+};
+
+struct Entry {
+    std::string name;
+    std::string mml;
+    std::shared_ptr<Song> song;
+    // [channel][block]
+    std::vector<std::vector<uint64_t>> hashes;
+};
+
+uint64_t HashBlock(const WAVE_32BS* frames, int count)
+{
+    // FNV-1a over the 16-bit samples, so changes below audibility still show
+    uint64_t hash = 1469598103934665603ull;
+    for (int i = 0; i < count; ++i) {
+        int16_t samples[2] = { (int16_t)(frames[i].L >> SAMPLE_SHIFT), (int16_t)(frames[i].R >> SAMPLE_SHIFT) };
+        const uint8_t* bytes = (const uint8_t*)samples;
+        for (size_t b = 0; b < sizeof(samples); ++b) {
+            hash = (hash ^ bytes[b]) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+std::vector<uint64_t> RenderChannel(std::shared_ptr<Song> song, int channel, int seconds, ChipCores::Ym2612Core core)
+{
+    ChipCores::ScopedYm2612Core scoped(core);
+    std::shared_ptr<Emu_Player> player = std::make_shared<Emu_Player>(song, 0);
+    player->set_mute_mask(~ChannelLayout::TrackBit(channel));
+    player->setup_stream(SAMPLE_RATE);
+
+    int64_t frames = (int64_t)seconds * SAMPLE_RATE;
+    std::vector<WAVE_32BS> buffer(BLOCK_FRAMES);
+    std::vector<uint64_t> hashes;
+    hashes.reserve((size_t)(frames / BLOCK_FRAMES + 1));
+    for (int64_t done = 0; done < frames; done += BLOCK_FRAMES) {
+        int count = (int)std::min<int64_t>(BLOCK_FRAMES, frames - done);
+        std::memset(buffer.data(), 0, sizeof(WAVE_32BS) * count);
+        player->get_sample(buffer.data(), count, 2);
+        hashes.push_back(HashBlock(buffer.data(), count));
+    }
+    return hashes;
+}
+
+std::string GoldenHeader(const Options& options)
+{
+    std::ostringstream out;
+    out << "mdsdrv-golden " << FORMAT_VERSION << " rate=" << SAMPLE_RATE << " block=" << BLOCK_FRAMES
+        << " seconds=" << options.seconds << " core=" << ChipCores::GetConfigKey(options.core);
+    return out.str();
+}
+
+bool WriteGolden(const fs::path& path, const Entry& entry, const Options& options)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+    out << GoldenHeader(options) << "\n";
+    for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+        out << ChannelLayout::CHANNELS[ch].name;
+        char hex[20];
+        for (uint64_t hash : entry.hashes[ch]) {
+            snprintf(hex, sizeof(hex), " %016llx", (unsigned long long)hash);
+            out << hex;
+        }
+        out << "\n";
+    }
+    return (bool)out;
+}
+
+// One block hash as written by WriteGolden; false for anything else
+bool ParseHash(const std::string& hex, uint64_t& hash)
+{
+    if (hex.empty() || hex.size() > 16) return false;
+    hash = 0;
+    for (char c : hex) {
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0) return false;
+        hash = hash << 4 | (uint64_t)digit;
+    }
+    return true;
+}
+
+// Returns an empty string if the golden matches, otherwise a description
+std::string CompareGolden(const fs::path& path, const Entry& entry, const Options& options)
+{
+    std::ifstream in(path);
+    if (!in) return "no golden (run with --update on a known-good build)";
+
+    std::string line;
+    std::getline(in, line);
+    if (line != GoldenHeader(options)) {
+        return "golden was made with different settings: " + line;
+    }
+
+    int64_t first_block = -1;
+    std::string first_channel;
+    for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) {
+        if (!std::getline(in, line)) return "golden is truncated";
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+        if (name != ChannelLayout::CHANNELS[ch].name) return "golden channel order differs";
+
+        std::string hex;
+        size_t block = 0;
+        const std::vector<uint64_t>& hashes = entry.hashes[ch];
+        while (fields >> hex && block < hashes.size()) {
+            uint64_t hash = 0;
+            if (!ParseHash(hex, hash)) return "golden is corrupt: bad hash \"" + hex + "\" on " + name;
+            if (hash != hashes[block]) break;
+            ++block;
+        }
+        if (block < hashes.size() && (first_block < 0 || (int64_t)block < first_block)) {
+            first_block = (int64_t)block;
+            first_channel = name;
+        } else if (block < hashes.size() && (int64_t)block == first_block) {
+            first_channel += ", " + name;
+        }
+    }
+    if (first_block < 0) return std::string();
+
+    char message[160];
+    double start = (double)first_block * BLOCK_FRAMES / SAMPLE_RATE;
+    snprintf(message, sizeof(message), "first difference at %.3f s (block %lld, %.3f-%.3f s) on ",
+             start, (long long)first_block, start, start + (double)BLOCK_FRAMES / SAMPLE_RATE);
+    return message + first_channel;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--update") {
+            options.update = true;
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--core" && i + 1 < argc) {
+            options.core = ChipCores::FromConfigKey(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-' && options.dir.empty()) {
+            options.dir = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.dir.empty();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::cerr << "usage: golden_render [--update] [--seconds N] [--jobs N] [--core gpgx|nuked|mame] <dir>" << std::endl;
+        return 2;
+    }
+
+    // Corpus: the built-in songs, then the directory's .mml files in name order
+    std::vector<Entry> entries;
+    for (const CoreBenchmarkSong& song : GetCoreBenchmarkCorpus()) {
+        std::string name = song.name;
+        std::replace(name.begin(), name.end(), ' ', '_');
+        entries.push_back(Entry{ "builtin_" + name, song.mml });
+    }
+    std::vector<fs::path> files;
+    int golden_count = 0;
+    if (fs::is_directory(options.dir)) {
+        for (const auto& item : fs::directory_iterator(options.dir)) {
+            if (!item.is_regular_file()) continue;
+            if (item.path().extension() == ".mml") files.push_back(item.path());
+            if (item.path().extension() == ".golden") ++golden_count;
+        }
+    } else if (!options.update) {
+        std::cerr << "No such directory: " << options.dir << std::endl;
+        return 2;
+    }
+    // Checking against nothing would fail every song after rendering them
+    // all; say what is actually wrong instead
+    if (!options.update && golden_count == 0) {
+        std::cerr << "No .golden files in " << options.dir
+                  << ": render them with --update (golden_update) on a known-good build and commit them" << std::endl;
+        return 2;
+    }
+    std::sort(files.begin(), files.end());
+    for (const fs::path& file : files) {
+        std::ifstream in(file);
+        std::stringstream text;
+        text << in.rdbuf();
+        entries.push_back(Entry{ file.stem().string(), text.str() });
+    }
+
+    // Compile up front; Song_Manager is not meant to be driven from many threads
+    int failures = 0;
+    for (Entry& entry : entries) {
+        std::string error;
+        entry.song = CompileBenchmarkSong(entry.mml, error);
+        if (!entry.song) {
+            std::cout << "FAIL " << entry.name << ": compile error: " << error << std::endl;
+            ++failures;
+        }
+        entry.hashes.resize(ChannelLayout::COUNT);
+    }
+
+    // Every (song, channel) pair is an independent render
+    std::vector<std::pair<size_t, int>> jobs;
+    for (size_t e = 0; e < entries.size(); ++e) {
+        if (!entries[e].song) continue;
+        for (int ch = 0; ch < ChannelLayout::COUNT; ++ch) jobs.emplace_back(e, ch);
+    }
+    int thread_count = options.jobs > 0 ? options.jobs : (int)std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t j = next++; j < jobs.size(); j = next++) {
+                Entry& entry = entries[jobs[j].first];
+                entry.hashes[jobs[j].second] = RenderChannel(entry.song, jobs[j].second, options.seconds, options.core);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    if (options.update) {
+        fs::create_directories(options.dir);
+    }
+    for (const Entry& entry : entries) {
+        if (!entry.song) continue;
+        fs::path golden = fs::path(options.dir) / (entry.name + ".golden");
+        if (options.update) {
+            if (WriteGolden(golden, entry, options)) {
+                std::cout << "UPDATED " << entry.name << std::endl;
+            } else {
+                std::cout << "FAIL " << entry.name << ": could not write " << golden.string() << std::endl;
+                ++failures;
+            }
+            continue;
+        }
+        std::string problem = CompareGolden(golden, entry, options);
+        if (problem.empty()) {
+            std::cout << "ok   " << entry.name << std::endl;
+        } else {
+            std::cout << "FAIL " << entry.name << ": " << problem << std::endl;
+            ++failures;
+        }
+    }
+
+    std::cout << entries.size() << " songs, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
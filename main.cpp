@@ -3,6 +3,8 @@
 #include "theme.h"
 #include "config.h"
 #include "deps/mmlgui/src/audio_manager.h"
+#include "audio_engine.h"
+#include "chip_cores.h"
 #include <iostream>
 
 #ifdef __EMSCRIPTEN__
@@ -12,10 +14,16 @@
 #endif
 
 int main() {
+    UserConfig userConfig = LoadUserConfig();
+
     // Initialize Audio_Manager
     Audio_Manager& audioManager = Audio_Manager::get();
-    audioManager.set_sample_rate(44100);
-    std::cout << "[Main] Audio_Manager initialized with sample rate: 44100" << std::endl;
+    audioManager.set_sample_rate(userConfig.audioSampleRate);
+    std::cout << "[Main] Audio_Manager initialized with sample rate: " << userConfig.audioSampleRate << std::endl;
+    AudioEngine::Get().SetBlockFrames(userConfig.audioBufferFrames);
+    AudioEngine::Get().SetNativeRate(userConfig.audioNativeRate);
+    AudioEngine::Get().SetVisualOffsetMs(userConfig.audioVisualOffsetMs);
+    ChipCores::SetYm2612Core(ChipCores::FromConfigKey(userConfig.audioYm2612Core));
     
     // Set the audio driver - use the first available driver
     // On macOS this will be Core Audio, on Linux it will be PulseAudio or ALSA
@@ -31,11 +39,12 @@ int main() {
         std::cout << "[Main] WARNING: No audio drivers available!" << std::endl;
     }
     
+    // All playback goes through the engine's single stream
+    AudioEngine::Get().Start();
+    
     std::cout << "[Main] Audio enabled: " << (audioManager.get_audio_enabled() ? "yes" : "no") << std::endl;
     std::cout << "[Main] Audio driver: " << audioManager.get_driver() << std::endl;
     std::cout << "[Main] Audio device: " << audioManager.get_device() << std::endl;
-    
-    UserConfig userConfig = LoadUserConfig();
 
     Window window;
     if (!window.Initialize(userConfig.windowWidth, userConfig.windowHeight, "MDSDRV Editor")) {
@@ -0,0 +1,113 @@
+#include "mixer_window.h"
+#include <imgui.h>
+#include <string>
+
+MixerWindow::MixerWindow() : m_mute_mask(0), m_open(false), m_request_focus(false)
+{
+    for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+        m_mute[i] = false;
+        m_solo[i] = false;
+    }
+}
+
+void MixerWindow::UpdateMuteMask()
+{
+    bool any_solo = false;
+    for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+        any_solo |= m_solo[i];
+    }
+
+    // With any channel soloed, everything that isn't soloed is silenced
+    uint32_t mask = 0;
+    for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+        bool silenced = any_solo ? !m_solo[i] : m_mute[i];
+        if (silenced) {
+            mask |= ChannelLayout::TrackBit(i);
+        }
+    }
+    m_mute_mask = mask;
+}
+
+bool MixerWindow::ToggleButton(const char* label, bool active, const ImVec4& active_color)
+{
+    if (active) {
+        ImGui::PushStyleColor(ImGuiCol_Button, active_color);
+        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, active_color);
+    }
+    bool clicked = ImGui::Button(label, ImVec2(ImGui::GetFrameHeight() * 1.4f, 0));
+    if (active) {
+        ImGui::PopStyleColor(2);
+    }
+    return clicked;
+}
+
+void MixerWindow::Render()
+{
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(640, 150), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("Channel Mixer", &m_open)) {
+        const ImVec4 mute_color(0.85f, 0.25f, 0.20f, 1.0f);
+        const ImVec4 solo_color(0.90f, 0.75f, 0.15f, 1.0f);
+        bool changed = false;
+
+        for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+            const ChannelLayout::Channel& channel = ChannelLayout::CHANNELS[i];
+
+            // Leave a gap between the chips so the strip reads as FM | PSG | PCM
+            if (i > 0) {
+                bool new_chip = channel.chip != ChannelLayout::CHANNELS[i - 1].chip;
+                ImGui::SameLine(0.0f, new_chip ? 18.0f : -1.0f);
+            }
+
+            ImGui::PushID(i);
+            ImGui::BeginGroup();
+
+            bool audible = IsChannelAudible(i);
+            ImGui::TextColored(audible ? ImGui::GetStyleColorVec4(ImGuiCol_Text)
+                                       : ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled),
+                               "%s", channel.name);
+            ImGui::TextDisabled("(%c)", channel.track);
+
+            if (ToggleButton("M", m_mute[i], mute_color)) {
+                m_mute[i] = !m_mute[i];
+                changed = true;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Mute %s", channel.name);
+            }
+            if (ToggleButton("S", m_solo[i], solo_color)) {
+                m_solo[i] = !m_solo[i];
+                changed = true;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Solo %s", channel.name);
+            }
+
+            ImGui::EndGroup();
+            ImGui::PopID();
+        }
+
+        ImGui::Separator();
+        if (ImGui::Button("Reset")) {
+            for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+                m_mute[i] = false;
+                m_solo[i] = false;
+            }
+            changed = true;
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("Changes apply to the running song without recompiling.");
+
+        if (changed) {
+            UpdateMuteMask();
+        }
+    }
+    ImGui::End();
+}
@@ -0,0 +1,35 @@
+#ifndef MIXER_WINDOW_H
+#define MIXER_WINDOW_H
+
+#include <cstdint>
+#include "channel_layout.h"
+
+// Forward declaration for ImGui color type
+struct ImVec4;
+
+// Mute/solo strip for the FM, PSG and PCM channels of the playing song.
+class MixerWindow {
+public:
+    MixerWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+    // Effective driver mute mask (solo wins over mute)
+    uint32_t GetMuteMask() const { return m_mute_mask; }
+    bool IsChannelAudible(int channel) const { return (m_mute_mask & ChannelLayout::TrackBit(channel)) == 0; }
+
+private:
+    void UpdateMuteMask();
+    bool ToggleButton(const char* label, bool active, const ImVec4& active_color);
+
+    bool m_mute[ChannelLayout::COUNT];
+    bool m_solo[ChannelLayout::COUNT];
+    uint32_t m_mute_mask;
+
+    bool m_open;
+    bool m_request_focus;
+};
+
+#endif // MIXER_WINDOW_H
@@ -0,0 +1,188 @@
+#include "onset_detector.h"
+#include <algorithm>
+#include <cmath>
+#include "background_task.h"
+#include "fft.h"
+
+namespace {
+const int FRAME_SIZE = 1024;
+const int HOP_SIZE = FRAME_SIZE / 4;
+
+// Magnitudes go through log(1 + LOG_GAIN * |X|), so quiet hits count too
+const float LOG_GAIN = 1000.0f;
+
+// Frames either side averaged for the adaptive threshold
+const int THRESHOLD_FRAMES = 8;
+
+// A peak must be the largest within this many frames either side
+const int PEAK_FRAMES = 3;
+
+// Margin above the running mean, as a fraction of the largest flux, at
+// sensitivity 0 and 1; in between it falls geometrically
+const float MARGIN_LOW_SENSITIVITY = 0.5f;
+const float MARGIN_HIGH_SENSITIVITY = 0.01f;
+
+// No two onsets closer than this
+const double MIN_GAP_SECONDS = 0.05;
+
+// The attack is looked for in blocks of this many samples
+const int ATTACK_BLOCK = 32;
+
+const double MIN_BPM = 80.0;
+const double MAX_BPM = 160.0;
+
+// Progress split between the spectral pass and everything after it
+const float FLUX_PROGRESS = 0.9f;
+
+// Offset of the sharpest energy rise in [from, to), in ATTACK_BLOCK steps
+size_t FindAttack(const short* samples, size_t from, size_t to)
+{
+    size_t best = from;
+    double best_rise = 0.0;
+    double previous = -1.0;
+    for (size_t block = from; block + ATTACK_BLOCK <= to; block += ATTACK_BLOCK) {
+        double energy = 0.0;
+        for (size_t i = block; i < block + ATTACK_BLOCK; ++i) {
+            energy += (double)samples[i] * samples[i];
+        }
+        if (previous >= 0.0 && energy - previous > best_rise) {
+            best_rise = energy - previous;
+            best = block;
+        }
+        previous = energy;
+    }
+    return best;
+}
+
+// Tempo from the onset strength's autocorrelation, 0 if it has no peak
+double EstimateBpm(const std::vector<float>& flux, int sample_rate)
+{
+    double frames_per_minute = 60.0 * sample_rate / HOP_SIZE;
+    int min_lag = std::max(1, (int)std::floor(frames_per_minute / (MAX_BPM * 2.0)));
+    int max_lag = (int)std::ceil(frames_per_minute / (MIN_BPM / 2.0));
+    if ((int)flux.size() < max_lag * 2) {
+        max_lag = (int)flux.size() / 2;
+    }
+    if (max_lag <= min_lag + 1) return 0.0;
+
+    std::vector<double> correlation(max_lag + 2, 0.0);
+    for (int lag = min_lag - 1; lag <= max_lag + 1; ++lag) {
+        double sum = 0.0;
+        for (size_t i = lag; i < flux.size(); ++i) {
+            sum += (double)flux[i] * flux[i - lag];
+        }
+        correlation[lag] = sum / (flux.size() - lag);
+    }
+
+    int best = 0;
+    for (int lag = min_lag; lag <= max_lag; ++lag) {
+        if (best == 0 || correlation[lag] > correlation[best]) best = lag;
+    }
+    if (best == 0 || correlation[best] <= 0.0) return 0.0;
+
+    // Parabolic interpolation between neighbouring lags
+    double lag = best;
+    double a = correlation[best - 1], b = correlation[best], c = correlation[best + 1];
+    if (a - 2.0 * b + c < 0.0) {
+        lag += 0.5 * (a - c) / (a - 2.0 * b + c);
+    }
+    double bpm = frames_per_minute / lag;
+    while (bpm < MIN_BPM) bpm *= 2.0;
+    while (bpm > MAX_BPM) bpm /= 2.0;
+    return bpm;
+}
+
+// Move onsets onto the nearest step of a grid anchored at the first onset
+void SnapToGrid(std::vector<size_t>& onsets, double step, size_t count)
+{
+    if (onsets.empty() || step <= 0.0) return;
+    double origin = (double)onsets[0];
+    std::vector<size_t> snapped;
+    for (size_t onset : onsets) {
+        double position = origin + std::round((onset - origin) / step) * step;
+        if (position < 0.0 || position >= (double)count) continue;
+        size_t sample = (size_t)std::llround(position);
+        if (snapped.empty() || sample > snapped.back()) snapped.push_back(sample);
+    }
+    onsets.swap(snapped);
+}
+} // namespace
+
+bool DetectOnsets(const short* samples, size_t count, int sample_rate, const OnsetSettings& settings,
+                  OnsetResult& result, BackgroundTask* task)
+{
+    result.onsets.clear();
+    result.bpm = 0.0;
+    if (count < (size_t)FRAME_SIZE || sample_rate <= 0) return true;
+
+    // Spectral flux: summed rise in log magnitude from one frame to the next
+    FFT fft(FRAME_SIZE);
+    const int bins = FRAME_SIZE / 2 + 1;
+    std::vector<float> frame(FRAME_SIZE);
+    std::vector<float> power(bins);
+    std::vector<float> magnitude(bins, 0.0f);
+    std::vector<float> previous(bins, 0.0f);
+    size_t frames = (count - FRAME_SIZE) / HOP_SIZE + 1;
+    std::vector<float> flux(frames, 0.0f);
+    for (size_t f = 0; f < frames; ++f) {
+        if (task && (f & 63) == 0) {
+            if (task->IsCancelled()) return false;
+            task->SetProgress(FLUX_PROGRESS * f / frames);
+        }
+        const short* input = samples + f * HOP_SIZE;
+        for (int i = 0; i < FRAME_SIZE; ++i) {
+            frame[i] = input[i] * (1.0f / 32768.0f);
+        }
+        fft.PowerSpectrum(frame.data(), FFT::WINDOW_HANN, power.data());
+        float sum = 0.0f;
+        for (int b = 0; b < bins; ++b) {
+            magnitude[b] = std::log1p(LOG_GAIN * std::sqrt(power[b]));
+            sum += std::max(0.0f, magnitude[b] - previous[b]);
+        }
+        flux[f] = f > 0 ? sum : 0.0f;
+        previous.swap(magnitude);
+    }
+
+    float peak = *std::max_element(flux.begin(), flux.end());
+    if (peak <= 0.0f) return true;
+    float sensitivity = std::max(0.0f, std::min(1.0f, settings.sensitivity));
+    float margin = peak * MARGIN_LOW_SENSITIVITY *
+                   std::pow(MARGIN_HIGH_SENSITIVITY / MARGIN_LOW_SENSITIVITY, sensitivity);
+
+    // Running mean over THRESHOLD_FRAMES either side, from a prefix sum
+    std::vector<double> prefix(frames + 1, 0.0);
+    for (size_t f = 0; f < frames; ++f) prefix[f + 1] = prefix[f] + flux[f];
+
+    size_t min_gap = (size_t)(MIN_GAP_SECONDS * sample_rate);
+    for (size_t f = 1; f < frames; ++f) {
+        size_t lo = f > (size_t)THRESHOLD_FRAMES ? f - THRESHOLD_FRAMES : 0;
+        size_t hi = std::min(frames, f + THRESHOLD_FRAMES + 1);
+        float mean = (float)((prefix[hi] - prefix[lo]) / (hi - lo));
+        if (flux[f] < mean + margin) continue;
+
+        size_t p0 = f > (size_t)PEAK_FRAMES ? f - PEAK_FRAMES : 0;
+        size_t p1 = std::min(frames, f + PEAK_FRAMES + 1);
+        bool is_peak = true;
+        for (size_t p = p0; p < p1 && is_peak; ++p) {
+            if (flux[p] > flux[f] || (flux[p] == flux[f] && p < f)) is_peak = false;
+        }
+        if (!is_peak) continue;
+
+        // The frame's new content is its last hop; look for the attack from
+        // a frame before it up to the frame's end
+        size_t end = std::min(count, f * HOP_SIZE + FRAME_SIZE);
+        size_t begin = end > (size_t)(FRAME_SIZE + HOP_SIZE) ? end - FRAME_SIZE - HOP_SIZE : 0;
+        size_t onset = FindAttack(samples, begin, end);
+        if (!result.onsets.empty() && onset < result.onsets.back() + min_gap) continue;
+        result.onsets.push_back(onset);
+    }
+    if (task) task->SetProgress(FLUX_PROGRESS);
+
+    result.bpm = EstimateBpm(flux, sample_rate);
+    if (settings.snap_to_grid && result.bpm > 0.0) {
+        double step = 60.0 * sample_rate / result.bpm / std::max(1, settings.steps_per_beat);
+        SnapToGrid(result.onsets, step, count);
+    }
+    if (task) task->SetProgress(1.0f);
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef ONSET_DETECTOR_H
+#define ONSET_DETECTOR_H
+
+#include <cstddef>
+#include <vector>
+
+class BackgroundTask;
+
+struct OnsetSettings {
+    float sensitivity = 0.5f;       // 0..1; higher finds quieter hits
+    bool snap_to_grid = false;      // Move onsets onto the estimated BPM grid
+    int steps_per_beat = 4;         // Grid resolution when snapping (4 = 16ths)
+};
+
+struct OnsetResult {
+    std::vector<size_t> onsets;     // Sample offsets into the analysed span, ascending
+    double bpm = 0.0;               // 0 if no tempo could be estimated
+};
+
+// Finds transients in mono 16-bit audio for slicing drum loops. Onset
+// strength is the spectral flux of log-compressed magnitudes over short Hann
+// frames; peaks above a running mean plus a sensitivity-dependent margin
+// become onsets, which are then moved back to where the attack starts. The
+// tempo comes from the autocorrelation of the onset strength, folded into
+// 80-160 BPM.
+//
+// Meant for a worker thread: with a task, progress is reported and the
+// analysis stops early (returning false) when it is cancelled.
+bool DetectOnsets(const short* samples, size_t count, int sample_rate, const OnsetSettings& settings,
+                  OnsetResult& result, BackgroundTask* task = nullptr);
+
+#endif // ONSET_DETECTOR_H
@@ -2,7 +2,16 @@
 #include <imgui.h>
 #include <sstream>
 #include <algorithm>
-#include <regex>
+#include <cstring>
+
+namespace {
+// Largest pattern the grid edits; longer patterns in the text are cut here
+const int MAX_PATTERN_BARS = 16;
+
+bool IsValidNoteLength(int length) {
+    return length == 1 || length == 2 || length == 4 || length == 8 || length == 16 || length == 32;
+}
+} // namespace
 
 const char* PatternEditor::NOTE_NAMES[] = {
     "C", "C+", "D", "D+", "E", "F",
@@ -124,64 +133,44 @@ std::vector<PatternEditor::PatternInfo> PatternEditor::ScanForPatterns(const std
     
     // Find all pattern macros (*701 through *799)
     // Pattern format: *701 @1 o3 l4 a b c d | e f g a; (semicolon optional)
-    // We'll find each *number and extract content until next *number or end
     // IMPORTANT: Only match macros that start at the beginning of a line (after optional whitespace)
-    std::regex pattern_macro_regex(R"(\*(\d+))");
-    std::sregex_iterator iter(text.begin(), text.end(), pattern_macro_regex);
-    std::sregex_iterator end;
-    
-    for (; iter != end; ++iter) {
-        std::smatch match = *iter;
-        std::string macro_number_str = match[1].str();
-        
-        // Only process macros from 701 to 799
-        int macro_number = 0;
-        try {
-            macro_number = std::stoi(macro_number_str);
-        } catch (...) {
-            continue; // Skip invalid macro numbers
-        }
-        
-        if (macro_number < 701 || macro_number > 799) {
-            continue; // Skip macros outside the 701-799 range
+    // Walk the text line by line, so the cost stays linear however many *N
+    // references a line contains.
+    size_t line_start = 0;
+    while (line_start < text.length()) {
+        size_t next_line = line_start;
+        while (next_line < text.length() && text[next_line] != '\n' && text[next_line] != '\r') {
+            next_line++;
+        }
+        size_t macro_pos = line_start;
+        line_start = next_line + 1;
+
+        while (macro_pos < next_line && std::isspace((unsigned char)text[macro_pos])) {
+            macro_pos++;
         }
-        
-        // Find the start of the line containing this macro
-        size_t macro_pos = match.position();
-        size_t line_start = macro_pos;
-        // Go back to find the start of the line
-        while (line_start > 0 && text[line_start - 1] != '\n' && text[line_start - 1] != '\r') {
-            line_start--;
+        if (macro_pos >= next_line || text[macro_pos] != '*') {
+            continue;
         }
-        
-        // Check if the macro is at the start of the line (allowing only whitespace before it)
-        // Skip if there are non-whitespace characters before the macro on the same line
-        bool is_at_line_start = true;
-        for (size_t i = line_start; i < macro_pos; ++i) {
-            if (!std::isspace(text[i])) {
-                is_at_line_start = false;
-                break;
-            }
+        // Only process macros from 701 to 799 (the value saturates, so long
+        // digit runs can't overflow)
+        size_t digits_end = macro_pos + 1;
+        int macro_number = 0;
+        while (digits_end < next_line && std::isdigit((unsigned char)text[digits_end])) {
+            macro_number = std::min(macro_number * 10 + (text[digits_end] - '0'), 1000);
+            digits_end++;
         }
-        
-        if (!is_at_line_start) {
-            continue; // Skip macros that are not at the start of the line
+        if (digits_end == macro_pos + 1 || macro_number < 701 || macro_number > 799) {
+            continue; // Skip macros outside the 701-799 range
         }
         
         // Find the content after this macro number - patterns must be on a single line
-        size_t macro_end_pos = macro_pos + match.length();
+        size_t macro_end_pos = digits_end;
         std::string pattern_content;
-        
-        // Find the end of the line containing this macro
-        size_t line_end = macro_end_pos;
-        // Find the end of the line
-        while (line_end < text.length() && text[line_end] != '\n' && text[line_end] != '\r') {
-            line_end++;
-        }
+        size_t line_end = next_line;
         
         // Extract content from after macro number to end of line
         size_t content_start = macro_end_pos;
-        while (content_start < line_end && std::isspace(text[content_start])) {
+        while (content_start < line_end && std::isspace((unsigned char)text[content_start])) {
             content_start++;
         }
         
@@ -196,17 +185,14 @@ std::vector<PatternEditor::PatternInfo> PatternEditor::ScanForPatterns(const std
         if (semicolon_pos != std::string::npos) {
             size_t name_start = semicolon_pos + 1;
             // Skip whitespace after semicolon
-            while (name_start < pattern_content.length() && std::isspace(pattern_content[name_start])) {
+            while (name_start < pattern_content.length() && std::isspace((unsigned char)pattern_content[name_start])) {
                 name_start++;
             }
             // Name is everything after semicolon until end of line
             if (name_start < pattern_content.length()) {
                 pattern_name = pattern_content.substr(name_start);
-                // Trim whitespace from name
-                while (!pattern_name.empty() && std::isspace(pattern_name[0])) {
-                    pattern_name.erase(0, 1);
-                }
-                while (!pattern_name.empty() && std::isspace(pattern_name[pattern_name.length() - 1])) {
+                // Trim trailing whitespace from name (leading was skipped above)
+                while (!pattern_name.empty() && std::isspace((unsigned char)pattern_name[pattern_name.length() - 1])) {
                     pattern_name.erase(pattern_name.length() - 1, 1);
                 }
             }
@@ -214,28 +200,40 @@ std::vector<PatternEditor::PatternInfo> PatternEditor::ScanForPatterns(const std
             pattern_content = pattern_content.substr(0, semicolon_pos);
         }
         
-        // Remove [|] and [] markers from pattern content
+        // Remove [|] and [] markers from pattern content. Removing one can
+        // join the pieces around it into another ("[[|]]" -> "[]"), so this
+        // repeats until nothing changes; each pass is a single copy.
         std::string cleaned_content = pattern_content;
-        // Remove [|] marker
-        size_t pos = cleaned_content.find("[|]");
-        while (pos != std::string::npos) {
-            cleaned_content.erase(pos, 3);
-            pos = cleaned_content.find("[|]");
-        }
-        // Remove [] marker
-        pos = cleaned_content.find("[]");
-        while (pos != std::string::npos) {
-            cleaned_content.erase(pos, 2);
-            pos = cleaned_content.find("[]");
+        for (bool removed = true; removed; ) {
+            removed = false;
+            for (const char* marker : { "[|]", "[]" }) {
+                size_t marker_length = strlen(marker);
+                std::string kept;
+                size_t from = 0;
+                size_t pos = cleaned_content.find(marker);
+                while (pos != std::string::npos) {
+                    kept.append(cleaned_content, from, pos - from);
+                    from = pos + marker_length;
+                    pos = cleaned_content.find(marker, from);
+                    removed = true;
+                }
+                if (from > 0) {
+                    kept.append(cleaned_content, from, std::string::npos);
+                    cleaned_content.swap(kept);
+                }
+            }
         }
         
         // Trim whitespace
-        while (!cleaned_content.empty() && std::isspace(cleaned_content[0])) {
-            cleaned_content.erase(0, 1);
+        size_t first = 0;
+        while (first < cleaned_content.length() && std::isspace((unsigned char)cleaned_content[first])) {
+            first++;
         }
-        while (!cleaned_content.empty() && std::isspace(cleaned_content[cleaned_content.length() - 1])) {
-            cleaned_content.erase(cleaned_content.length() - 1, 1);
+        size_t last = cleaned_content.length();
+        while (last > first && std::isspace((unsigned char)cleaned_content[last - 1])) {
+            last--;
         }
+        cleaned_content = cleaned_content.substr(first, last - first);
         
         // Skip empty patterns
         if (cleaned_content.empty()) {
@@ -296,7 +294,12 @@ std::vector<PatternEditor::PatternInfo> PatternEditor::ScanForPatterns(const std
         // Count bars by counting | separators
         // Each | separator indicates a new bar, so bars = separator count + 1
         size_t separator_count = std::count(cleaned_content.begin(), cleaned_content.end(), '|');
-        info.bars = separator_count > 0 ? separator_count + 1 : 1;
+        info.bars = (int)std::min<size_t>(separator_count + 1, MAX_PATTERN_BARS);
+        
+        // The grid only has the lengths the editor offers (l0 would divide by zero)
+        if (!IsValidNoteLength(info.note_length)) {
+            info.note_length = 4;
+        }
         
         patterns.push_back(info);
     }
@@ -346,7 +349,7 @@ bool PatternEditor::LoadPattern(const PatternInfo& pattern) {
     // Skip commands (@X, oX, lX) and separators (|)
     while (content_pos < content.length()) {
         // Skip whitespace
-        if (std::isspace(content[content_pos])) {
+        if (std::isspace((unsigned char)content[content_pos])) {
             content_pos++;
             continue;
         }
@@ -355,7 +358,7 @@ bool PatternEditor::LoadPattern(const PatternInfo& pattern) {
         if (content[content_pos] == '@' || content[content_pos] == 'D' || content[content_pos] == 'o' || content[content_pos] == 'l') {
             content_pos++;
             // Skip digits after command
-            while (content_pos < content.length() && std::isdigit(content[content_pos])) {
+            while (content_pos < content.length() && std::isdigit((unsigned char)content[content_pos])) {
                 content_pos++;
             }
             continue;
@@ -377,7 +380,7 @@ bool PatternEditor::LoadPattern(const PatternInfo& pattern) {
     size_t pos = 0;
     while (pos < note_sequence.length() && step_index < total_steps) {
         // Skip whitespace
-        if (std::isspace(note_sequence[pos])) {
+        if (std::isspace((unsigned char)note_sequence[pos])) {
             pos++;
             continue;
         }
@@ -394,7 +397,7 @@ bool PatternEditor::LoadPattern(const PatternInfo& pattern) {
         }
         
         // Handle rest
-        if (std::tolower(note_sequence[pos]) == 'r') {
+        if (std::tolower((unsigned char)note_sequence[pos]) == 'r') {
             m_pattern[step_index] = -1;
             pos++;
             step_index++;
@@ -410,7 +413,7 @@ bool PatternEditor::LoadPattern(const PatternInfo& pattern) {
         }
         
         // Parse note (a-g, optionally followed by + or -)
-        char note_char = std::tolower(note_sequence[pos]);
+        char note_char = std::tolower((unsigned char)note_sequence[pos]);
         if (note_char >= 'a' && note_char <= 'g') {
             pos++;
             bool is_sharp = false;
@@ -1014,7 +1017,7 @@ void PatternEditor::Render() {
         ImGui::SameLine(0, 10.0f); // Add 10 pixels spacing after label
         ImGui::SetNextItemWidth(100);
         if (ImGui::InputInt("##PatternLength", &m_pattern_length, 1, 1)) {
-            m_pattern_length = std::max(1, std::min(16, m_pattern_length));
+            m_pattern_length = std::max(1, std::min(MAX_PATTERN_BARS, m_pattern_length));
             total_steps = GetTotalSteps();
             m_pattern.resize(total_steps, -1);
             m_is_flat.resize(total_steps, false);
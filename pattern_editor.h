@@ -74,6 +74,9 @@ private:
     static const char* NOTE_NAMES[];
     static const int NOTE_COUNT;
     static ImVec4 GetNoteColor(int note_index, bool is_flat);  // Get color for a note
+
+    friend class HotPathBench;  // bench.cpp times the scan/apply paths directly
+    friend class PatternFuzzer; // fuzz_patterns.cpp feeds the parsers directly
 };
 
 #endif // PATTERN_EDITOR_H
@@ -0,0 +1,85 @@
+#include "pcm_pipeline.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+PcmSpan PcmSpan::Sub(size_t offset, size_t count) const
+{
+    offset = std::min(offset, size);
+    return PcmSpan(data + offset, std::min(count, size - offset));
+}
+
+bool PcmPipeline::Process(PcmSpan source, size_t start, size_t end, const Settings& settings,
+                          std::vector<short>& output)
+{
+    PcmSpan selection = source.Sub(start, end > start ? end - start : 0);
+    if (selection.empty()) {
+        output.clear();
+        return false;
+    }
+
+    double out_rate = settings.double_speed ? settings.target_rate / 2.0 : (double)settings.target_rate;
+    m_resampler.Configure((double)settings.source_rate, out_rate, settings.quality);
+    output.resize(m_resampler.GetOutputLength(selection.size));
+    m_resampler.Process(selection.data, selection.size, output.data());
+    return true;
+}
+
+PcmSpan PcmPipeline::SliceAt(PcmSpan samples, const std::vector<size_t>& cuts, int index)
+{
+    if (index < 0 || index > (int)cuts.size()) return PcmSpan();
+    size_t from = index > 0 ? std::min(cuts[index - 1], samples.size) : 0;
+    size_t to = index < (int)cuts.size() ? std::min(cuts[index], samples.size) : samples.size;
+    return samples.Sub(from, to > from ? to - from : 0);
+}
+
+namespace {
+// Slices per worker thread before another one is worth starting
+const int SLICES_PER_THREAD = 4;
+
+bool EncodeAndWrite(const std::string& path, PcmSpan samples, int sample_rate, bool loop,
+                    std::vector<uint8_t>& buffer)
+{
+    WavLoop whole = { 0, samples.size > 0 ? (uint32_t)(samples.size - 1) : 0 };
+    EncodeWav(samples.data, samples.size, 1, (uint32_t)sample_rate, loop ? &whole : nullptr, buffer);
+    return WriteFileAtOnce(path, buffer);
+}
+} // namespace
+
+bool PcmPipeline::WriteWav(const std::string& path, PcmSpan samples, int sample_rate, bool loop)
+{
+    std::vector<uint8_t> buffer;
+    return EncodeAndWrite(path, samples, sample_rate, loop, buffer);
+}
+
+int PcmPipeline::WriteSlices(const std::string& base_path, const std::vector<PcmSpan>& slices, int sample_rate, bool loop)
+{
+    int count = (int)slices.size();
+    if (count < 1) return 0;
+    std::atomic<int> next(0);
+    std::atomic<int> saved(0);
+    auto worker = [&]() {
+        std::vector<uint8_t> buffer;
+        for (int slice = next++; slice < count; slice = next++) {
+            std::string path = base_path + "-" + std::to_string(slice + 1) + ".wav";
+            if (EncodeAndWrite(path, slices[slice], sample_rate, loop, buffer)) {
+                ++saved;
+            }
+        }
+    };
+
+#ifdef __EMSCRIPTEN__
+    worker();
+#else
+    int hardware = (int)std::max(1u, std::thread::hardware_concurrency());
+    int thread_count = std::min(hardware, (count + SLICES_PER_THREAD - 1) / SLICES_PER_THREAD);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) thread.join();
+#endif
+    return saved;
+}
@@ -0,0 +1,67 @@
+#ifndef PCM_PIPELINE_H
+#define PCM_PIPELINE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "resampler.h"
+#include "sample_buffer.h"
+#include "wav_writer.h"
+
+// Read-only view of mono 16-bit samples owned by someone else
+struct PcmSpan {
+    const short* data = nullptr;
+    size_t size = 0;
+
+    PcmSpan() {}
+    PcmSpan(const short* data, size_t size) : data(data), size(size) {}
+    PcmSpan(const std::vector<short>& samples) : data(samples.data()), size(samples.size()) {}
+    PcmSpan(const SampleBuffer& samples) : data(samples.data()), size(samples.size()) {}
+
+    bool empty() const { return size == 0; }
+    const short* begin() const { return data; }
+    const short* end() const { return data + size; }
+
+    // Clamped to the span, so out-of-range requests give a shorter view
+    PcmSpan Sub(size_t offset, size_t count) const;
+};
+
+// The PCM tool's export chain: select -> filter/resample -> speed -> slice
+// -> encode. Selecting and slicing only narrow views; filtering, resampling
+// and the speed change are a single pass of the polyphase filter (double
+// speed halves the target rate, so its cutoff does the decimation), writing
+// the one buffer that is allocated. Encoding writes straight from a view.
+//
+// A pipeline keeps its resampler between runs, so exporting many short
+// selections in a row reuses the filter and scratch buffers.
+class PcmPipeline {
+public:
+    struct Settings {
+        int source_rate = 0;
+        int target_rate = 17500;
+        bool double_speed = false;
+        ResampleQuality quality = ResampleQuality::Normal;
+    };
+
+    // Select [start, end) of source and process it into output, which is
+    // resized in place (keeping its capacity). False for an empty selection.
+    bool Process(PcmSpan source, size_t start, size_t end, const Settings& settings, std::vector<short>& output);
+
+    // Encode as a 16-bit mono WAV file, built in memory and written at once.
+    // With loop, a smpl chunk marks the whole file as a forward loop.
+    static bool WriteWav(const std::string& path, PcmSpan samples, int sample_rate, bool loop);
+
+    // Slice index of a buffer cut at cuts (non-decreasing positions in it),
+    // which gives cuts.size() + 1 parts
+    static PcmSpan SliceAt(PcmSpan samples, const std::vector<size_t>& cuts, int index);
+
+    // Write slice i to base_path-(i+1).wav. Slices are encoded and written
+    // concurrently, each worker reusing one buffer. Returns how many files
+    // were written.
+    static int WriteSlices(const std::string& base_path, const std::vector<PcmSpan>& slices, int sample_rate, bool loop);
+
+private:
+    OfflineResampler m_resampler;
+};
+
+#endif // PCM_PIPELINE_H
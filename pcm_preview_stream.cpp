@@ -0,0 +1,139 @@
+#include "pcm_preview_stream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PREVIEW_SSE2 1
+#endif
+
+namespace {
+// Preview samples are 16-bit; the engine mixes at 24-bit scale
+const float OUTPUT_SCALE = 256.0f;
+
+const float FRAC_SCALE = 1.0f / 4294967296.0f;
+
+// Frames whose index and fraction are worked out before interpolating
+const int RUN_CHUNK = 64;
+
+// Add count frames of linearly interpolated data to output. The caller
+// guarantees every frame's index + 1 is inside data.
+void MixLinear(const short* data, uint64_t phase, uint64_t step, int count, float scale, WAVE_32BS* output)
+{
+    float s0[RUN_CHUNK];
+    float s1[RUN_CHUNK];
+    float frac[RUN_CHUNK];
+    while (count > 0) {
+        int n = std::min(count, RUN_CHUNK);
+        for (int i = 0; i < n; ++i, phase += step) {
+            const short* p = data + (size_t)(phase >> 32);
+            s0[i] = p[0];
+            s1[i] = p[1];
+            frac[i] = (float)(uint32_t)phase * FRAC_SCALE;
+        }
+
+        int i = 0;
+#ifdef PREVIEW_SSE2
+        __m128 vscale = _mm_set1_ps(scale);
+        for (; i + 4 <= n; i += 4) {
+            __m128 a = _mm_loadu_ps(s0 + i);
+            __m128 b = _mm_loadu_ps(s1 + i);
+            __m128 v = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_loadu_ps(frac + i)));
+            __m128i value = _mm_cvtps_epi32(_mm_mul_ps(v, vscale));
+            // Mono to both channels: (v0, v0, v1, v1) and (v2, v2, v3, v3)
+            __m128i lo = _mm_unpacklo_epi32(value, value);
+            __m128i hi = _mm_unpackhi_epi32(value, value);
+            __m128i* out = (__m128i*)(output + i);
+            _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), lo));
+            _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), hi));
+        }
+#endif
+        for (; i < n; ++i) {
+            int32_t value = (int32_t)std::lrintf((s0[i] + (s1[i] - s0[i]) * frac[i]) * scale);
+            output[i].L += value;
+            output[i].R += value;
+        }
+        output += n;
+        count -= n;
+    }
+}
+} // namespace
+
+PCM_Preview_Stream::PCM_Preview_Stream(const SampleBuffer& data, int start, int end, int rate, bool loop)
+    : m_data(data), m_start(start), m_end(end), m_rate(rate), m_loop(loop), m_phase(0), m_step(1ull << 32)
+{
+    if (m_start < 0) m_start = 0;
+    if (m_end > (int)m_data.size()) m_end = (int)m_data.size();
+    if (m_start >= m_end) {
+        m_start = 0;
+        m_end = 0;
+    }
+    m_position = m_start;
+}
+
+void PCM_Preview_Stream::setup_stream(uint32_t output_rate)
+{
+    if (output_rate > 0 && m_rate > 0) {
+        m_step = (uint64_t)std::llround((double)m_rate / output_rate * 4294967296.0);
+    } else {
+        m_step = 1ull << 32;
+    }
+    m_step = std::max<uint64_t>(m_step, 1);
+    m_phase = 0;
+    m_position = m_start;
+}
+
+int PCM_Preview_Stream::get_sample(WAVE_32BS* output, int count, int channels)
+{
+    std::memset(output, 0, sizeof(WAVE_32BS) * count);
+    mix_block(output, count, 1.0f);
+    return finished ? 0 : 1;
+}
+
+bool PCM_Preview_Stream::mix_block(WAVE_32BS* output, int count, float gain)
+{
+    const uint64_t length = (uint64_t)(m_end - m_start);
+    if (length == 0) {
+        if (!finished) set_finished(true);
+        return true;
+    }
+
+    const short* data = m_data.data() + m_start;
+    const float scale = gain * OUTPUT_SCALE;
+    const uint64_t last = (length - 1) << 32;   // Phase of the last sample
+    int done = 0;
+    while (done < count && !finished) {
+        if (m_phase >= length << 32) {
+            if (!m_loop) {
+                set_finished(true);
+                break;
+            }
+            m_phase %= length << 32;
+        }
+
+        if (m_phase >= last) {
+            // The last sample interpolates towards the loop start (or holds)
+            float s0 = data[length - 1];
+            float s1 = m_loop ? data[0] : s0;
+            float frac = (float)(uint32_t)m_phase * FRAC_SCALE;
+            int32_t value = (int32_t)std::lrintf((s0 + (s1 - s0) * frac) * scale);
+            output[done].L += value;
+            output[done].R += value;
+            m_phase += m_step;
+            ++done;
+            continue;
+        }
+
+        // Every frame before the last sample has its right-hand neighbour
+        int run = (int)std::min<uint64_t>(count - done, (last - m_phase + m_step - 1) / m_step);
+        MixLinear(data, m_phase, m_step, run, scale, output + done);
+        m_phase += m_step * run;
+        done += run;
+    }
+
+    uint64_t index = std::min<uint64_t>(m_phase >> 32, length);
+    if (m_loop) index %= length;
+    m_position = m_start + (int)index;
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef PCM_PREVIEW_STREAM_H
+#define PCM_PREVIEW_STREAM_H
+
+#include <cstdint>
+#include "audio_engine.h"
+#include "sample_buffer.h"
+
+// Plays [start, end) of a shared sample buffer at the output rate with
+// linear interpolation, optionally looping. Position is a 32.32 fixed-point
+// phase; each block is split into runs that need no end-of-selection check,
+// which are interpolated four frames at a time, and the loop wrap and the
+// reported position are handled once per run rather than per frame.
+class PCM_Preview_Stream : public Preview_Stream
+{
+public:
+    PCM_Preview_Stream(const SampleBuffer& data, int start, int end, int rate, bool loop);
+
+    // Preview_Stream
+    void setup_stream(uint32_t output_rate) override;
+    int get_sample(WAVE_32BS* output, int count, int channels) override;
+    void stop_stream() override {}
+    int get_position() const override { return m_position; }
+    bool mix_block(WAVE_32BS* output, int count, float gain) override;
+
+private:
+    SampleBuffer m_data;
+    int m_start;
+    int m_end;
+    int m_rate;
+    bool m_loop;
+    uint64_t m_phase;       // Relative to m_start, 32.32
+    uint64_t m_step;
+    int m_position;         // Published after every block
+};
+
+#endif // PCM_PREVIEW_STREAM_H
@@ -11,122 +11,31 @@
 #include <filesystem>
 #include "stringf.h"
 #include "audio_manager.h"
+#include "audio_engine.h"
+#include "audio_file.h"
+#include "pcm_pipeline.h"
+#include "pcm_preview_stream.h"
+#include "zero_crossing.h"
 
 namespace fs = std::filesystem;
 
-// Static callback initialization
-PCMToolWindow::CreateWindowCallback PCMToolWindow::s_create_window_callback = nullptr;
-uint32_t PCMToolWindow::s_id_counter = 0;
+namespace {
+// Rate of every export; double speed halves it before resampling
+const int TARGET_RATE = 17500;
 
-// Simple Audio Stream for Preview
-class PCM_Preview_Stream : public Audio_Stream
-{
-public:
-    PCM_Preview_Stream(const std::vector<short>& data, int start, int end, int rate, bool loop, int* position_ptr)
-        : data(data), start(start), end(end), rate(rate), loop(loop), pos(0.0), step(0.0), position_ptr(position_ptr)
-    {
-        if (this->start < 0) this->start = 0;
-        if (this->end > (int)this->data.size()) this->end = (int)this->data.size();
-        if (this->start >= this->end) {
-             this->start = 0;
-             this->end = 0;
-        }
-    }
+// Length estimates from compressed headers are trusted up to an hour at
+// 48 kHz when reserving space for a load
+const uint64_t MAX_LOAD_RESERVE = (uint64_t)48000 * 60 * 60;
 
-    void setup_stream(uint32_t output_rate) override
-    {
-        if (output_rate > 0 && rate > 0)
-            step = (double)rate / (double)output_rate;
-        else
-            step = 1.0;
-        pos = 0.0;
-    }
+// Waveform view limits: one wheel notch scales the visible span by this,
+// and zooming in stops at this many samples across the plot
+const double ZOOM_STEP = 1.25;
+const double MIN_VIEW_SAMPLES = 16.0;
+} // namespace
 
-    int get_sample(WAVE_32BS* output, int count, int channels) override
-    {
-        if (start >= end) {
-            for (int i = 0; i < count; ++i) {
-                output[i].L = 0;
-                output[i].R = 0;
-            }
-            if (!finished) set_finished(true);
-            return 0;
-        }
-
-        for (int i = 0; i < count; ++i)
-        {
-            if (position_ptr) {
-                int current_idx = start + (int)pos;
-                if (loop && current_idx >= end) {
-                    current_idx = start + ((current_idx - start) % (end - start));
-                }
-                if (current_idx < start) current_idx = start;
-                if (current_idx > end) current_idx = end;
-                *position_ptr = current_idx;
-            }
-            
-            int idx0 = start + (int)pos;
-            int idx1 = idx0 + 1;
-            
-            if (idx0 >= end)
-            {
-                if (loop)
-                {
-                     pos -= (end - start);
-                     idx0 = start + (int)pos;
-                     idx1 = idx0 + 1;
-                }
-                else
-                {
-                    for (; i < count; ++i) {
-                        output[i].L = 0;
-                        output[i].R = 0;
-                    }
-                    if (!finished) set_finished(true);
-                    return 0;
-                }
-            }
-            
-            if (idx1 >= end)
-            {
-                 if (loop) idx1 = start; 
-                 else idx1 = end - 1;
-            }
-
-            if (idx0 < 0) idx0 = 0;
-            if (idx1 < 0) idx1 = 0;
-            if (idx0 >= (int)data.size()) idx0 = (int)data.size() - 1;
-            if (idx1 >= (int)data.size()) idx1 = (int)data.size() - 1;
-
-            double frac = pos - (int)pos;
-            short s0 = data[idx0];
-            short s1 = data[idx1];
-            
-            int32_t val = (int32_t)(s0 + (s1 - s0) * frac);
-
-            output[i].L = val << 8;
-            output[i].R = val << 8; 
-
-            pos += step;
-        }
-        
-        return 1;
-    }
-
-    void stop_stream() override
-    {
-    }
-
-private:
-    std::vector<short> data;
-    int start;
-    int end;
-    int rate;
-    bool loop;
-    double pos;
-    double step;
-    int* position_ptr;
-};
+// Static callback initialization
+PCMToolWindow::CreateWindowCallback PCMToolWindow::s_create_window_callback = nullptr;
+uint32_t PCMToolWindow::s_id_counter = 0;
 
 PCMToolWindow::PCMToolWindow() : m_fs(true, false, true), m_browse_open(false), m_browse_save(false),
                                   m_open(false)
@@ -137,35 +46,203 @@ PCMToolWindow::PCMToolWindow() : m_fs(true, false, true), m_browse_open(false),
     m_start_point = 0;
     m_end_point = 0;
     m_preview_loop = false;
+    m_preview_gain = 1.0f;
     m_double_speed = false;
+    m_write_loop = false;
+    m_snap_to_zero = false;
+    m_snap_radius = 256;
+    m_resample_quality = ResampleQuality::Normal;
     m_current_playback_position = -1;
-    m_zoom_enabled = false;
-    m_zoom_point = 0;
-    m_zoom_level = 1.0f;
-    m_zoom_window_samples = 1000;
+    m_view_start = 0.0;
+    m_view_length = 0.0;
+    m_waveform_hovered = false;
     m_slice_enabled = false;
     m_num_slices = 2;
+    m_slice_mode = SLICE_EQUAL;
+    m_onset_pending = false;
+    m_detected_bpm = 0.0;
+    m_onset_start = 0;
     m_status_message = "Ready";
     memset(m_input_path, 0, sizeof(m_input_path));
     m_request_focus = false;
+    m_loading = false;
+    m_load_started = false;
+    m_load_sample_rate = 0;
+    m_load_channels = 0;
+    m_load_total = 0;
+    m_load_ok = false;
 }
 
 PCMToolWindow::~PCMToolWindow()
 {
+    CancelLoad();
     StopPreview();
 }
 
-float PCMToolWindow::WaveformGetter(void* data, int idx)
+// Everything derived from the samples goes when they are replaced
+void PCMToolWindow::OnDataReplaced()
+{
+    m_peaks.Clear();
+    m_view_start = 0.0;
+    m_view_length = 0.0;
+    m_onset_task.Cancel();
+    m_onset_pending = false;
+    m_slice_markers.clear();
+    m_detected_bpm = 0.0;
+}
+
+int PCMToolWindow::SnapToZeroCrossing(int position) const
+{
+    if (!m_snap_to_zero || position < 0) return position;
+    return (int)FindZeroCrossing(m_pcm_data.data(), m_pcm_data.size(), (size_t)position, (size_t)m_snap_radius);
+}
+
+void PCMToolWindow::RenderTransientControls()
+{
+#ifdef __EMSCRIPTEN__
+    // The analysis would run inline on the only thread and freeze the page
+    ImGui::TextDisabled("Transient detection is not available in the web build");
+#else
+    if (m_onset_pending && !m_onset_task.IsRunning()) {
+        m_onset_task.Join();
+        m_onset_pending = false;
+        if (!m_onset_task.IsCancelled()) {
+            // Onsets are relative to the analysed selection; one at its very
+            // start is not a cut, nor is one that snaps onto its neighbour
+            m_slice_markers.clear();
+            for (size_t onset : m_onset_result.onsets) {
+                if (onset == 0) continue;
+                int marker = SnapToZeroCrossing(m_onset_start + (int)onset);
+                if (m_slice_markers.empty() || marker > m_slice_markers.back()) m_slice_markers.push_back(marker);
+            }
+            m_detected_bpm = m_onset_result.bpm;
+            m_status_message = "Found " + std::to_string(m_slice_markers.size() + 1) + " slices";
+        }
+    }
+
+    ImGui::SetNextItemWidth(120);
+    std::string sensitivity_id = "##onset_sensitivity_" + std::to_string(m_id);
+    ImGui::SliderFloat(sensitivity_id.c_str(), &m_onset_settings.sensitivity, 0.0f, 1.0f, "Sensitivity %.2f");
+    ImGui::SameLine();
+    ImGui::Checkbox("Snap to BPM", &m_onset_settings.snap_to_grid);
+    if (m_onset_settings.snap_to_grid) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(70);
+        const char* grid_names[] = { "1/4", "1/8", "1/16", "1/32" };
+        const int grid_steps[] = { 1, 2, 4, 8 };
+        int grid = 0;
+        while (grid < 3 && grid_steps[grid] < m_onset_settings.steps_per_beat) ++grid;
+        std::string grid_id = "##onset_grid_" + std::to_string(m_id);
+        if (ImGui::Combo(grid_id.c_str(), &grid, grid_names, 4)) {
+            m_onset_settings.steps_per_beat = grid_steps[grid];
+        }
+    }
+
+    ImGui::SameLine();
+    if (m_onset_pending) {
+        ImGui::ProgressBar(m_onset_task.GetProgress(), ImVec2(100.0f, 0.0f));
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel##onsets")) m_onset_task.Cancel();
+    } else if (ImGui::Button("Detect")) {
+        StartOnsetDetection();
+    }
+    if (m_detected_bpm > 0.0) {
+        ImGui::SameLine();
+        ImGui::Text("%d slices, ~%.1f BPM", (int)m_slice_markers.size() + 1, m_detected_bpm);
+    }
+#endif
+}
+
+void PCMToolWindow::StartOnsetDetection()
 {
-    const std::vector<short>* pcm = (const std::vector<short>*)data;
-    if (idx < 0 || idx >= (int)pcm->size()) return 0.0f;
-    return (float)(*pcm)[idx] / 32768.0f;
+    if (m_start_point < 0) m_start_point = 0;
+    if (m_end_point > (int)m_pcm_data.size()) m_end_point = (int)m_pcm_data.size();
+    if (m_start_point >= m_end_point) return;
+
+    // The job keeps its own reference, so a load replacing the samples
+    // cannot pull them out from under it
+    SampleBuffer data = m_pcm_data;
+    size_t start = (size_t)m_start_point;
+    size_t count = (size_t)(m_end_point - m_start_point);
+    int rate = m_sample_rate;
+    OnsetSettings settings = m_onset_settings;
+    m_onset_start = m_start_point;
+    m_onset_pending = true;
+    m_onset_task.Start([this, data, start, count, rate, settings](BackgroundTask& task) {
+        OnsetResult result;
+        if (DetectOnsets(data.data() + start, count, rate, settings, result, &task)) {
+            m_onset_result = std::move(result);
+        }
+    });
+}
+
+void PCMToolWindow::ClampView()
+{
+    double size = (double)m_pcm_data.size();
+    if (m_view_length <= 0.0 || m_view_length > size) m_view_length = size;
+    m_view_length = std::max(m_view_length, std::min(MIN_VIEW_SAMPLES, size));
+    m_view_start = std::max(0.0, std::min(m_view_start, size - m_view_length));
+}
+
+void PCMToolWindow::DrawWaveform(ImDrawList* draw_list, const ImVec2& plot_min, const ImVec2& plot_max)
+{
+    draw_list->AddRectFilled(plot_min, plot_max, ImGui::GetColorU32(ImGuiCol_FrameBg));
+    int columns = (int)(plot_max.x - plot_min.x);
+    if (columns <= 0 || m_pcm_data.empty() || m_view_length <= 0.0) return;
+
+    // Bring the pyramid up to date with anything loaded since last frame
+    if (m_peaks.GetSize() > m_pcm_data.size()) m_peaks.Clear();
+    m_peaks.Append(m_pcm_data.data(), m_pcm_data.size());
+
+    ImU32 color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+    float mid = (plot_min.y + plot_max.y) * 0.5f;
+    float half = (plot_max.y - plot_min.y) * 0.5f - 1.0f;
+    double samples_per_column = m_view_length / columns;
+
+    if (samples_per_column >= 1.0) {
+        if ((int)m_column_min.size() < columns) {
+            m_column_min.resize(columns);
+            m_column_max.resize(columns);
+        }
+        m_peaks.Query(m_pcm_data.data(), m_view_start, samples_per_column, columns,
+                      m_column_min.data(), m_column_max.data());
+        for (int x = 0; x < columns; ++x) {
+            if (m_column_min[x] > m_column_max[x]) continue;
+            float y0 = mid - m_column_max[x] / 32768.0f * half;
+            float y1 = mid - m_column_min[x] / 32768.0f * half;
+            draw_list->AddLine(ImVec2(plot_min.x + x + 0.5f, y0), ImVec2(plot_min.x + x + 0.5f, std::max(y1, y0 + 1.0f)), color);
+        }
+        return;
+    }
+
+    // Zoomed in past one sample per pixel: join the samples themselves
+    double x_step = columns / m_view_length;
+    size_t first = (size_t)std::max(0.0, std::floor(m_view_start));
+    size_t last = std::min(m_pcm_data.size(), (size_t)std::ceil(m_view_start + m_view_length) + 1);
+    m_wave_points.clear();
+    for (size_t i = first; i < last; ++i) {
+        m_wave_points.push_back(ImVec2(plot_min.x + (float)((i - m_view_start) * x_step),
+                                       mid - m_pcm_data[i] / 32768.0f * half));
+    }
+    draw_list->PushClipRect(plot_min, plot_max, true);
+    draw_list->AddPolyline(m_wave_points.data(), (int)m_wave_points.size(), color, 0, 1.0f);
+    draw_list->PopClipRect();
 }
 
 void PCMToolWindow::Render()
 {
+    // Keep taking in a load even while the window is closed
+    if (m_loading) {
+        PollLoad();
+    }
+
     if (!m_open) return;
 
+    // Latest position published by the audio engine for this window's preview
+    // Where the listener is, not where the mixer is: the device buffer is
+    // still ahead of us
+    m_current_playback_position = AudioEngine::Get().GetAudiblePreviewPosition(m_id);
+
     ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
     
     // Bring window to front if focus was requested
@@ -195,7 +272,7 @@ void PCMToolWindow::Render()
     std::string window_id = window_title + "###PCMToolWindow" + std::to_string(m_id);
     
     bool window_open = m_open;
-    if (ImGui::Begin(window_id.c_str(), &window_open))
+    if (ImGui::Begin(window_id.c_str(), &window_open, m_waveform_hovered ? ImGuiWindowFlags_NoScrollWithMouse : 0))
     {
         m_open = window_open;
         
@@ -208,6 +285,20 @@ void PCMToolWindow::Render()
         ImGui::SameLine();
         ImGui::Text("%s", m_current_filename.c_str());
 
+        if (m_loading)
+        {
+            // Compressed files may not know their length; show time decoded
+            std::string overlay = m_load_started && m_sample_rate > 0
+                ? stringf("Loading... %.1f s", (double)m_pcm_data.size() / m_sample_rate)
+                : std::string("Loading...");
+            ImGui::ProgressBar(m_load_task.GetProgress(), ImVec2(200.0f, 0.0f), overlay.c_str());
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel"))
+            {
+                m_load_task.Cancel();
+            }
+        }
+
         if (m_browse_open)
         {
             ImVec2 center = ImGui::GetIO().DisplaySize;
@@ -216,10 +307,10 @@ void PCMToolWindow::Render()
             ImVec2 size(600, 400);
             ImVec2 pos = ImVec2(center.x - size.x * 0.5f, center.y - size.y * 0.5f);
 
-            const char* path = m_fs.chooseFileDialog(load_clicked, m_input_path, ".wav;.mp3", "Load Audio", size, pos);
+            const char* path = m_fs.chooseFileDialog(load_clicked, m_input_path, GetAudioFileFilter(), "Load Audio", size, pos);
             if (strlen(path) > 0)
             {
-                LoadFile(path);
+                StartLoad(path);
                 m_browse_open = false;
             }
             else if (m_fs.hasUserJustCancelledDialog())
@@ -237,28 +328,23 @@ void PCMToolWindow::Render()
             ImGui::SameLine();
             ImGui::Text("Length: %d samples", (int)m_pcm_data.size());
 
-            // Zoom controls
-            ImGui::Checkbox("Zoom", &m_zoom_enabled);
-            if (m_zoom_enabled) {
-                ImGui::SameLine();
-                if (ImGui::RadioButton("Start", m_zoom_point == 0)) m_zoom_point = 0;
-                ImGui::SameLine();
-                if (ImGui::RadioButton("End", m_zoom_point == 1)) m_zoom_point = 1;
-                ImGui::SameLine();
-                if (ImGui::Button("Zoom In")) {
-                    m_zoom_window_samples = (int)(m_zoom_window_samples * 0.5f);
-                    if (m_zoom_window_samples < 10) m_zoom_window_samples = 10;
-                }
-                ImGui::SameLine();
-                if (ImGui::Button("Zoom Out")) {
-                    m_zoom_window_samples = (int)(m_zoom_window_samples * 2.0f);
-                    if (m_zoom_window_samples > (int)m_pcm_data.size()) m_zoom_window_samples = (int)m_pcm_data.size();
-                }
-                ImGui::SameLine();
-                if (ImGui::Button("Reset")) {
-                    m_zoom_window_samples = 1000;
-                }
+            // View controls; over the waveform the wheel zooms around the
+            // mouse and dragging pans
+            ClampView();
+            if (ImGui::Button("Fit")) {
+                m_view_start = 0.0;
+                m_view_length = (double)m_pcm_data.size();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Zoom to Selection") && m_end_point > m_start_point) {
+                m_view_start = m_start_point;
+                m_view_length = m_end_point - m_start_point;
+                ClampView();
             }
+            ImGui::SameLine();
+            double seconds_per_sample = m_sample_rate > 0 ? 1.0 / m_sample_rate : 0.0;
+            ImGui::Text("View: %.3f - %.3f s", m_view_start * seconds_per_sample,
+                        (m_view_start + m_view_length) * seconds_per_sample);
 
             // Waveform display
             float plot_height = 150.0f;
@@ -274,66 +360,48 @@ void PCMToolWindow::Render()
             ImVec2 box_max = ImVec2(box_min.x + plot_width - margin_x * 2.0f, box_min.y + plot_height);
             
             ImDrawList* draw_list = ImGui::GetWindowDrawList();
-            draw_list->AddRect(box_min, box_max, IM_COL32(200, 200, 200, 255), 0.0f, 0, 1.0f);
             
             ImGui::SetCursorPosX(ImGui::GetCursorPosX() + margin_x);
             ImGui::SetCursorPosY(ImGui::GetCursorPosY() + margin_y);
             
             ImVec2 plot_min = ImVec2(box_min.x + 2.0f, box_min.y);
             ImVec2 plot_max = ImVec2(box_max.x - 2.0f, box_max.y);
-            
-            // Calculate zoom window if enabled
-            int zoom_start_sample = 0;
-            int zoom_end_sample = (int)m_pcm_data.size();
-            std::vector<short> zoom_data;
-            
-            if (m_zoom_enabled && m_pcm_data.size() > 0) {
-                int zoom_center_sample = (m_zoom_point == 0) ? m_start_point : m_end_point;
-                int half_window = m_zoom_window_samples / 2;
-                zoom_start_sample = zoom_center_sample - half_window;
-                zoom_end_sample = zoom_center_sample + half_window;
-                
-                if (zoom_start_sample < 0) {
-                    zoom_end_sample += -zoom_start_sample;
-                    zoom_start_sample = 0;
-                }
-                if (zoom_end_sample > (int)m_pcm_data.size()) {
-                    zoom_start_sample -= (zoom_end_sample - (int)m_pcm_data.size());
-                    zoom_end_sample = (int)m_pcm_data.size();
-                    if (zoom_start_sample < 0) zoom_start_sample = 0;
+            float width = plot_max.x - plot_min.x;
+
+            ImVec2 plot_size = ImVec2(plot_width - margin_x * 2.0f, plot_height);
+            std::string waveform_id = "##Waveform_" + std::to_string(m_id);
+            ImGui::InvisibleButton(waveform_id.c_str(), plot_size);
+            m_waveform_hovered = ImGui::IsItemHovered();
+            if (m_waveform_hovered && width > 0.0f) {
+                ImGuiIO& io = ImGui::GetIO();
+                if (io.MouseWheel != 0.0f) {
+                    // Keep the sample under the mouse where it is
+                    double anchor = m_view_start + (io.MousePos.x - plot_min.x) / width * m_view_length;
+                    double length = m_view_length * std::pow(ZOOM_STEP, -io.MouseWheel);
+                    length = std::max(std::min(length, (double)m_pcm_data.size()), MIN_VIEW_SAMPLES);
+                    m_view_start = anchor - (anchor - m_view_start) * length / m_view_length;
+                    m_view_length = length;
                 }
-                
-                zoom_data.clear();
-                for (int i = zoom_start_sample; i < zoom_end_sample; ++i) {
-                    if (i >= 0 && i < (int)m_pcm_data.size()) {
-                        zoom_data.push_back(m_pcm_data[i]);
-                    }
+                if (io.MouseWheelH != 0.0f) {
+                    m_view_start -= io.MouseWheelH * m_view_length * 0.1;
                 }
             }
-            
-            ImVec2 plot_size = ImVec2(plot_width - margin_x * 2.0f, plot_height);
-            std::string waveform_id = "##Waveform_" + std::to_string(m_id);
-            if (m_zoom_enabled && !zoom_data.empty()) {
-                ImGui::PlotLines(waveform_id.c_str(), WaveformGetter, (void*)&zoom_data, (int)zoom_data.size(), 0, NULL, -1.0f, 1.0f, plot_size);
-            } else {
-                ImGui::PlotLines(waveform_id.c_str(), WaveformGetter, (void*)&m_pcm_data, (int)m_pcm_data.size(), 0, NULL, -1.0f, 1.0f, plot_size);
+            if (ImGui::IsItemActive() && ImGui::IsMouseDragging(0) && width > 0.0f) {
+                m_view_start -= ImGui::GetIO().MouseDelta.x / width * m_view_length;
             }
+            ClampView();
+            DrawWaveform(draw_list, plot_min, plot_max);
+            draw_list->AddRect(box_min, box_max, IM_COL32(200, 200, 200, 255), 0.0f, 0, 1.0f);
             
             bool selection_changed = false;
 
             if (m_pcm_data.size() > 0)
             {
-                float width = plot_max.x - plot_min.x;
-                float x_step;
-                float count;
-                
-                if (m_zoom_enabled && !zoom_data.empty()) {
-                    count = (float)(zoom_data.size() > 1 ? zoom_data.size() : 1);
-                    x_step = width / count;
-                } else {
-                    count = (float)(m_pcm_data.size() > 1 ? m_pcm_data.size() : 1);
-                    x_step = width / count;
-                }
+                // Screen x of a sample position in the current view
+                double x_step = width / m_view_length;
+                auto sample_to_x = [&](double sample) {
+                    return plot_min.x + (float)((sample - m_view_start) * x_step);
+                };
                 
                 float handle_size = 10.0f;
                 
@@ -341,22 +409,8 @@ void PCMToolWindow::Render()
                     if (*point < 0) *point = 0;
                     if (*point > (int)m_pcm_data.size()) *point = (int)m_pcm_data.size();
                     
-                    float x;
-                    if (m_zoom_enabled && !zoom_data.empty()) {
-                        int point_in_zoom = *point - zoom_start_sample;
-                        if (zoom_data.size() > 1) {
-                            x = plot_min.x + point_in_zoom * x_step;
-                        } else {
-                            x = plot_min.x + width * 0.5f;
-                        }
-                    } else {
-                        if (m_pcm_data.size() > 1) {
-                            x = plot_min.x + (*point) * x_step;
-                        } else {
-                            x = plot_min.x + width * 0.5f;
-                        }
-                    }
-                    
+                    // Handles outside the view sit at the nearest edge
+                    float x = sample_to_x(*point);
                     if (x > plot_max.x) x = plot_max.x;
                     if (x < plot_min.x) x = plot_min.x;
 
@@ -371,12 +425,13 @@ void PCMToolWindow::Render()
                     
                     if (ImGui::IsItemActive() && ImGui::IsMouseDragging(0))
                     {
-                        float delta_x = ImGui::GetIO().MouseDelta.x;
-                        int delta_samples = (int)(delta_x / x_step);
-                        if (delta_samples != 0) {
-                            *point += delta_samples;
-                            if (*point < 0) *point = 0;
-                            if (*point > (int)m_pcm_data.size()) *point = (int)m_pcm_data.size();
+                        // Follow the mouse rather than summing deltas, which
+                        // rounds away sub-sample moves when zoomed out
+                        double sample = m_view_start + (ImGui::GetIO().MousePos.x - plot_min.x) / x_step;
+                        int target = (int)std::lround(std::max(0.0, std::min(sample, (double)m_pcm_data.size())));
+                        target = SnapToZeroCrossing(target);
+                        if (target != *point) {
+                            *point = target;
                             selection_changed = true;
                         }
                     }
@@ -391,38 +446,62 @@ void PCMToolWindow::Render()
                 
                 handle_tab(&m_start_point, true, IM_COL32(0, 255, 0, 255), start_tab_id.c_str());
                 handle_tab(&m_end_point, false, IM_COL32(255, 0, 0, 255), end_tab_id.c_str());
-                
-                bool is_playing = (m_preview_stream && !m_preview_stream->get_finished());
-                if (is_playing && m_current_playback_position >= 0) {
-                    float x;
-                    if (m_zoom_enabled && !zoom_data.empty()) {
-                        int pos_in_zoom = m_current_playback_position - zoom_start_sample;
-                        if (zoom_data.size() > 1 && pos_in_zoom >= 0 && pos_in_zoom < (int)zoom_data.size()) {
-                            x = plot_min.x + pos_in_zoom * x_step;
-                        } else {
-                            x = -1;
-                        }
-                    } else {
-                        if (m_pcm_data.size() > 1) {
-                            x = plot_min.x + m_current_playback_position * x_step;
-                        } else {
-                            x = plot_min.x + width * 0.5f;
+
+                // Transient slice markers: small tabs above the plot that
+                // drag between their neighbours; right-click removes one
+                if (m_slice_enabled && m_slice_mode == SLICE_TRANSIENTS) {
+                    const float marker_size = 8.0f;
+                    const ImU32 marker_color = IM_COL32(255, 170, 0, 255);
+                    int remove = -1;
+                    for (int i = 0; i < (int)m_slice_markers.size(); ++i) {
+                        int& marker = m_slice_markers[i];
+                        float x = sample_to_x(marker);
+                        if (x < plot_min.x || x > plot_max.x) continue;
+
+                        ImGui::PushID(i);
+                        ImGui::SetCursorScreenPos(ImVec2(x - marker_size / 2, plot_min.y - marker_size));
+                        std::string marker_id = "##slice_marker_" + std::to_string(m_id);
+                        ImGui::InvisibleButton(marker_id.c_str(), ImVec2(marker_size, marker_size));
+                        if (ImGui::IsItemActive() && ImGui::IsMouseDragging(0)) {
+                            int lo = i > 0 ? m_slice_markers[i - 1] + 1 : 0;
+                            int hi = i + 1 < (int)m_slice_markers.size() ? m_slice_markers[i + 1] - 1 : (int)m_pcm_data.size();
+                            double sample = m_view_start + (ImGui::GetIO().MousePos.x - plot_min.x) / x_step;
+                            marker = std::max(lo, std::min(hi, SnapToZeroCrossing((int)std::lround(sample))));
+                            x = sample_to_x(marker);
                         }
+                        if (ImGui::IsItemClicked(1)) remove = i;
+                        ImGui::PopID();
+
+                        draw_list->AddTriangleFilled(ImVec2(x, plot_min.y), ImVec2(x - marker_size / 2, plot_min.y - marker_size),
+                                                     ImVec2(x + marker_size / 2, plot_min.y - marker_size), marker_color);
+                        draw_list->AddLine(ImVec2(x, plot_min.y), ImVec2(x, plot_max.y), marker_color, 1.0f);
                     }
-                    
-                    if (x >= 0) {
-                        if (x > plot_max.x) x = plot_max.x;
-                        if (x < plot_min.x) x = plot_min.x;
+                    if (remove >= 0) m_slice_markers.erase(m_slice_markers.begin() + remove);
+                }
+                
+                bool is_playing = AudioEngine::Get().IsPreviewPlaying(m_id);
+                if (is_playing && m_current_playback_position >= 0) {
+                    float x = sample_to_x(m_current_playback_position);
+                    if (x >= plot_min.x && x <= plot_max.x) {
                         draw_list->AddLine(ImVec2(x, plot_min.y), ImVec2(x, plot_max.y), IM_COL32(0, 150, 255, 255), 2.0f);
                     }
                 }
             }
 
+            // Everything below works on the whole file, so it waits for the load
+            ImGui::BeginDisabled(m_loading);
+
             // Preview controls directly under the waveform
-            bool is_playing = (m_preview_stream && !m_preview_stream->get_finished());
+            bool is_playing = AudioEngine::Get().IsPreviewPlaying(m_id);
             ImGui::SetCursorPosY(ImGui::GetCursorPosY() + margin_y * 0.5f);
             ImGui::Checkbox("Loop Preview", &m_preview_loop);
             ImGui::SameLine();
+            ImGui::SetNextItemWidth(100);
+            std::string gain_id = "##preview_gain_" + std::to_string(m_id);
+            if (ImGui::SliderFloat(gain_id.c_str(), &m_preview_gain, 0.0f, 2.0f, "Volume %.2f")) {
+                AudioEngine::Get().SetPreviewGain(m_id, m_preview_gain);
+            }
+            ImGui::SameLine();
             const char* preview_label = is_playing ? "Stop Preview" : "Preview     ";
             ImVec2 preview_size = ImVec2(ImGui::CalcTextSize("Stop Preview").x + ImGui::GetStyle().FramePadding.x * 2.0f, 0);
             if (ImGui::Button(preview_label, preview_size))
@@ -453,6 +532,17 @@ void PCMToolWindow::Render()
             std::string end_point_id = "End Point##" + std::to_string(m_id);
             if (ImGui::DragInt(start_point_id.c_str(), &m_start_point, 1.0f, 0, m_end_point - 1)) selection_changed = true;
             if (ImGui::DragInt(end_point_id.c_str(), &m_end_point, 1.0f, m_start_point + 1, max_sample)) selection_changed = true;
+            ImGui::Checkbox("Snap to Zero Crossings", &m_snap_to_zero);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Dragged handles and slice points land where the signal changes sign, avoiding clicks");
+            }
+            if (m_snap_to_zero) {
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(160);
+                std::string radius_id = "Radius##snap_radius_" + std::to_string(m_id);
+                ImGui::SliderInt(radius_id.c_str(), &m_snap_radius, 8, 4096, "%d samples");
+                m_snap_radius = std::max(1, std::min(m_snap_radius, (int)MAX_ZERO_CROSSING_RADIUS));
+            }
 
             if (selection_changed && is_playing) {
                 StartPreview();
@@ -460,19 +550,43 @@ void PCMToolWindow::Render()
 
             ImGui::Separator();
             ImGui::Checkbox("Double Speed", &m_double_speed);
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(100);
+            std::string quality_id = "Resampling##quality_" + std::to_string(m_id);
+            if (ImGui::BeginCombo(quality_id.c_str(), GetResampleQualityName(m_resample_quality))) {
+                for (ResampleQuality quality : { ResampleQuality::Fast, ResampleQuality::Normal, ResampleQuality::High }) {
+                    if (ImGui::Selectable(GetResampleQualityName(quality), quality == m_resample_quality)) {
+                        m_resample_quality = quality;
+                    }
+                }
+                ImGui::EndCombo();
+            }
             
             ImGui::Separator();
             ImGui::Checkbox("Enable Slicing", &m_slice_enabled);
             if (m_slice_enabled)
             {
                 ImGui::SameLine();
-                ImGui::SetNextItemWidth(100);
-                ImGui::InputInt("Number of Slices", &m_num_slices, 1, 1);
-                if (m_num_slices < 1) m_num_slices = 1;
-                if (m_num_slices > 100) m_num_slices = 100;
+                ImGui::SetNextItemWidth(110);
+                const char* slice_modes[] = { "Equal Parts", "Transients" };
+                std::string mode_id = "##slice_mode_" + std::to_string(m_id);
+                ImGui::Combo(mode_id.c_str(), &m_slice_mode, slice_modes, 2);
+                ImGui::SameLine();
+                if (m_slice_mode == SLICE_EQUAL) {
+                    ImGui::SetNextItemWidth(100);
+                    ImGui::InputInt("Number of Slices", &m_num_slices, 1, 1);
+                    if (m_num_slices < 1) m_num_slices = 1;
+                    if (m_num_slices > 100) m_num_slices = 100;
+                } else {
+                    RenderTransientControls();
+                }
             }
             
             ImGui::Separator();
+            ImGui::Checkbox("Write Loop Points", &m_write_loop);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Add a smpl chunk looping each exported file from start to end");
+            }
             bool save_clicked = ImGui::Button("Export (17.5kHz Mono s16le)...");
             if (save_clicked)
             {
@@ -515,6 +629,8 @@ void PCMToolWindow::Render()
                     m_browse_save = false;
                 }
             }
+
+            ImGui::EndDisabled();
         }
         
         ImGui::Separator();
@@ -525,192 +641,20 @@ void PCMToolWindow::Render()
 
 void PCMToolWindow::LoadFile(const char* filename)
 {
-    std::string filepath = filename;
-    std::string temp_wav;
-    bool is_mp3 = false;
-    
+    CancelLoad();
     try {
-        size_t dot_pos = filepath.find_last_of('.');
-        if (dot_pos != std::string::npos) {
-            std::string ext = filepath.substr(dot_pos + 1);
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            if (ext == "mp3") {
-                is_mp3 = true;
-            }
-        }
-        
-        if (is_mp3) {
-            temp_wav = filepath + ".temp.wav";
-            std::stringstream cmd;
-            cmd << "ffmpeg -i \"" << filepath << "\" -f wav -acodec pcm_s16le -ar 44100 -ac 2 -y \"" << temp_wav << "\" 2>&1";
-            
-            int result = system(cmd.str().c_str());
-            if (result != 0) {
-                temp_wav = filepath + ".temp.wav";
-                cmd.str("");
-                cmd << "sox \"" << filepath << "\" -r 44100 -c 2 -b 16 \"" << temp_wav << "\" 2>&1";
-                result = system(cmd.str().c_str());
-                if (result != 0) {
-                    m_status_message = "MP3 conversion failed. Please install ffmpeg or sox.";
-                    return;
-                }
-            }
-            filepath = temp_wav;
-        }
-        
-        std::ifstream file(filepath, std::ios::binary);
-        if (!file) {
-            m_status_message = "Failed to open audio file";
-            if (is_mp3 && !temp_wav.empty()) {
-                remove(temp_wav.c_str());
-            }
-            return;
-        }
-
-        char riff[4];
-        file.read(riff, 4);
-        if (memcmp(riff, "RIFF", 4) != 0) {
-            m_status_message = "Not a valid WAV file (RIFF header missing)";
-            if (is_mp3 && !temp_wav.empty()) {
-                remove(temp_wav.c_str());
-            }
+        DecodedAudio audio;
+        std::string error;
+        if (!DecodeAudioFile(filename, audio, error)) {
+            m_status_message = error;
             return;
         }
 
-        uint32_t file_size;
-        file.read((char*)&file_size, 4);
-
-        char wave[4];
-        file.read(wave, 4);
-        if (memcmp(wave, "WAVE", 4) != 0) {
-            m_status_message = "Not a valid WAV file (WAVE header missing)";
-            if (is_mp3 && !temp_wav.empty()) {
-                remove(temp_wav.c_str());
-            }
-            return;
-        }
-
-        uint16_t num_channels = 0;
-        uint32_t sample_rate_val = 0;
-        uint16_t bits_per_sample = 0;
-        uint16_t audio_format = 0;
-        std::vector<std::vector<int16_t>> channel_data;
-        bool found_fmt = false;
-        bool found_data = false;
-
-        while (file && !found_data) {
-            char chunk_id[4];
-            uint32_t chunk_size;
-            file.read(chunk_id, 4);
-            if (file.gcount() != 4) break;
-            file.read((char*)&chunk_size, 4);
-            if (file.gcount() != 4) break;
-
-            if (memcmp(chunk_id, "fmt ", 4) == 0) {
-                file.read((char*)&audio_format, 2);
-                file.read((char*)&num_channels, 2);
-                file.read((char*)&sample_rate_val, 4);
-                uint32_t byte_rate;
-                file.read((char*)&byte_rate, 4);
-                uint16_t block_align;
-                file.read((char*)&block_align, 2);
-                file.read((char*)&bits_per_sample, 2);
-                
-                if (chunk_size > 16) {
-                    file.seekg(chunk_size - 16, std::ios::cur);
-                }
-                found_fmt = true;
-            }
-            else if (memcmp(chunk_id, "data", 4) == 0) {
-                if (!found_fmt || num_channels == 0) {
-                    m_status_message = "Invalid WAV format (missing format info)";
-                    if (is_mp3 && !temp_wav.empty()) {
-                        remove(temp_wav.c_str());
-                    }
-                    return;
-                }
-
-                if (audio_format != 1) {
-                    m_status_message = "Unsupported audio format (only PCM supported)";
-                    if (is_mp3 && !temp_wav.empty()) {
-                        remove(temp_wav.c_str());
-                    }
-                    return;
-                }
-
-                channel_data.resize(num_channels);
-                size_t bytes_per_sample = bits_per_sample / 8;
-                size_t samples = chunk_size / (num_channels * bytes_per_sample);
-                
-                for (size_t i = 0; i < samples; ++i) {
-                    for (int ch = 0; ch < num_channels; ++ch) {
-                        int32_t sample_value = 0;
-                        
-                        if (bits_per_sample == 8) {
-                            uint8_t sample_u8;
-                            file.read((char*)&sample_u8, 1);
-                            sample_value = ((int32_t)sample_u8 - 128) << 8;
-                        }
-                        else if (bits_per_sample == 16) {
-                            int16_t sample_s16;
-                            file.read((char*)&sample_s16, 2);
-                            sample_value = (int32_t)sample_s16;
-                        }
-                        else if (bits_per_sample == 24) {
-                            uint8_t bytes[3];
-                            file.read((char*)bytes, 3);
-                            int32_t sample_24 = (int32_t)(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16));
-                            if (sample_24 & 0x800000) sample_24 |= 0xFF000000;
-                            sample_value = sample_24 >> 8;
-                        }
-                        else if (bits_per_sample == 32) {
-                            int32_t sample_s32;
-                            file.read((char*)&sample_s32, 4);
-                            sample_value = sample_s32 >> 16;
-                        }
-                        else {
-                            m_status_message = "Unsupported bit depth: " + std::to_string(bits_per_sample);
-                            if (is_mp3 && !temp_wav.empty()) {
-                                remove(temp_wav.c_str());
-                            }
-                            return;
-                        }
-                        
-                        if (sample_value > 32767) sample_value = 32767;
-                        if (sample_value < -32768) sample_value = -32768;
-                        
-                        channel_data[ch].push_back((int16_t)sample_value);
-                    }
-                }
-                found_data = true;
-            }
-            else {
-                if (chunk_size % 2 == 1) chunk_size++;
-                file.seekg(chunk_size, std::ios::cur);
-            }
-        }
-
-        if (!found_data || channel_data.empty() || channel_data[0].empty()) {
-            m_status_message = "No audio data found in WAV file";
-            if (is_mp3 && !temp_wav.empty()) {
-                remove(temp_wav.c_str());
-            }
-            return;
-        }
-
-        m_sample_rate = sample_rate_val;
-        m_channels = num_channels;
-        size_t samples = channel_data[0].size();
-
-        m_pcm_data.resize(samples);
-        for(size_t i = 0; i < samples; ++i) {
-            int32_t sum = 0;
-            for(int c = 0; c < m_channels; ++c) {
-                if (i < channel_data[c].size())
-                    sum += channel_data[c][i];
-            }
-            m_pcm_data[i] = (short)(sum / m_channels);
-        }
+        m_sample_rate = audio.sample_rate;
+        m_channels = audio.channels;
+        size_t samples = audio.samples.size();
+        m_pcm_data = SampleBuffer(std::move(audio.samples));
+        OnDataReplaced();
 
         m_start_point = 0;
         m_end_point = (int)samples;
@@ -721,16 +665,103 @@ void PCMToolWindow::LoadFile(const char* filename)
         m_current_filename = filename;
         strncpy(m_input_path, filename, sizeof(m_input_path)-1);
         
-        if (is_mp3 && !temp_wav.empty()) {
-            remove(temp_wav.c_str());
-        }
-        
     } catch (std::exception& e) {
         m_status_message = "Error loading file: " + std::string(e.what());
-        if (is_mp3 && !temp_wav.empty()) {
-            remove(temp_wav.c_str());
+    }
+}
+
+void PCMToolWindow::StartLoad(const std::string& filename)
+{
+    CancelLoad();
+    m_loading = true;
+    m_load_started = false;
+    m_load_path = filename;
+    m_load_sample_rate = 0;
+    m_load_channels = 0;
+    m_load_total = 0;
+    m_status_message = "Loading " + filename;
+
+    m_load_task.Start([this](BackgroundTask& task) {
+        DecodeOptions options;
+        options.task = &task;
+        options.on_format = [this](int sample_rate, int channels, uint64_t total_frames) {
+            std::lock_guard<std::mutex> lock(m_load_mutex);
+            m_load_sample_rate = sample_rate;
+            m_load_channels = channels;
+            m_load_total = total_frames;
+        };
+        options.on_samples = [this](const short* samples, size_t count) {
+            std::lock_guard<std::mutex> lock(m_load_mutex);
+            m_load_pending.insert(m_load_pending.end(), samples, samples + count);
+        };
+        DecodedAudio audio;
+        m_load_ok = DecodeAudioFile(m_load_path, audio, m_load_error, options);
+    });
+}
+
+void PCMToolWindow::PollLoad()
+{
+    // Checked before taking the pending blocks, so nothing the job produced
+    // just before finishing is left behind
+    bool finished = !m_load_task.IsRunning();
+
+    {
+        std::lock_guard<std::mutex> lock(m_load_mutex);
+        if (!m_load_pending.empty()) {
+            if (!m_load_started) {
+                // The previous file stays until the new one has audio, so a
+                // file that fails to open leaves the window as it was
+                StopPreview();
+                m_pcm_data.Reset();
+                OnDataReplaced();
+                m_pcm_data.Edit().reserve((size_t)std::min<uint64_t>(m_load_total, MAX_LOAD_RESERVE));
+                m_sample_rate = m_load_sample_rate;
+                m_channels = m_load_channels;
+                m_start_point = 0;
+                m_end_point = 0;
+                m_current_filename = m_load_path;
+                strncpy(m_input_path, m_load_path.c_str(), sizeof(m_input_path)-1);
+                m_load_started = true;
+            }
+            // An end point left at the end of the data follows it as it grows
+            // and so does a view showing all of it
+            bool follow_end = m_end_point == (int)m_pcm_data.size();
+            bool follow_view = m_view_start <= 0.0 && m_view_length >= (double)m_pcm_data.size();
+            std::vector<short>& samples = m_pcm_data.Edit();
+            samples.insert(samples.end(), m_load_pending.begin(), m_load_pending.end());
+            m_load_pending.clear();
+            if (follow_end) m_end_point = (int)m_pcm_data.size();
+            if (follow_view) m_view_length = 0.0;
+        }
+        if (finished) {
+            std::vector<short>().swap(m_load_pending);
         }
     }
+    if (!finished) return;
+
+    m_load_task.Join();
+    m_loading = false;
+    if (m_load_ok) {
+        m_status_message = "Loaded " + m_load_path;
+        return;
+    }
+    m_status_message = m_load_task.IsCancelled() ? "Loading cancelled" : m_load_error;
+    if (m_load_started) {
+        // Drop the part that did arrive rather than leave a truncated file
+        m_pcm_data.Reset();
+        OnDataReplaced();
+        m_start_point = 0;
+        m_end_point = 0;
+        m_current_filename.clear();
+    }
+}
+
+void PCMToolWindow::CancelLoad()
+{
+    if (!m_loading) return;
+    m_load_task.Cancel();
+    m_load_task.Join();
+    PollLoad();
 }
 
 void PCMToolWindow::SaveFile(const char* filename)
@@ -747,105 +778,43 @@ void PCMToolWindow::StartPreview()
     m_current_playback_position = m_start_point;
     
     std::shared_ptr<PCM_Preview_Stream> stream = std::make_shared<PCM_Preview_Stream>(
-        m_pcm_data, m_start_point, m_end_point, m_sample_rate, m_preview_loop, &m_current_playback_position
+        m_pcm_data, m_start_point, m_end_point, m_sample_rate, m_preview_loop
     );
     
-    m_preview_stream = stream;
-    Audio_Manager::get().add_stream(m_preview_stream);
+    AudioEngine::Get().StartPreview(m_id, stream, m_preview_gain);
 }
 
 void PCMToolWindow::StopPreview()
 {
-    if (m_preview_stream)
-    {
-        m_preview_stream->set_finished(true);
-        m_preview_stream.reset();
-    }
+    AudioEngine::Get().StopPreview(m_id);
     m_current_playback_position = -1;
 }
 
-void PCMToolWindow::ResampleAndSave(const char* filename)
+// The selection as it is exported, into output
+bool PCMToolWindow::ProcessSelection(std::vector<short>& output)
 {
-    if (m_pcm_data.empty()) return;
-
-    int target_rate = 17500;
-    
     if (m_start_point < 0) m_start_point = 0;
     if (m_end_point > (int)m_pcm_data.size()) m_end_point = (int)m_pcm_data.size();
     if (m_start_point >= m_end_point) {
         m_status_message = "Invalid selection range";
-        return;
+        return false;
     }
 
-    std::vector<short> selection;
-    selection.reserve(m_end_point - m_start_point);
-    for(int i = m_start_point; i < m_end_point; ++i) {
-        selection.push_back(m_pcm_data[i]);
-    }
-
-    std::vector<short> resampled;
-    if (m_sample_rate == target_rate) {
-        resampled = selection;
-    } else {
-        double ratio = (double)m_sample_rate / (double)target_rate;
-        int new_length = (int)(selection.size() / ratio);
-        resampled.resize(new_length);
-        
-        for(int i = 0; i < new_length; ++i) {
-            double src_idx = i * ratio;
-            int idx0 = (int)src_idx;
-            int idx1 = idx0 + 1;
-            float frac = (float)(src_idx - idx0);
-            
-            if (idx1 >= (int)selection.size()) idx1 = idx0;
-            
-            float s0 = selection[idx0];
-            float s1 = selection[idx1];
-            resampled[i] = (short)(s0 + (s1 - s0) * frac);
-        }
-    }
+    PcmPipeline::Settings settings;
+    settings.source_rate = m_sample_rate;
+    settings.target_rate = TARGET_RATE;
+    settings.double_speed = m_double_speed;
+    settings.quality = m_resample_quality;
+    return m_pipeline.Process(m_pcm_data, m_start_point, m_end_point, settings, output);
+}
 
-    // Apply speed doubling if enabled (skip every other sample)
-    if (m_double_speed) {
-        std::vector<short> speed_doubled;
-        speed_doubled.reserve(resampled.size() / 2);
-        for (size_t i = 0; i < resampled.size(); i += 2) {
-            speed_doubled.push_back(resampled[i]);
-        }
-        resampled = speed_doubled;
-    }
+void PCMToolWindow::ResampleAndSave(const char* filename)
+{
+    if (m_pcm_data.empty()) return;
+    if (!ProcessSelection(m_export_buffer)) return;
 
-    std::ofstream out(filename, std::ios::binary);
-    if (out) {
-        uint32_t dataSize = (uint32_t)resampled.size() * sizeof(short);
-        uint32_t fileSize = dataSize + 36;
-        
-        out.write("RIFF", 4);
-        out.write((const char*)&fileSize, 4);
-        out.write("WAVE", 4);
-        out.write("fmt ", 4);
-        
-        uint32_t fmtSize = 16;
-        uint16_t audioFormat = 1;
-        uint16_t numChannels = 1;
-        uint32_t sampleRate = 17500;
-        uint32_t byteRate = sampleRate * numChannels * sizeof(short);
-        uint16_t blockAlign = numChannels * sizeof(short);
-        uint16_t bitsPerSample = 16;
-        
-        out.write((const char*)&fmtSize, 4);
-        out.write((const char*)&audioFormat, 2);
-        out.write((const char*)&numChannels, 2);
-        out.write((const char*)&sampleRate, 4);
-        out.write((const char*)&byteRate, 4);
-        out.write((const char*)&blockAlign, 2);
-        out.write((const char*)&bitsPerSample, 2);
-        
-        out.write("data", 4);
-        out.write((const char*)&dataSize, 4);
-        
-        out.write((char*)resampled.data(), dataSize);
-        m_status_message = "Exported " + std::to_string(resampled.size()) + " samples to " + std::string(filename);
+    if (PcmPipeline::WriteWav(filename, m_export_buffer, TARGET_RATE, m_write_loop)) {
+        m_status_message = "Exported " + std::to_string(m_export_buffer.size()) + " samples to " + std::string(filename);
     } else {
         m_status_message = "Failed to write output file";
     }
@@ -854,56 +823,58 @@ void PCMToolWindow::ResampleAndSave(const char* filename)
 void PCMToolWindow::ResampleAndSaveSlices(const char* base_filename)
 {
     if (m_pcm_data.empty()) return;
-    if (m_num_slices < 1) {
+    if (m_slice_mode == SLICE_EQUAL && m_num_slices < 1) {
         m_status_message = "Invalid number of slices";
         return;
     }
 
-    int target_rate = 17500;
-    
-    if (m_start_point < 0) m_start_point = 0;
-    if (m_end_point > (int)m_pcm_data.size()) m_end_point = (int)m_pcm_data.size();
-    if (m_start_point >= m_end_point) {
-        m_status_message = "Invalid selection range";
-        return;
-    }
+    if (!ProcessSelection(m_export_buffer)) return;
 
-    std::vector<short> selection;
-    selection.reserve(m_end_point - m_start_point);
-    for(int i = m_start_point; i < m_end_point; ++i) {
-        selection.push_back(m_pcm_data[i]);
+    // Cut points in the exported buffer: equal parts (the last taking the
+    // remainder), or the markers inside the selection scaled to where they
+    // land after resampling
+    std::vector<size_t> cuts;
+    double scale = (double)m_export_buffer.size() / (m_end_point - m_start_point);
+    if (m_slice_mode == SLICE_EQUAL) {
+        size_t per_slice = m_export_buffer.size() / m_num_slices;
+        for (int i = 1; i < m_num_slices; ++i) cuts.push_back(per_slice * i);
+    } else {
+        for (int marker : m_slice_markers) {
+            if (marker > m_start_point && marker < m_end_point) {
+                cuts.push_back((size_t)std::lround((marker - m_start_point) * scale));
+            }
+        }
     }
 
-    std::vector<short> resampled;
-    if (m_sample_rate == target_rate) {
-        resampled = selection;
-    } else {
-        double ratio = (double)m_sample_rate / (double)target_rate;
-        int new_length = (int)(selection.size() / ratio);
-        resampled.resize(new_length);
-        
-        for(int i = 0; i < new_length; ++i) {
-            double src_idx = i * ratio;
-            int idx0 = (int)src_idx;
-            int idx1 = idx0 + 1;
-            float frac = (float)(src_idx - idx0);
-            
-            if (idx1 >= (int)selection.size()) idx1 = idx0;
-            
-            float s0 = selection[idx0];
-            float s1 = selection[idx1];
-            resampled[i] = (short)(s0 + (s1 - s0) * frac);
+    // Resampling shifts crossings by a sample or two, so snapped cuts are
+    // snapped again in the output; equal parts only get snapped here
+    std::vector<size_t> snapped;
+    for (size_t cut : cuts) {
+        if (m_snap_to_zero) {
+            size_t radius = (size_t)std::max(1.0, std::ceil(m_snap_radius * scale));
+            cut = FindZeroCrossing(m_export_buffer.data(), m_export_buffer.size(), cut, radius);
+        }
+        if (m_slice_mode == SLICE_EQUAL) {
+            // Kept in order when two cuts snap together; the empty slice
+            // between them is dropped below
+            snapped.push_back(snapped.empty() ? cut : std::max(cut, snapped.back()));
+        } else if (cut > 0 && cut < m_export_buffer.size() && (snapped.empty() || cut > snapped.back())) {
+            snapped.push_back(cut);
         }
     }
 
-    // Apply speed doubling if enabled
-    if (m_double_speed) {
-        std::vector<short> speed_doubled;
-        speed_doubled.reserve(resampled.size() / 2);
-        for (size_t i = 0; i < resampled.size(); i += 2) {
-            speed_doubled.push_back(resampled[i]);
+    // Cuts that met (snapped together, or more equal parts than samples)
+    // leave empty slices; those are left out rather than written as files
+    // with no audio
+    std::vector<PcmSpan> slices;
+    int empty_count = 0;
+    for (int i = 0; i <= (int)snapped.size(); ++i) {
+        PcmSpan slice = PcmPipeline::SliceAt(m_export_buffer, snapped, i);
+        if (slice.size > 0) {
+            slices.push_back(slice);
+        } else {
+            ++empty_count;
         }
-        resampled = speed_doubled;
     }
 
     std::string base_path = base_filename;
@@ -912,71 +883,28 @@ void PCMToolWindow::ResampleAndSaveSlices(const char* base_filename)
         base_path = base_path.substr(0, base_path.length() - 4);
     }
     
-    int samples_per_slice = (int)resampled.size() / m_num_slices;
-    int saved_count = 0;
-    
-    for (int slice = 0; slice < m_num_slices; ++slice)
-    {
-        int slice_start = slice * samples_per_slice;
-        int slice_end = (slice == m_num_slices - 1) ? (int)resampled.size() : (slice + 1) * samples_per_slice;
-        
-        std::vector<short> slice_data;
-        slice_data.reserve(slice_end - slice_start);
-        for (int i = slice_start; i < slice_end; ++i)
-        {
-            slice_data.push_back(resampled[i]);
-        }
-        
-        std::string slice_filename = base_path + "-" + std::to_string(slice + 1) + ".wav";
-        
-        std::ofstream out(slice_filename, std::ios::binary);
-        if (out) {
-            uint32_t dataSize = (uint32_t)slice_data.size() * sizeof(short);
-            uint32_t fileSize = dataSize + 36;
-            
-            out.write("RIFF", 4);
-            out.write((const char*)&fileSize, 4);
-            out.write("WAVE", 4);
-            out.write("fmt ", 4);
-            
-            uint32_t fmtSize = 16;
-            uint16_t audioFormat = 1;
-            uint16_t numChannels = 1;
-            uint32_t sampleRate = 17500;
-            uint32_t byteRate = sampleRate * numChannels * sizeof(short);
-            uint16_t blockAlign = numChannels * sizeof(short);
-            uint16_t bitsPerSample = 16;
-            
-            out.write((const char*)&fmtSize, 4);
-            out.write((const char*)&audioFormat, 2);
-            out.write((const char*)&numChannels, 2);
-            out.write((const char*)&sampleRate, 4);
-            out.write((const char*)&byteRate, 4);
-            out.write((const char*)&blockAlign, 2);
-            out.write((const char*)&bitsPerSample, 2);
-            
-            out.write("data", 4);
-            out.write((const char*)&dataSize, 4);
-            
-            out.write((char*)slice_data.data(), dataSize);
-            saved_count++;
-        }
-    }
-    
-    if (saved_count == m_num_slices) {
-        m_status_message = "Exported " + std::to_string(m_num_slices) + " slices to " + base_path + "-*.wav";
+    int slice_count = (int)slices.size();
+    int saved_count = PcmPipeline::WriteSlices(base_path, slices, TARGET_RATE, m_write_loop);
+
+    if (saved_count == slice_count) {
+        m_status_message = "Exported " + std::to_string(slice_count) + " slices to " + base_path + "-*.wav";
     } else {
-        m_status_message = "Exported " + std::to_string(saved_count) + " of " + std::to_string(m_num_slices) + " slices";
+        m_status_message = "Exported " + std::to_string(saved_count) + " of " + std::to_string(slice_count) + " slices";
+    }
+    if (empty_count > 0) {
+        m_status_message += " (" + std::to_string(empty_count) + " empty skipped)";
     }
 }
 
-void PCMToolWindow::LoadPCMData(const std::vector<short>& data, int rate, int ch, const std::string& name)
+void PCMToolWindow::LoadPCMData(SampleBuffer data, int rate, int ch, const std::string& name)
 {
-    m_pcm_data = data;
+    CancelLoad();
+    m_pcm_data = std::move(data);
+    OnDataReplaced();
     m_sample_rate = rate;
     m_channels = ch;
     m_start_point = 0;
-    m_end_point = (int)data.size();
+    m_end_point = (int)m_pcm_data.size();
     m_current_filename = name.empty() ? "Exported Selection" : name;
     m_status_message = "Loaded " + m_current_filename;
     StopPreview();
@@ -999,63 +927,26 @@ void PCMToolWindow::ExportToNewWindow()
         return;
     }
 
-    int target_rate = 17500;
-    
-    // 1. Extract selection
-    if (m_start_point < 0) m_start_point = 0;
-    if (m_end_point > (int)m_pcm_data.size()) m_end_point = (int)m_pcm_data.size();
-    if (m_start_point >= m_end_point) {
-        m_status_message = "Invalid selection range";
-        return;
-    }
-
-    std::vector<short> selection;
-    selection.reserve(m_end_point - m_start_point);
-    for(int i = m_start_point; i < m_end_point; ++i) {
-        selection.push_back(m_pcm_data[i]);
-    }
-
-    // 2. Resample
-    std::vector<short> resampled;
-    if (m_sample_rate == target_rate) {
-        resampled = selection;
+    // Processed into its own buffer, which the new window takes over. When
+    // processing would not change anything, the window shares ours instead.
+    SampleBuffer exported;
+    bool unchanged = m_sample_rate == TARGET_RATE && !m_double_speed &&
+                     m_start_point <= 0 && m_end_point >= (int)m_pcm_data.size();
+    if (unchanged && !m_pcm_data.empty()) {
+        exported = m_pcm_data;
     } else {
-        double ratio = (double)m_sample_rate / (double)target_rate;
-        int new_length = (int)(selection.size() / ratio);
-        resampled.resize(new_length);
-        
-        for(int i = 0; i < new_length; ++i) {
-            double src_idx = i * ratio;
-            int idx0 = (int)src_idx;
-            int idx1 = idx0 + 1;
-            float frac = (float)(src_idx - idx0);
-            
-            if (idx1 >= (int)selection.size()) idx1 = idx0;
-            
-            float s0 = selection[idx0];
-            float s1 = selection[idx1];
-            resampled[i] = (short)(s0 + (s1 - s0) * frac);
-        }
-    }
-
-    // 3. Apply speed doubling if enabled
-    if (m_double_speed) {
-        std::vector<short> speed_doubled;
-        speed_doubled.reserve(resampled.size() / 2);
-        for (size_t i = 0; i < resampled.size(); i += 2) {
-            speed_doubled.push_back(resampled[i]);
-        }
-        resampled = speed_doubled;
+        std::vector<short> resampled;
+        if (!ProcessSelection(resampled)) return;
+        exported = SampleBuffer(std::move(resampled));
     }
 
-    // 4. Create new window with processed data
     std::string export_name = m_current_filename.empty() ? "Exported Selection" : m_current_filename + " (exported)";
     
     auto new_window = std::make_shared<PCMToolWindow>();
-    new_window->LoadPCMData(resampled, target_rate, 1, export_name);
+    new_window->LoadPCMData(exported, TARGET_RATE, 1, export_name);
     new_window->SetOpen(true);
     
     s_create_window_callback(new_window);
     
-    m_status_message = "Exported " + std::to_string(resampled.size()) + " samples to new window";
+    m_status_message = "Exported " + std::to_string(exported.size()) + " samples to new window";
 }
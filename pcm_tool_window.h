@@ -4,11 +4,17 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <functional>
+#include <cstdint>
+#include "background_task.h"
 #include "imguifilesystem.h"
+#include "pcm_pipeline.h"
+#include "onset_detector.h"
+#include "waveform_peaks.h"
 
-// Forward declarations
-class Audio_Stream;
+struct ImDrawList;
+struct ImVec2;
 
 class PCMToolWindow {
 public:
@@ -18,7 +24,7 @@ public:
     void Render();
     bool IsOpen() const { return m_open; }
     void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
-    void LoadPCMData(const std::vector<short>& data, int rate, int ch, const std::string& name = "");
+    void LoadPCMData(SampleBuffer data, int rate, int ch, const std::string& name = "");
     
     // Callback type for creating new windows
     typedef std::function<void(std::shared_ptr<PCMToolWindow>)> CreateWindowCallback;
@@ -27,7 +33,11 @@ public:
 private:
     void ExportToNewWindow();
     void LoadFile(const char* filename);
+    void StartLoad(const std::string& filename);
+    void PollLoad();
+    void CancelLoad();
     void SaveFile(const char* filename);
+    bool ProcessSelection(std::vector<short>& output);
     void ResampleAndSave(const char* filename);
     void ResampleAndSaveSlices(const char* base_filename);
     void StartPreview();
@@ -38,26 +48,43 @@ private:
     bool m_browse_save;
     char m_input_path[1024];
 
-    std::vector<short> m_pcm_data;
+    SampleBuffer m_pcm_data;            // Shared with previews and exported windows
     int m_sample_rate;
     int m_channels;
     int m_start_point;
     int m_end_point;
+    bool m_snap_to_zero;                // Dragged points land on zero crossings
+    int m_snap_radius;                  // Samples either side searched when snapping
     
     bool m_preview_loop;
+    float m_preview_gain;               // Each window's previews mix at their own gain
     bool m_double_speed;
-    std::shared_ptr<Audio_Stream> m_preview_stream;
-    int m_current_playback_position;
+    bool m_write_loop;                      // smpl chunk looping each exported file
+    ResampleQuality m_resample_quality;
+    PcmPipeline m_pipeline;                 // Keeps the filter between exports
+    std::vector<short> m_export_buffer;     // Reused by file exports
+    int m_current_playback_position;  // Mirrored from AudioEngine each frame
     
     // Slicing options
+    enum SliceMode {
+        SLICE_EQUAL,
+        SLICE_TRANSIENTS
+    };
     bool m_slice_enabled;
     int m_num_slices;
+    int m_slice_mode;                   // SliceMode; an int for ImGui::Combo
+    OnsetSettings m_onset_settings;
+    std::vector<int> m_slice_markers;   // Cut points in m_pcm_data, ascending
+    double m_detected_bpm;
     
-    // Zoom state
-    bool m_zoom_enabled;
-    int m_zoom_point;
-    float m_zoom_level;
-    int m_zoom_window_samples;
+    // Waveform view, in samples; a length of 0 means the whole file
+    double m_view_start;
+    double m_view_length;
+    bool m_waveform_hovered;            // Last frame; stops the wheel scrolling the window
+    WaveformPeaks m_peaks;              // Follows m_pcm_data, cleared when it is replaced
+    std::vector<short> m_column_min;    // Per-pixel peaks, reused between frames
+    std::vector<short> m_column_max;
+    std::vector<ImVec2> m_wave_points;
 
     std::string m_status_message;
     std::string m_current_filename;
@@ -70,8 +97,41 @@ private:
     static CreateWindowCallback s_create_window_callback;
     static uint32_t s_id_counter;  // Counter for unique IDs
     
-    // Waveform visualization helper
-    static float WaveformGetter(void* data, int idx);
+    void OnDataReplaced();
+    int SnapToZeroCrossing(int position) const;
+
+    // Transient detection runs on m_onset_task; its result is picked up by
+    // RenderTransientControls() once the job has finished
+    void RenderTransientControls();
+    void StartOnsetDetection();
+    bool m_onset_pending;
+    int m_onset_start;                  // Selection start the job analysed from
+    OnsetResult m_onset_result;         // Written by the job
+
+    // Waveform drawing; the view is clamped to the data
+    void ClampView();
+    void DrawWaveform(ImDrawList* draw_list, const ImVec2& plot_min, const ImVec2& plot_max);
+
+    // Background loading: the job passes decoded blocks through
+    // m_load_pending and PollLoad() appends them to m_pcm_data each frame,
+    // so the waveform fills in while the rest of the editor keeps running
+    bool m_loading;
+    bool m_load_started;                // First block has replaced the previous file
+    std::string m_load_path;
+    std::mutex m_load_mutex;
+    std::vector<short> m_load_pending;  // Guarded by m_load_mutex
+    int m_load_sample_rate;             // Guarded by m_load_mutex
+    int m_load_channels;                // Guarded by m_load_mutex
+    uint64_t m_load_total;              // Guarded by m_load_mutex; estimate, 0 if unknown
+
+    // Owned by the job while it runs
+    std::string m_load_error;
+    bool m_load_ok;
+    BackgroundTask m_onset_task;
+    BackgroundTask m_load_task;         // After the fields above, so it is joined first
+
+    friend class HotPathBench;  // bench.cpp times loading and resampling directly
+    friend class UiFrameBench;  // ui_bench.cpp scripts zoom and loads long files
 };
 
 #endif // PCM_TOOL_WINDOW_H
@@ -0,0 +1,438 @@
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2 1
+#endif
+
+namespace {
+const double PI = 3.14159265358979323846;
+
+// Kaiser window shape; 8.0 gives roughly 80 dB of stopband rejection
+const double KAISER_BETA = 8.0;
+
+// Passband edge as a fraction of the lower Nyquist frequency
+const double PASSBAND = 0.91;
+
+const int BASE_TAPS = 32;
+const int MAX_TAPS = 128;
+const int PHASE_BITS = 9;       // 512 phases, linearly interpolated
+
+// Frames kept in reserve so steady-state Push() never reallocates
+const size_t RESERVE_FRAMES = 16384;
+
+// Offline presets. Each passband is set so that the Kaiser transition band
+// for its taps and beta ends at the output Nyquist frequency.
+struct QualityPreset {
+    const char* name;
+    int taps;
+    double passband;
+    double beta;
+};
+
+const QualityPreset QUALITY_PRESETS[] = {
+    { "Fast", 16, 0.76, 6.0 },
+    { "Normal", 32, 0.85, 8.0 },
+    { "High", 64, 0.90, 10.0 },
+};
+
+// Decimating by more than this stops adding taps
+const int MAX_OFFLINE_TAPS = 1024;
+
+// Largest exact phase count; beyond it rows are interpolated
+const int MAX_EXACT_PHASES = 1024;
+
+const QualityPreset& GetPreset(ResampleQuality quality) {
+    size_t index = std::min((size_t)quality, sizeof(QUALITY_PRESETS) / sizeof(QUALITY_PRESETS[0]) - 1);
+    return QUALITY_PRESETS[index];
+}
+
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// out[i] = a[i] + t * (b[i] - a[i])
+void InterpolateRow(const float* a, const float* b, float t, float* out, int n) {
+    int i = 0;
+#ifdef RESAMPLER_SSE2
+    __m128 vt = _mm_set1_ps(t);
+    for (; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(vt, _mm_sub_ps(vb, va))));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = a[i] + t * (b[i] - a[i]);
+    }
+}
+
+// Dot product of one coefficient row with both channels at once
+void Dot2(const float* c, const float* l, const float* r, int n, float& out_l, float& out_r) {
+    int i = 0;
+    float sum_l = 0.0f;
+    float sum_r = 0.0f;
+#ifdef RESAMPLER_SSE2
+    __m128 acc_l = _mm_setzero_ps();
+    __m128 acc_r = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 vc = _mm_loadu_ps(c + i);
+        acc_l = _mm_add_ps(acc_l, _mm_mul_ps(vc, _mm_loadu_ps(l + i)));
+        acc_r = _mm_add_ps(acc_r, _mm_mul_ps(vc, _mm_loadu_ps(r + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc_l);
+    sum_l = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, acc_r);
+    sum_r = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; ++i) {
+        sum_l += c[i] * l[i];
+        sum_r += c[i] * r[i];
+    }
+    out_l = sum_l;
+    out_r = sum_r;
+}
+
+// Dot product of one coefficient row with a single channel
+float Dot1(const float* c, const float* x, int n) {
+    int i = 0;
+    float sum = 0.0f;
+#ifdef RESAMPLER_SSE2
+    // Two accumulators, so consecutive adds do not wait on each other
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(c + i), _mm_loadu_ps(x + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(c + i + 4), _mm_loadu_ps(x + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(c + i), _mm_loadu_ps(x + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; ++i) {
+        sum += c[i] * x[i];
+    }
+    return sum;
+}
+
+int32_t ToSample(float value) {
+    return (int32_t)std::lrintf(value);
+}
+
+short ToShort(float value) {
+    return (short)std::max(-32768, std::min(32767, ToSample(value)));
+}
+
+// Exact rational form of in_rate / out_rate, if both are whole numbers
+bool ReduceRates(double in_rate, double out_rate, uint64_t& in_step, uint64_t& out_step) {
+    if (in_rate < 1.0 || out_rate < 1.0 || in_rate > 4294967295.0 || out_rate > 4294967295.0) return false;
+    if (in_rate != std::floor(in_rate) || out_rate != std::floor(out_rate)) return false;
+    uint64_t a = (uint64_t)in_rate;
+    uint64_t b = (uint64_t)out_rate;
+    uint64_t x = a, y = b;
+    while (y != 0) {
+        uint64_t t = x % y;
+        x = y;
+        y = t;
+    }
+    in_step = a / x;
+    out_step = b / x;
+    return true;
+}
+} // namespace
+
+//=====================================================================
+// PolyphaseFilter
+//=====================================================================
+
+PolyphaseFilter::PolyphaseFilter() : m_taps(0), m_phases(0)
+{
+}
+
+void PolyphaseFilter::Design(double ratio, int taps, int phases)
+{
+    Design(ratio, taps, phases, PASSBAND, KAISER_BETA);
+}
+
+void PolyphaseFilter::Design(double ratio, int taps, int phases, double passband, double beta)
+{
+    m_taps = std::max(4, (taps + 3) & ~3);
+    m_phases = std::max(1, phases);
+    m_table.assign((size_t)(m_phases + 1) * m_taps, 0.0f);
+
+    // Cutoff relative to the input Nyquist; below 1 when decimating
+    double cutoff = std::min(1.0, ratio) * passband;
+    double half = m_taps / 2.0;
+    double i0_beta = BesselI0(beta);
+
+    for (int p = 0; p <= m_phases; ++p) {
+        float* row = &m_table[(size_t)p * m_taps];
+        double frac = (double)p / m_phases;
+        double sum = 0.0;
+        for (int k = 0; k < m_taps; ++k) {
+            // Distance from the output position to input tap k
+            double x = (k - (half - 1.0)) - frac;
+            double sinc = (x == 0.0) ? 1.0 : std::sin(PI * cutoff * x) / (PI * cutoff * x);
+            double w = x / half;
+            double window = (std::fabs(w) >= 1.0) ? 0.0 : BesselI0(beta * std::sqrt(1.0 - w * w)) / i0_beta;
+            double h = cutoff * sinc * window;
+            row[k] = (float)h;
+            sum += h;
+        }
+        // Unity gain at DC for every phase
+        if (sum != 0.0) {
+            for (int k = 0; k < m_taps; ++k) {
+                row[k] = (float)(row[k] / sum);
+            }
+        }
+    }
+}
+
+//=====================================================================
+// StreamResampler
+//=====================================================================
+
+StreamResampler::StreamResampler()
+    : m_step(1ull << 32), m_position(0), m_frames(0), m_phase_shift(32 - PHASE_BITS)
+{
+}
+
+void StreamResampler::Configure(double in_rate, double out_rate)
+{
+    double ratio = out_rate / in_rate;
+
+    // Keep the transition band the same width in output terms when decimating
+    int taps = (int)std::ceil(BASE_TAPS / std::min(1.0, ratio));
+    m_filter.Design(ratio, std::min(taps, MAX_TAPS), 1 << PHASE_BITS);
+    m_step = (uint64_t)std::llround(in_rate / out_rate * 4294967296.0);
+    m_coeffs.assign(m_filter.GetTaps(), 0.0f);
+
+    size_t capacity = RESERVE_FRAMES + m_filter.GetTaps();
+    m_left.assign(capacity, 0.0f);
+    m_right.assign(capacity, 0.0f);
+    Reset();
+}
+
+void StreamResampler::Reset()
+{
+    // Prime with silence so the first output lines up with the first input
+    m_frames = m_filter.GetTaps() / 2 - 1;
+    std::fill(m_left.begin(), m_left.begin() + m_frames, 0.0f);
+    std::fill(m_right.begin(), m_right.begin() + m_frames, 0.0f);
+    m_position = 0;
+}
+
+int StreamResampler::GetInputNeeded(int out_count) const
+{
+    if (out_count <= 0) return 0;
+    uint64_t last = m_position + m_step * (uint64_t)(out_count - 1);
+    int64_t needed = (int64_t)(last >> 32) + m_filter.GetTaps() - (int64_t)m_frames;
+    return (int)std::max<int64_t>(0, needed);
+}
+
+void StreamResampler::Compact()
+{
+    size_t base = (size_t)(m_position >> 32);
+    base = std::min(base, m_frames);
+    if (base == 0) return;
+    size_t remaining = m_frames - base;
+    std::memmove(m_left.data(), m_left.data() + base, remaining * sizeof(float));
+    std::memmove(m_right.data(), m_right.data() + base, remaining * sizeof(float));
+    m_frames = remaining;
+    m_position -= (uint64_t)base << 32;
+}
+
+void StreamResampler::Push(const WAVE_32BS* input, int count)
+{
+    Compact();
+    if (m_frames + count > m_left.size()) {
+        m_left.resize(m_frames + count);
+        m_right.resize(m_frames + count);
+    }
+    float* left = m_left.data() + m_frames;
+    float* right = m_right.data() + m_frames;
+    for (int i = 0; i < count; ++i) {
+        left[i] = (float)input[i].L;
+        right[i] = (float)input[i].R;
+    }
+    m_frames += count;
+}
+
+int StreamResampler::Pull(WAVE_32BS* output, int count)
+{
+    const int taps = m_filter.GetTaps();
+    const uint32_t frac_mask = (1u << m_phase_shift) - 1;
+    const float frac_scale = 1.0f / (float)(1u << m_phase_shift);
+
+    int produced = 0;
+    while (produced < count) {
+        size_t base = (size_t)(m_position >> 32);
+        if (base + taps > m_frames) break;
+
+        uint32_t frac = (uint32_t)m_position;
+        int phase = (int)(frac >> m_phase_shift);
+        float t = (float)(frac & frac_mask) * frac_scale;
+        InterpolateRow(m_filter.GetRow(phase), m_filter.GetRow(phase + 1), t, m_coeffs.data(), taps);
+
+        float l, r;
+        Dot2(m_coeffs.data(), m_left.data() + base, m_right.data() + base, taps, l, r);
+        output[produced].L = ToSample(l);
+        output[produced].R = ToSample(r);
+
+        m_position += m_step;
+        ++produced;
+    }
+    return produced;
+}
+
+//=====================================================================
+// Offline resampling
+//=====================================================================
+
+const char* GetResampleQualityName(ResampleQuality quality)
+{
+    return GetPreset(quality).name;
+}
+
+OfflineResampler::OfflineResampler()
+    : m_in_rate(0.0), m_out_rate(0.0), m_quality(ResampleQuality::Normal), m_exact(false), m_in_step(1), m_out_step(1)
+{
+}
+
+void OfflineResampler::Configure(double in_rate, double out_rate, ResampleQuality quality)
+{
+    if (in_rate == m_in_rate && out_rate == m_out_rate && quality == m_quality) return;
+    m_in_rate = in_rate;
+    m_out_rate = out_rate;
+    m_quality = quality;
+    if (in_rate <= 0.0 || out_rate <= 0.0 || in_rate == out_rate) return;
+
+    m_exact = ReduceRates(in_rate, out_rate, m_in_step, m_out_step) && m_out_step <= (uint64_t)MAX_EXACT_PHASES;
+    const QualityPreset& preset = GetPreset(quality);
+    double ratio = out_rate / in_rate;
+    int taps = (int)std::ceil(preset.taps / std::min(1.0, ratio));
+    m_filter.Design(ratio, std::min(taps, MAX_OFFLINE_TAPS), m_exact ? (int)m_out_step : 1 << PHASE_BITS,
+                    preset.passband, preset.beta);
+    m_coeffs.assign(m_filter.GetTaps(), 0.0f);
+}
+
+size_t OfflineResampler::GetOutputLength(size_t count) const
+{
+    if (m_in_rate <= 0.0 || m_out_rate <= 0.0) return 0;
+    if (m_in_rate == m_out_rate) return count;
+    if (m_exact) return (size_t)(count * m_out_step / m_in_step);
+    return (size_t)(count * m_out_rate / m_in_rate);
+}
+
+void OfflineResampler::Process(const short* input, size_t count, short* output)
+{
+    size_t length = GetOutputLength(count);
+    if (length == 0) return;
+    if (m_in_rate == m_out_rate) {
+        std::memcpy(output, input, count * sizeof(short));
+        return;
+    }
+
+    // Input as float with silence either side; tap k of the output at input
+    // position x reads padded[floor(x) + k]
+    const int taps = m_filter.GetTaps();
+    size_t lead = (size_t)(taps / 2 - 1);
+    size_t padded_size = count + taps + 1;
+    if (m_padded.size() < padded_size) m_padded.resize(padded_size);
+    float* padded = m_padded.data();
+    std::fill(padded, padded + lead, 0.0f);
+    for (size_t i = 0; i < count; ++i) {
+        padded[lead + i] = (float)input[i];
+    }
+    std::fill(padded + lead + count, padded + padded_size, 0.0f);
+
+    if (m_exact) {
+        // Output j sits at input j * in_step / out_step: whole part and phase
+        // advance by integer steps, so nothing accumulates rounding error
+        size_t base = 0;
+        uint64_t phase = 0;
+        uint64_t whole = m_in_step / m_out_step;
+        uint64_t rest = m_in_step % m_out_step;
+        for (size_t j = 0; j < length; ++j) {
+            output[j] = ToShort(Dot1(m_filter.GetRow((int)phase), padded + base, taps));
+            base += (size_t)whole;
+            phase += rest;
+            if (phase >= m_out_step) {
+                phase -= m_out_step;
+                ++base;
+            }
+        }
+        return;
+    }
+
+    const int phase_shift = 32 - PHASE_BITS;
+    const uint32_t frac_mask = (1u << phase_shift) - 1;
+    const float frac_scale = 1.0f / (float)(1u << phase_shift);
+    uint64_t step = (uint64_t)std::llround(m_in_rate / m_out_rate * 4294967296.0);
+    uint64_t position = 0;
+    for (size_t j = 0; j < length; ++j, position += step) {
+        size_t base = std::min((size_t)(position >> 32), count);
+        uint32_t frac = (uint32_t)position;
+        int phase = (int)(frac >> phase_shift);
+        float t = (float)(frac & frac_mask) * frac_scale;
+        InterpolateRow(m_filter.GetRow(phase), m_filter.GetRow(phase + 1), t, m_coeffs.data(), taps);
+        output[j] = ToShort(Dot1(m_coeffs.data(), padded + base, taps));
+    }
+}
+
+//=====================================================================
+// ResampledStream
+//=====================================================================
+
+ResampledStream::ResampledStream(std::shared_ptr<Audio_Stream> source, uint32_t source_rate)
+    : m_source(std::move(source)), m_source_rate(source_rate)
+{
+    finished = false;
+}
+
+void ResampledStream::setup_stream(uint32_t sample_rate)
+{
+    m_source->setup_stream(m_source_rate);
+    m_resampler.Configure(m_source_rate, sample_rate);
+
+    // Room for a few thousand output frames per pull without reallocating
+    size_t frames = (size_t)std::ceil(4096.0 * m_source_rate / sample_rate) + 256;
+    m_input.assign(frames, WAVE_32BS{ 0, 0 });
+}
+
+int ResampledStream::get_sample(WAVE_32BS* output, int count, int channels)
+{
+    int produced = 0;
+    while (produced < count) {
+        int needed = std::min<int>(m_resampler.GetInputNeeded(count - produced), (int)m_input.size());
+        if (needed > 0) {
+            std::memset(m_input.data(), 0, sizeof(WAVE_32BS) * needed);
+            m_source->get_sample(m_input.data(), needed, channels);
+            m_resampler.Push(m_input.data(), needed);
+        }
+        produced += m_resampler.Pull(output + produced, count - produced);
+    }
+    if (m_source->get_finished()) {
+        set_finished(true);
+    }
+    return finished ? 0 : 1;
+}
+
+void ResampledStream::stop_stream()
+{
+    m_source->stop_stream();
+}
@@ -0,0 +1,126 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "audio_manager.h"
+
+// Windowed-sinc polyphase filter bank. Row p of the table holds the taps for
+// an output sample falling p/phases of the way between two input samples;
+// one extra row (p == phases) lets callers interpolate between neighbouring
+// phases without wrapping.
+class PolyphaseFilter {
+public:
+    PolyphaseFilter();
+
+    // ratio = output rate / input rate. taps is rounded up to a multiple of 4.
+    // passband is the cutoff as a fraction of the lower Nyquist frequency and
+    // beta the Kaiser window shape; the short form uses the values the
+    // streaming resampler is tuned for.
+    void Design(double ratio, int taps, int phases);
+    void Design(double ratio, int taps, int phases, double passband, double beta);
+
+    int GetTaps() const { return m_taps; }
+    int GetPhases() const { return m_phases; }
+    const float* GetRow(int phase) const { return &m_table[(size_t)phase * m_taps]; }
+
+private:
+    int m_taps;
+    int m_phases;
+    std::vector<float> m_table;
+};
+
+// Streaming stereo resampler for WAVE_32BS audio. Input is pushed in, output
+// is pulled; neither side allocates once the internal buffer has grown to
+// the largest block size in use.
+class StreamResampler {
+public:
+    StreamResampler();
+
+    void Configure(double in_rate, double out_rate);
+    void Reset();
+
+    // Input frames that must be pushed before out_count frames can be pulled
+    int GetInputNeeded(int out_count) const;
+
+    void Push(const WAVE_32BS* input, int count);
+    int Pull(WAVE_32BS* output, int count);
+
+private:
+    void Compact();
+
+    PolyphaseFilter m_filter;
+    uint64_t m_step;        // Input frames per output frame, 32.32 fixed point
+    uint64_t m_position;    // Next output position relative to m_left[0], 32.32
+    std::vector<float> m_left;
+    std::vector<float> m_right;
+    std::vector<float> m_coeffs;
+    size_t m_frames;        // Valid frames in m_left/m_right
+    int m_phase_shift;
+};
+
+// Filter length and stopband trade-offs for offline resampling. Tap counts
+// are per output sample, so decimating by a large factor (e.g. for double
+// speed) keeps the same transition band relative to the output rate.
+enum class ResampleQuality {
+    Fast,       // 16 taps, ~60 dB stopband
+    Normal,     // 32 taps, ~80 dB
+    High,       // 64 taps, ~100 dB
+};
+
+const char* GetResampleQualityName(ResampleQuality quality);
+
+// Resamples whole mono 16-bit buffers in one pass. The output of count
+// input samples holds GetOutputLength(count) samples, with the first lined
+// up on the first input sample; the input is treated as silent beyond
+// either end. When the rates reduce to a ratio with a small denominator
+// (17.5 kHz from any common rate does) every output phase has its own exact
+// row of taps; otherwise rows are interpolated as in StreamResampler.
+//
+// The filter and scratch buffers are kept between calls, so running many
+// short buffers at the same settings (a batch of drum hits) designs the
+// filter once and stops allocating after the longest one.
+class OfflineResampler {
+public:
+    OfflineResampler();
+
+    // Redesigns the filter only if something changed
+    void Configure(double in_rate, double out_rate, ResampleQuality quality);
+
+    size_t GetOutputLength(size_t count) const;
+
+    // output must have room for GetOutputLength(count) samples
+    void Process(const short* input, size_t count, short* output);
+
+private:
+    double m_in_rate;
+    double m_out_rate;
+    ResampleQuality m_quality;
+    bool m_exact;
+    uint64_t m_in_step;     // Exact ratio in_step / out_step, when m_exact
+    uint64_t m_out_step;
+    PolyphaseFilter m_filter;
+    std::vector<float> m_padded;
+    std::vector<float> m_coeffs;
+};
+
+// Runs a source stream at its own rate (e.g. the chips' native rate) and
+// resamples it once to the output rate.
+class ResampledStream : public Audio_Stream {
+public:
+    ResampledStream(std::shared_ptr<Audio_Stream> source, uint32_t source_rate);
+
+    // Audio_Stream
+    void setup_stream(uint32_t sample_rate) override;
+    int get_sample(WAVE_32BS* output, int count, int channels) override;
+    void stop_stream() override;
+
+private:
+    std::shared_ptr<Audio_Stream> m_source;
+    uint32_t m_source_rate;
+    StreamResampler m_resampler;
+    std::vector<WAVE_32BS> m_input;
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,51 @@
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Mono 16-bit samples behind a shared, immutable vector. Copying a buffer
+// (into a preview stream, or a window opened on the same audio) only bumps
+// a reference count; Edit() copies the samples first if anyone else still
+// holds them, so a stream never sees data change underneath it.
+//
+// Holders on other threads only read and release their reference, which
+// keeps the use_count() check in Edit() sound: it can only drop to one.
+class SampleBuffer {
+public:
+    SampleBuffer() : m_samples(Empty()) {}
+    explicit SampleBuffer(std::vector<short> samples)
+        : m_samples(std::make_shared<std::vector<short>>(std::move(samples))) {}
+
+    size_t size() const { return m_samples->size(); }
+    bool empty() const { return m_samples->empty(); }
+    const short* data() const { return m_samples->data(); }
+    short operator[](size_t index) const { return (*m_samples)[index]; }
+
+    // Whether both refer to the same samples
+    bool SharesWith(const SampleBuffer& other) const { return m_samples == other.m_samples; }
+
+    // Mutable access for the sole owner; a shared buffer (including the
+    // common empty one) is copied first
+    std::vector<short>& Edit() {
+        if (m_samples.use_count() > 1) {
+            m_samples = std::make_shared<std::vector<short>>(*m_samples);
+        }
+        return *m_samples;
+    }
+
+    // Drop this reference (freeing the samples if it was the last one)
+    void Reset() { m_samples = Empty(); }
+
+private:
+    // One shared empty vector, so default buffers never allocate
+    static const std::shared_ptr<std::vector<short>>& Empty() {
+        static const std::shared_ptr<std::vector<short>> empty = std::make_shared<std::vector<short>>();
+        return empty;
+    }
+
+    std::shared_ptr<std::vector<short>> m_samples;
+};
+
+#endif // SAMPLE_BUFFER_H
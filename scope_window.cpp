@@ -0,0 +1,253 @@
+#include "scope_window.h"
+#include <imgui.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "audio_engine.h"
+#include "channel_monitor.h"
+
+namespace {
+const int SCOPE_POINTS = 256;        // ~90 ms at 44.1 kHz
+const double VU_SECONDS = 0.3;
+const double PEAK_SECONDS = 0.05;
+const double HOLD_SECONDS = 1.5;
+const float HOLD_DECAY_DB = 20.0f;   // Per second, after the hold time
+const float FLOOR_DB = -48.0f;
+const float METER_WIDTH = 10.0f;
+
+float ToDb(double level) {
+    if (level <= 0.0) return FLOOR_DB;
+    return std::max(FLOOR_DB, (float)(20.0 * std::log10(level / 32768.0)));
+}
+}
+
+ScopeWindow::ScopeWindow()
+    : m_channel_mask((1u << ChannelLayout::COUNT) - 1), m_playing(false), m_monitoring(false),
+      m_open(false), m_request_focus(false)
+{
+    for (Meter& meter : m_meters) {
+        meter.rms_db = FLOOR_DB;
+        meter.peak_db = FLOOR_DB;
+        meter.hold_db = FLOOR_DB;
+        meter.hold_time = 0.0;
+        meter.clip_latched = false;
+        meter.clip_seen = 0;
+    }
+}
+
+void ScopeWindow::DrawScope(const ChannelMonitor& monitor, int channel, int64_t first, int64_t end,
+                            uint32_t generation, const ImVec2& origin, float width, float height)
+{
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    int columns = std::max(1, (int)width);
+    if ((int)m_column_min.size() < columns) {
+        m_column_min.resize(columns);
+        m_column_max.resize(columns);
+    }
+
+    // Gather min/max per pixel column straight from the ring
+    int64_t written = monitor.GetWrittenPoints();
+    double points_per_column = (double)SCOPE_POINTS / columns;
+    int64_t start = end - SCOPE_POINTS;
+    int drawn = 0;
+    for (int x = 0; x < columns; ++x) {
+        int64_t p0 = start + (int64_t)(x * points_per_column);
+        int64_t p1 = std::max(p0 + 1, start + (int64_t)((x + 1) * points_per_column));
+        p0 = std::max(p0, first);
+        p1 = std::min(p1, std::min(end, written));
+        float lo = 0.0f;
+        float hi = 0.0f;
+        if (p0 < p1) {
+            int lo_i = 32767;
+            int hi_i = -32768;
+            for (int64_t p = p0; p < p1; ++p) {
+                const ChannelMonitor::Point& point = monitor.GetPoint(channel, p);
+                lo_i = std::min<int>(lo_i, point.min);
+                hi_i = std::max<int>(hi_i, point.max);
+            }
+            lo = lo_i / 32768.0f;
+            hi = hi_i / 32768.0f;
+        }
+        m_column_min[x] = lo;
+        m_column_max[x] = hi;
+        drawn = x + 1;
+    }
+
+    // The writer lapped us while we were reading; skip this frame's trace
+    if (!monitor.IsIntact(generation, std::max(start, first))) {
+        drawn = 0;
+    }
+
+    float mid = origin.y + height * 0.5f;
+    float half = height * 0.5f - 1.0f;
+    draw_list->AddLine(ImVec2(origin.x, mid), ImVec2(origin.x + width, mid), IM_COL32(255, 255, 255, 30));
+    ImU32 color = ChannelLayout::CHANNELS[channel].chip == ChannelLayout::CHIP_FM ? IM_COL32(90, 170, 230, 255)
+                : ChannelLayout::CHANNELS[channel].chip == ChannelLayout::CHIP_PSG ? IM_COL32(130, 210, 120, 255)
+                : IM_COL32(220, 160, 90, 255);
+    for (int x = 0; x < drawn; ++x) {
+        float y0 = mid - m_column_max[x] * half;
+        float y1 = mid - m_column_min[x] * half;
+        draw_list->AddLine(ImVec2(origin.x + x + 0.5f, y0), ImVec2(origin.x + x + 0.5f, std::max(y1, y0 + 1.0f)), color);
+    }
+}
+
+void ScopeWindow::UpdateMeter(int channel, const ChannelMonitor& monitor, int64_t end, uint32_t generation)
+{
+    Meter& meter = m_meters[channel];
+    double rate = AudioEngine::Get().GetSampleRate();
+    int64_t vu_points = (int64_t)(VU_SECONDS * rate / ChannelMonitor::DECIMATION);
+    int64_t peak_points = (int64_t)(PEAK_SECONDS * rate / ChannelMonitor::DECIMATION);
+    int64_t first = std::max<int64_t>(0, end - vu_points);
+    end = std::min(end, monitor.GetWrittenPoints());
+
+    double sum_squares = 0.0;
+    int peak = 0;
+    for (int64_t p = first; p < end; ++p) {
+        const ChannelMonitor::Point& point = monitor.GetPoint(channel, p);
+        sum_squares += (double)point.rms * point.rms;
+        if (p >= end - peak_points) {
+            peak = std::max(peak, std::max(-(int)point.min, (int)point.max));
+        }
+    }
+    if (!monitor.IsIntact(generation, first) || end <= first) {
+        sum_squares = 0.0;
+        peak = 0;
+    }
+
+    meter.rms_db = ToDb(end > first ? std::sqrt(sum_squares / (end - first)) : 0.0);
+    meter.peak_db = ToDb(peak);
+
+    double now = ImGui::GetTime();
+    if (meter.peak_db >= meter.hold_db) {
+        meter.hold_db = meter.peak_db;
+        meter.hold_time = now;
+    } else if (now - meter.hold_time > HOLD_SECONDS) {
+        meter.hold_db = std::max(meter.peak_db, meter.hold_db - HOLD_DECAY_DB * ImGui::GetIO().DeltaTime);
+    }
+
+    // The audio thread counts every clipped block, so nothing slips between frames
+    uint32_t clips = monitor.GetClipCount(channel);
+    if (clips != meter.clip_seen) {
+        meter.clip_seen = clips;
+        meter.clip_latched = true;
+    }
+}
+
+void ScopeWindow::RenderChannel(int channel, const ChannelMonitor& monitor, int64_t audible_point,
+                                uint32_t generation, float width, float height)
+{
+    const ChannelLayout::Channel& info = ChannelLayout::CHANNELS[channel];
+    Meter& meter = m_meters[channel];
+
+    ImGui::PushID(channel);
+    ImGui::BeginGroup();
+
+    ImGui::CheckboxFlags(info.name, &m_channel_mask, 1u << channel);
+
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton("##scope", ImVec2(width, height));
+    bool clicked = ImGui::IsItemClicked();
+
+    float scope_width = width - METER_WIDTH - 4.0f;
+    ImVec2 meter_min(origin.x + scope_width + 4.0f, origin.y);
+    ImVec2 meter_max(origin.x + width, origin.y + height);
+    draw_list->AddRectFilled(origin, ImVec2(origin.x + scope_width, origin.y + height), IM_COL32(20, 20, 24, 255));
+    draw_list->AddRectFilled(meter_min, meter_max, IM_COL32(20, 20, 24, 255));
+
+    bool active = m_monitoring && (m_channel_mask & (1u << channel)) && audible_point >= 0;
+    if (active) {
+        int64_t first = monitor.GetFirstSafePoint();
+        DrawScope(monitor, channel, first, audible_point, generation, origin, scope_width, height);
+        UpdateMeter(channel, monitor, audible_point, generation);
+    } else {
+        meter.rms_db = meter.peak_db = meter.hold_db = FLOOR_DB;
+    }
+
+    // VU bar (RMS) with the peak-hold line
+    float led_size = METER_WIDTH;
+    float bar_top = meter_min.y + led_size + 2.0f;
+    float bar_height = meter_max.y - bar_top;
+    float level = (meter.rms_db - FLOOR_DB) / -FLOOR_DB;
+    ImU32 bar_color = meter.rms_db > -3.0f ? IM_COL32(230, 70, 50, 255)
+                    : meter.rms_db > -12.0f ? IM_COL32(230, 200, 60, 255)
+                    : IM_COL32(80, 200, 90, 255);
+    draw_list->AddRectFilled(ImVec2(meter_min.x, meter_max.y - bar_height * level), meter_max, bar_color);
+    if (meter.hold_db > FLOOR_DB) {
+        float hold_y = meter_max.y - bar_height * (meter.hold_db - FLOOR_DB) / -FLOOR_DB;
+        draw_list->AddLine(ImVec2(meter_min.x, hold_y), ImVec2(meter_max.x, hold_y), IM_COL32(255, 255, 255, 220));
+    }
+
+    // Clip light; stays on until clicked
+    ImVec2 led_center(meter_min.x + led_size * 0.5f, meter_min.y + led_size * 0.5f);
+    draw_list->AddCircleFilled(led_center, led_size * 0.4f, meter.clip_latched ? IM_COL32(255, 40, 30, 255) : IM_COL32(70, 30, 30, 255));
+    if (clicked && ImGui::GetMousePos().x >= meter_min.x) {
+        meter.clip_latched = false;
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s (track %c)\nRMS %.1f dB, peak %.1f dB%s", info.name, info.track,
+                          meter.rms_db, meter.hold_db, meter.clip_latched ? "\nCLIPPED - click the meter to reset" : "");
+    }
+
+    ImGui::EndGroup();
+    ImGui::PopID();
+}
+
+void ScopeWindow::Render()
+{
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(760, 360), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("Channel Scopes", &m_open)) {
+#ifdef __EMSCRIPTEN__
+        ImGui::TextDisabled("Channel monitors are not available in the web build");
+#else
+        if (!m_playing) {
+            ImGui::TextDisabled("Not playing");
+        } else if (!m_monitoring) {
+            ImGui::TextDisabled("Starting channel monitors...");
+        } else {
+            ImGui::Text("Monitoring");
+        }
+#endif
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Reset clip lights")) {
+            for (Meter& meter : m_meters) {
+                meter.clip_latched = false;
+            }
+        }
+
+        const AudioEngine& engine = AudioEngine::Get();
+        const ChannelMonitor& monitor = engine.GetMonitor();
+        uint32_t generation = monitor.GetGeneration();
+
+        // Draw what is being heard, not what was just rendered
+        int64_t audible_point = -1;
+        int64_t frame = engine.GetAudibleSongFrame();
+        if (frame >= 0) {
+            audible_point = (frame - monitor.GetBaseFrame()) / ChannelMonitor::DECIMATION;
+            audible_point = std::min(audible_point, monitor.GetWrittenPoints());
+        }
+
+        const ImGuiStyle& style = ImGui::GetStyle();
+        const int per_row = 6;
+        float width = (ImGui::GetContentRegionAvail().x - style.ItemSpacing.x * (per_row - 1)) / per_row;
+        width = std::max(width, 40.0f);
+        float height = std::max(40.0f, (ImGui::GetContentRegionAvail().y - 3 * (ImGui::GetFrameHeightWithSpacing() + style.ItemSpacing.y)) / 3);
+
+        for (int i = 0; i < ChannelLayout::COUNT; ++i) {
+            // One row per chip
+            if (i > 0 && ChannelLayout::CHANNELS[i].chip == ChannelLayout::CHANNELS[i - 1].chip) {
+                ImGui::SameLine();
+            }
+            RenderChannel(i, monitor, audible_point, generation, width, height);
+        }
+    }
+    ImGui::End();
+}
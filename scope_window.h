@@ -0,0 +1,55 @@
+#ifndef SCOPE_WINDOW_H
+#define SCOPE_WINDOW_H
+
+#include <cstdint>
+#include <vector>
+#include "channel_layout.h"
+
+// Forward declarations
+class ChannelMonitor;
+struct ImVec2;
+
+// Oscilloscope, VU/peak meter and latching clip light for every channel,
+// drawn straight from the audio engine's ChannelMonitor rings.
+class ScopeWindow {
+public:
+    ScopeWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+    // Channels to monitor, bit (1 << channel index)
+    uint32_t GetChannelMask() const { return m_channel_mask; }
+
+    // Status pushed in by the Editor
+    void SetMonitorState(bool playing, bool monitoring) { m_playing = playing; m_monitoring = monitoring; }
+
+private:
+    void RenderChannel(int channel, const ChannelMonitor& monitor, int64_t audible_point,
+                       uint32_t generation, float width, float height);
+    void DrawScope(const ChannelMonitor& monitor, int channel, int64_t first, int64_t end,
+                   uint32_t generation, const ImVec2& origin, float width, float height);
+    void UpdateMeter(int channel, const ChannelMonitor& monitor, int64_t end, uint32_t generation);
+
+    struct Meter {
+        float rms_db;
+        float peak_db;
+        float hold_db;
+        double hold_time;
+        bool clip_latched;
+        uint32_t clip_seen;     // ChannelMonitor clip count at the last check
+    };
+
+    Meter m_meters[ChannelLayout::COUNT];
+    std::vector<float> m_column_min;    // Per-pixel scope peaks, reused between frames
+    std::vector<float> m_column_max;
+    uint32_t m_channel_mask;
+    bool m_playing;
+    bool m_monitoring;
+
+    bool m_open;
+    bool m_request_focus;
+};
+
+#endif // SCOPE_WINDOW_H
@@ -0,0 +1,196 @@
+#include "song_cache.h"
+#include <algorithm>
+#include <cstring>
+#include "audio_engine.h"
+#include "background_task.h"
+#include "emu_player.h"
+#include "song.h"
+
+namespace {
+// Emulator output is 16-bit audio scaled up by 8 bits
+const int SAMPLE_SHIFT = 8;
+
+int16_t ToInt16(int32_t value) {
+    value >>= SAMPLE_SHIFT;
+    if (value > 32767) value = 32767;
+    if (value < -32768) value = -32768;
+    return (int16_t)value;
+}
+
+// Block layout: varint frame count, then per frame the zigzag-coded
+// difference of L and R from the previous frame, as varints. Chip music has
+// long runs of small deltas, so most samples pack into one or two bytes.
+void PutVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+uint32_t GetVarint(const uint8_t*& in, const uint8_t* end) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (in < end && shift < 32) {
+        uint8_t byte = *in++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+        shift += 7;
+    }
+    return value;
+}
+
+uint32_t ZigZag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t UnZigZag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+} // namespace
+
+SongCache::SongCache(uint32_t sample_rate, int64_t max_frames, size_t source_hash)
+    : m_sample_rate(sample_rate), m_max_frames(max_frames), m_source_hash(source_hash),
+      m_block_count(0), m_ready_frames(0), m_complete(false), m_compressed_bytes(0)
+{
+    int64_t max_blocks = (max_frames + BLOCK_FRAMES - 1) / BLOCK_FRAMES;
+    m_blocks.resize((size_t)max_blocks);
+    m_peaks.resize((size_t)(max_blocks * (BLOCK_FRAMES / PEAK_FRAMES)));
+    m_encode_buffer.reserve(BLOCK_FRAMES * 2 * 3 + 8);
+}
+
+void SongCache::AppendBlock(const WAVE_32BS* frames, int count)
+{
+    if (count <= 0 || m_block_count >= (int64_t)m_blocks.size()) return;
+    count = std::min(count, BLOCK_FRAMES);
+
+    m_encode_buffer.clear();
+    PutVarint(m_encode_buffer, (uint32_t)count);
+    int32_t prev_l = 0;
+    int32_t prev_r = 0;
+    for (int i = 0; i < count; ++i) {
+        int32_t l = ToInt16(frames[i].L);
+        int32_t r = ToInt16(frames[i].R);
+        PutVarint(m_encode_buffer, ZigZag(l - prev_l));
+        PutVarint(m_encode_buffer, ZigZag(r - prev_r));
+        prev_l = l;
+        prev_r = r;
+    }
+
+    // Peak summary for the timeline
+    int64_t peak_base = m_block_count * (BLOCK_FRAMES / PEAK_FRAMES);
+    for (int start = 0; start + PEAK_FRAMES <= count; start += PEAK_FRAMES) {
+        int16_t lo = 32767;
+        int16_t hi = -32768;
+        for (int i = start; i < start + PEAK_FRAMES; ++i) {
+            int16_t mono = (int16_t)(((int32_t)ToInt16(frames[i].L) + ToInt16(frames[i].R)) / 2);
+            lo = std::min(lo, mono);
+            hi = std::max(hi, mono);
+        }
+        m_peaks[(size_t)(peak_base + start / PEAK_FRAMES)] = Peak{ lo, hi };
+    }
+
+    m_blocks[(size_t)m_block_count].assign(m_encode_buffer.begin(), m_encode_buffer.end());
+    m_compressed_bytes.fetch_add(m_encode_buffer.size(), std::memory_order_relaxed);
+    ++m_block_count;
+
+    // Publish only after the block and its peaks are fully written
+    m_ready_frames.fetch_add(count, std::memory_order_release);
+}
+
+void SongCache::Finish()
+{
+    m_complete.store(true, std::memory_order_release);
+}
+
+int SongCache::DecodeBlock(int64_t block, WAVE_32BS* out) const
+{
+    if (block < 0 || block * BLOCK_FRAMES >= GetReadyFrames()) return 0;
+
+    const std::vector<uint8_t>& data = m_blocks[(size_t)block];
+    const uint8_t* in = data.data();
+    const uint8_t* end = in + data.size();
+
+    int count = (int)std::min<uint32_t>(GetVarint(in, end), BLOCK_FRAMES);
+    int32_t l = 0;
+    int32_t r = 0;
+    for (int i = 0; i < count; ++i) {
+        l += UnZigZag(GetVarint(in, end));
+        r += UnZigZag(GetVarint(in, end));
+        out[i].L = l << SAMPLE_SHIFT;
+        out[i].R = r << SAMPLE_SHIFT;
+    }
+    return count;
+}
+
+void SongCache::Render(std::shared_ptr<Song> song, SongCache& cache, BackgroundTask& task)
+{
+    // A separate player instance, set up exactly like the one the user hears
+    std::shared_ptr<Emu_Player> player = std::make_shared<Emu_Player>(song, 0);
+    std::shared_ptr<Audio_Stream> stream = AudioEngine::Get().PrepareSong(player);
+
+    std::vector<WAVE_32BS> buffer(BLOCK_FRAMES);
+    int64_t rendered = 0;
+    while (rendered < cache.GetMaxFrames() && !task.IsCancelled()) {
+        int count = (int)std::min<int64_t>(BLOCK_FRAMES, cache.GetMaxFrames() - rendered);
+        std::memset(buffer.data(), 0, sizeof(WAVE_32BS) * count);
+        stream->get_sample(buffer.data(), count, 2);
+        cache.AppendBlock(buffer.data(), count);
+        rendered += count;
+        task.SetProgress((float)rendered / (float)cache.GetMaxFrames());
+
+        // Songs without a loop end; no need to render silence after them
+        if (stream->get_finished()) break;
+    }
+    if (!task.IsCancelled()) {
+        cache.Finish();
+    }
+}
+
+//=====================================================================
+
+CachedSongStream::CachedSongStream(std::shared_ptr<const SongCache> cache, int64_t start_frame)
+    : m_cache(std::move(cache)), m_frame(std::max<int64_t>(0, start_frame)),
+      m_decoded_block(-1), m_decoded_frames(0)
+{
+    m_block.resize(SongCache::BLOCK_FRAMES);
+    finished = false;
+}
+
+void CachedSongStream::seek(int64_t frame)
+{
+    m_frame = std::max<int64_t>(0, frame);
+}
+
+void CachedSongStream::setup_stream(uint32_t sample_rate)
+{
+    // The cache is always rendered at the engine's output rate
+}
+
+int CachedSongStream::get_sample(WAVE_32BS* output, int count, int channels)
+{
+    for (int i = 0; i < count; ++i) {
+        int64_t block = m_frame / SongCache::BLOCK_FRAMES;
+        if (block != m_decoded_block) {
+            m_decoded_frames = m_cache->DecodeBlock(block, m_block.data());
+            m_decoded_block = m_decoded_frames ? block : -1;
+        }
+        int offset = (int)(m_frame % SongCache::BLOCK_FRAMES);
+        if (m_decoded_block < 0 || offset >= m_decoded_frames) {
+            // Past the rendered range: end of song, or the renderer is still behind
+            output[i].L = 0;
+            output[i].R = 0;
+            if (m_cache->IsComplete() && m_frame >= m_cache->GetReadyFrames()) {
+                if (!finished) set_finished(true);
+            }
+            continue;
+        }
+        output[i] = m_block[offset];
+        ++m_frame;
+    }
+    return finished ? 0 : 1;
+}
+
+void CachedSongStream::stop_stream()
+{
+}
@@ -0,0 +1,93 @@
+#ifndef SONG_CACHE_H
+#define SONG_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "audio_manager.h"
+
+// Forward declarations
+class Song;
+class BackgroundTask;
+
+// Offline render of a compiled song, stored as losslessly packed 16-bit
+// blocks plus a min/max peak summary for the timeline. One thread renders
+// (appends blocks); any number of threads may read what is already
+// published.
+class SongCache {
+public:
+    static const int BLOCK_FRAMES = 4096;
+    static const int PEAK_FRAMES = 256;   // Frames summarised by one peak entry
+
+    struct Peak {
+        int16_t min;
+        int16_t max;
+    };
+
+    SongCache(uint32_t sample_rate, int64_t max_frames, size_t source_hash);
+
+    // Render thread
+    void AppendBlock(const WAVE_32BS* frames, int count);
+    void Finish();
+
+    // Render up to max_frames of the song through a fresh emulator instance.
+    // Runs on a BackgroundTask; stops early when cancelled or the song ends.
+    static void Render(std::shared_ptr<Song> song, SongCache& cache, BackgroundTask& task);
+
+    // Any thread
+    uint32_t GetSampleRate() const { return m_sample_rate; }
+    size_t GetSourceHash() const { return m_source_hash; }
+    int64_t GetMaxFrames() const { return m_max_frames; }
+    int64_t GetReadyFrames() const { return m_ready_frames.load(std::memory_order_acquire); }
+    bool IsComplete() const { return m_complete.load(std::memory_order_acquire); }
+    size_t GetCompressedBytes() const { return m_compressed_bytes.load(std::memory_order_relaxed); }
+
+    // Peaks are mono (L+R)/2; only the first GetReadyPeaks() entries are valid
+    const Peak* GetPeaks() const { return m_peaks.data(); }
+    int64_t GetReadyPeaks() const { return GetReadyFrames() / PEAK_FRAMES; }
+
+    // Unpack one block into out (room for BLOCK_FRAMES). Returns the number of
+    // frames in the block, or 0 if it has not been rendered yet. Does not allocate.
+    int DecodeBlock(int64_t block, WAVE_32BS* out) const;
+
+private:
+    uint32_t m_sample_rate;
+    int64_t m_max_frames;
+    size_t m_source_hash;
+
+    // Sized up front so readers never see a reallocation
+    std::vector<std::vector<uint8_t>> m_blocks;
+    std::vector<Peak> m_peaks;
+    std::vector<uint8_t> m_encode_buffer;
+
+    int64_t m_block_count;  // Render thread only
+    std::atomic<int64_t> m_ready_frames;
+    std::atomic<bool> m_complete;
+    std::atomic<size_t> m_compressed_bytes;
+};
+
+// Plays a SongCache from any frame. Seeking is instant, so the timeline uses
+// it for click-to-seek and scrubbing.
+class CachedSongStream : public Audio_Stream {
+public:
+    CachedSongStream(std::shared_ptr<const SongCache> cache, int64_t start_frame);
+
+    // Audio thread (through AudioEngine)
+    void seek(int64_t frame);
+    int64_t get_frame() const { return m_frame; }
+
+    // Audio_Stream
+    void setup_stream(uint32_t sample_rate) override;
+    int get_sample(WAVE_32BS* output, int count, int channels) override;
+    void stop_stream() override;
+
+private:
+    std::shared_ptr<const SongCache> m_cache;
+    int64_t m_frame;
+    int64_t m_decoded_block;
+    int m_decoded_frames;
+    std::vector<WAVE_32BS> m_block;
+};
+
+#endif // SONG_CACHE_H
@@ -0,0 +1,187 @@
+#include "spectrum_window.h"
+#include <imgui.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "audio_engine.h"
+
+namespace {
+const int FFT_SIZES[] = { 1024, 2048, 4096, 8192 };
+const char* FFT_SIZE_NAMES[] = { "1024", "2048", "4096", "8192" };
+const int FFT_SIZE_COUNT = 4;
+
+const char* WINDOW_NAMES[] = { "Rectangular", "Hann", "Blackman-Harris" };
+const int WINDOW_COUNT = 3;
+
+const float MIN_FREQ = 20.0f;
+const float MAX_FREQ = 20000.0f;
+const int BANDS_PER_OCTAVE = 6;
+
+const float FLOOR_DB = -96.0f;
+const float FALL_DB_PER_SECOND = 40.0f;
+const float PEAK_FALL_DB_PER_SECOND = 15.0f;
+const double PEAK_HOLD_SECONDS = 1.0;
+
+// WAVE_32BS full scale (16-bit audio shifted up by 8)
+const float FULL_SCALE = 8388608.0f;
+}
+
+SpectrumWindow::SpectrumWindow()
+    : m_fft(4096), m_size_index(2), m_window_index(FFT::WINDOW_BLACKMAN_HARRIS), m_peak_hold(true),
+      m_band_rate(0.0), m_band_size(0), m_open(false), m_request_focus(false)
+{
+}
+
+void SpectrumWindow::BuildBands(double sample_rate)
+{
+    int size = m_fft.GetSize();
+    if (sample_rate == m_band_rate && size == m_band_size) return;
+    m_band_rate = sample_rate;
+    m_band_size = size;
+
+    float top = std::min(MAX_FREQ, (float)(sample_rate / 2.0));
+    double step = std::pow(2.0, 1.0 / BANDS_PER_OCTAVE);
+    double bin_hz = sample_rate / size;
+
+    m_bands.clear();
+    for (double lo = MIN_FREQ; lo < top; lo *= step) {
+        Band band;
+        band.freq_lo = (float)lo;
+        band.freq_hi = (float)std::min<double>(lo * step, top);
+        // Narrow low bands may fall inside a single bin; always cover at least one
+        band.bin_lo = std::max(1, (int)std::floor(band.freq_lo / bin_hz + 0.5));
+        band.bin_hi = std::max(band.bin_lo + 1, (int)std::floor(band.freq_hi / bin_hz + 0.5));
+        band.bin_hi = std::min(band.bin_hi, size / 2 + 1);
+        band.level_db = FLOOR_DB;
+        band.peak_db = FLOOR_DB;
+        band.peak_time = 0.0;
+        m_bands.push_back(band);
+    }
+}
+
+void SpectrumWindow::Analyse()
+{
+    const AudioEngine& engine = AudioEngine::Get();
+    int size = m_fft.GetSize();
+    m_frames.resize(size);
+    m_input.resize(size);
+    m_power.resize(size / 2 + 1);
+    BuildBands(engine.GetSampleRate());
+
+    // Silence if the tap can't supply the window (start-up, or we fell behind)
+    bool have_audio = engine.GetTap().Read(engine.GetAudibleOutputFrame(), m_frames.data(), size);
+    for (int i = 0; i < size; ++i) {
+        m_input[i] = have_audio ? (m_frames[i].L + m_frames[i].R) * (0.5f / FULL_SCALE) : 0.0f;
+    }
+    m_fft.PowerSpectrum(m_input.data(), (FFT::Window)m_window_index, m_power.data());
+
+    double now = ImGui::GetTime();
+    float dt = ImGui::GetIO().DeltaTime;
+    for (Band& band : m_bands) {
+        float power = 0.0f;
+        for (int bin = band.bin_lo; bin < band.bin_hi; ++bin) {
+            power = std::max(power, m_power[bin]);
+        }
+        float db = power > 0.0f ? std::max(FLOOR_DB, 10.0f * std::log10(power)) : FLOOR_DB;
+
+        // Rise at once, fall smoothly
+        band.level_db = std::max(db, band.level_db - FALL_DB_PER_SECOND * dt);
+        if (band.level_db >= band.peak_db) {
+            band.peak_db = band.level_db;
+            band.peak_time = now;
+        } else if (now - band.peak_time > PEAK_HOLD_SECONDS) {
+            band.peak_db = std::max(band.level_db, band.peak_db - PEAK_FALL_DB_PER_SECOND * dt);
+        }
+    }
+}
+
+void SpectrumWindow::DrawSpectrum(float width, float height)
+{
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 end(origin.x + width, origin.y + height);
+    ImGui::InvisibleButton("##spectrum", ImVec2(width, height));
+
+    draw_list->AddRectFilled(origin, end, IM_COL32(20, 20, 24, 255));
+    if (m_bands.empty()) return;
+
+    float log_lo = std::log10(m_bands.front().freq_lo);
+    float log_hi = std::log10(m_bands.back().freq_hi);
+    auto freq_to_x = [&](float freq) {
+        return origin.x + width * (std::log10(freq) - log_lo) / (log_hi - log_lo);
+    };
+    auto db_to_y = [&](float db) {
+        return origin.y + height * (db / FLOOR_DB);
+    };
+
+    // Grid
+    for (float db = -12.0f; db > FLOOR_DB; db -= 12.0f) {
+        float y = db_to_y(db);
+        draw_list->AddLine(ImVec2(origin.x, y), ImVec2(end.x, y), IM_COL32(255, 255, 255, 25));
+        char label[16];
+        snprintf(label, sizeof(label), "%d", (int)db);
+        draw_list->AddText(ImVec2(origin.x + 2, y - 14), IM_COL32(200, 200, 200, 110), label);
+    }
+    const float marks[] = { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f };
+    for (float freq : marks) {
+        if (freq <= m_bands.front().freq_lo || freq >= m_bands.back().freq_hi) continue;
+        float x = freq_to_x(freq);
+        draw_list->AddLine(ImVec2(x, origin.y), ImVec2(x, end.y), IM_COL32(255, 255, 255, 25));
+        char label[16];
+        if (freq >= 1000.0f) {
+            snprintf(label, sizeof(label), "%gk", freq / 1000.0f);
+        } else {
+            snprintf(label, sizeof(label), "%g", freq);
+        }
+        draw_list->AddText(ImVec2(x + 2, end.y - 16), IM_COL32(200, 200, 200, 110), label);
+    }
+
+    // Bars and peak-hold ticks
+    for (const Band& band : m_bands) {
+        float x0 = freq_to_x(band.freq_lo) + 1.0f;
+        float x1 = std::max(x0 + 1.0f, freq_to_x(band.freq_hi) - 1.0f);
+        if (band.level_db > FLOOR_DB) {
+            draw_list->AddRectFilled(ImVec2(x0, db_to_y(band.level_db)), ImVec2(x1, end.y), IM_COL32(90, 170, 230, 255));
+        }
+        if (m_peak_hold && band.peak_db > FLOOR_DB) {
+            float y = db_to_y(band.peak_db);
+            draw_list->AddLine(ImVec2(x0, y), ImVec2(x1, y), IM_COL32(255, 220, 120, 255));
+        }
+    }
+
+    if (ImGui::IsItemHovered()) {
+        float t = (ImGui::GetMousePos().x - origin.x) / width;
+        float freq = std::pow(10.0f, log_lo + t * (log_hi - log_lo));
+        ImGui::SetTooltip("%.0f Hz", freq);
+    }
+}
+
+void SpectrumWindow::Render()
+{
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(640, 300), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("Spectrum", &m_open)) {
+        ImGui::SetNextItemWidth(90.0f);
+        if (ImGui::Combo("FFT size", &m_size_index, FFT_SIZE_NAMES, FFT_SIZE_COUNT)) {
+            m_fft.Resize(FFT_SIZES[m_size_index]);
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(140.0f);
+        ImGui::Combo("Window", &m_window_index, WINDOW_NAMES, WINDOW_COUNT);
+        ImGui::SameLine();
+        ImGui::Checkbox("Peak hold", &m_peak_hold);
+
+        Analyse();
+
+        ImVec2 avail = ImGui::GetContentRegionAvail();
+        DrawSpectrum(std::max(avail.x, 100.0f), std::max(avail.y, 60.0f));
+    }
+    ImGui::End();
+}
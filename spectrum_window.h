@@ -0,0 +1,50 @@
+#ifndef SPECTRUM_WINDOW_H
+#define SPECTRUM_WINDOW_H
+
+#include <vector>
+#include "audio_manager.h"
+#include "fft.h"
+
+// Spectrum of the final output mix. Reads the engine's output tap at the
+// audible position once per UI frame and analyses it on the UI thread.
+class SpectrumWindow {
+public:
+    SpectrumWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+private:
+    void Analyse();
+    void BuildBands(double sample_rate);
+    void DrawSpectrum(float width, float height);
+
+    FFT m_fft;
+    int m_size_index;
+    int m_window_index;
+    bool m_peak_hold;
+
+    std::vector<WAVE_32BS> m_frames;    // Copied from the tap
+    std::vector<float> m_input;
+    std::vector<float> m_power;
+
+    // Log-spaced bands: FFT bin range per band, current level and peak
+    struct Band {
+        float freq_lo;
+        float freq_hi;
+        int bin_lo;
+        int bin_hi;
+        float level_db;
+        float peak_db;
+        double peak_time;
+    };
+    std::vector<Band> m_bands;
+    double m_band_rate;
+    int m_band_size;
+
+    bool m_open;
+    bool m_request_focus;
+};
+
+#endif // SPECTRUM_WINDOW_H
@@ -0,0 +1,60 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded single-producer/single-consumer queue. Push() may only be called
+// from one thread and Pop() from one other thread; neither ever blocks or
+// allocates, so it is safe to use from the audio callback.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false (and leaves item untouched) when full.
+    bool Push(T&& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_items[head & (Capacity - 1)] = std::move(item);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Push(const T& item) {
+        T copy(item);
+        return Push(std::move(copy));
+    }
+
+    // Consumer side. Moves the oldest item out; returns false when empty.
+    bool Pop(T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(m_items[tail & (Capacity - 1)]);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    // Keep the indices on separate cache lines so producer and consumer
+    // don't false-share.
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    T m_items[Capacity];
+};
+
+#endif // SPSC_QUEUE_H
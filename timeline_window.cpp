@@ -0,0 +1,191 @@
+#include "timeline_window.h"
+#include <imgui.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include "song_cache.h"
+
+TimelineWindow::TimelineWindow()
+    : m_rendering(false), m_render_progress(0.0f), m_play_frame(-1),
+      m_bpm(120.0f), m_beats_per_bar(4), m_play_from_cache(true),
+      m_seek_pending(false), m_scrubbing(false), m_seek_frame(0),
+      m_open(false), m_request_focus(false)
+{
+}
+
+void TimelineWindow::SetTempoFromMML(const std::string& mml)
+{
+    // Use the first "t<bpm>" command outside a comment. This is only a guess
+    // for the bar grid; the user can correct it in the window.
+    bool in_comment = false;
+    for (size_t i = 0; i < mml.size(); ++i) {
+        char c = mml[i];
+        if (c == '\n') { in_comment = false; continue; }
+        if (c == ';') { in_comment = true; continue; }
+        if (in_comment || c != 't') continue;
+        if (i > 0 && std::isalpha((unsigned char)mml[i - 1])) continue;
+        if (i + 1 >= mml.size() || !std::isdigit((unsigned char)mml[i + 1])) continue;
+
+        float bpm = (float)std::atof(mml.c_str() + i + 1);
+        if (bpm >= 20.0f && bpm <= 999.0f) {
+            m_bpm = bpm;
+        }
+        return;
+    }
+}
+
+bool TimelineWindow::ConsumeSeek(int64_t& frame, bool& scrubbing)
+{
+    if (!m_seek_pending) return false;
+    m_seek_pending = false;
+    frame = m_seek_frame;
+    scrubbing = m_scrubbing;
+    return true;
+}
+
+void TimelineWindow::RenderWaveform(float width, float height)
+{
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 end(origin.x + width, origin.y + height);
+    float mid = origin.y + height * 0.5f;
+
+    ImGui::InvisibleButton("##timeline", ImVec2(width, height));
+    bool active = ImGui::IsItemActive();
+
+    draw_list->AddRectFilled(origin, end, IM_COL32(20, 20, 24, 255));
+
+    const SongCache* cache = m_cache.get();
+    if (!cache || cache->GetMaxFrames() <= 0) {
+        draw_list->AddText(ImVec2(origin.x + 8, mid - 8), IM_COL32(160, 160, 160, 255), "Play the song once to render the timeline");
+        return;
+    }
+
+    // The horizontal scale is fixed to the rendered length once complete, or
+    // the render budget while it is still growing, so the view doesn't jump.
+    int64_t total_frames = cache->IsComplete() ? std::max<int64_t>(1, cache->GetReadyFrames()) : cache->GetMaxFrames();
+    double frames_per_pixel = (double)total_frames / width;
+
+    // Reduce the peak summary to one min/max pair per pixel column
+    int columns = std::max(1, (int)width);
+    m_column_min.assign(columns, 0.0f);
+    m_column_max.assign(columns, 0.0f);
+    const SongCache::Peak* peaks = cache->GetPeaks();
+    int64_t ready_peaks = cache->GetReadyPeaks();
+    double peaks_per_column = frames_per_pixel / SongCache::PEAK_FRAMES;
+    int ready_columns = 0;
+    for (int x = 0; x < columns; ++x) {
+        int64_t first = (int64_t)(x * peaks_per_column);
+        int64_t last = std::max(first + 1, (int64_t)((x + 1) * peaks_per_column));
+        if (first >= ready_peaks) break;
+        last = std::min(last, ready_peaks);
+        int lo = 32767;
+        int hi = -32768;
+        for (int64_t p = first; p < last; ++p) {
+            lo = std::min<int>(lo, peaks[p].min);
+            hi = std::max<int>(hi, peaks[p].max);
+        }
+        m_column_min[x] = lo / 32768.0f;
+        m_column_max[x] = hi / 32768.0f;
+        ready_columns = x + 1;
+    }
+
+    ImU32 wave_color = IM_COL32(90, 170, 230, 255);
+    float half = height * 0.5f - 1.0f;
+    for (int x = 0; x < ready_columns; ++x) {
+        float px = origin.x + x + 0.5f;
+        float y0 = mid - m_column_max[x] * half;
+        float y1 = mid - m_column_min[x] * half;
+        draw_list->AddLine(ImVec2(px, y0), ImVec2(px, std::max(y1, y0 + 1.0f)), wave_color);
+    }
+
+    // Not rendered yet
+    if (ready_columns < columns) {
+        draw_list->AddRectFilled(ImVec2(origin.x + ready_columns, origin.y), end, IM_COL32(40, 40, 46, 255));
+    }
+
+    // Bar markers
+    double frames_per_bar = cache->GetSampleRate() * 60.0 / m_bpm * m_beats_per_bar;
+    if (frames_per_bar / frames_per_pixel >= 4.0) {
+        int bar = 0;
+        for (double f = 0; f < total_frames; f += frames_per_bar, ++bar) {
+            float px = origin.x + (float)(f / frames_per_pixel);
+            draw_list->AddLine(ImVec2(px, origin.y), ImVec2(px, end.y), IM_COL32(255, 255, 255, 40));
+            if (frames_per_bar / frames_per_pixel >= 24.0) {
+                char label[16];
+                snprintf(label, sizeof(label), "%d", bar + 1);
+                draw_list->AddText(ImVec2(px + 2, origin.y + 1), IM_COL32(200, 200, 200, 160), label);
+            }
+        }
+    }
+
+    // Play cursor
+    if (m_play_frame >= 0) {
+        float px = origin.x + (float)(std::min(m_play_frame, total_frames) / frames_per_pixel);
+        draw_list->AddLine(ImVec2(px, origin.y), ImVec2(px, end.y), IM_COL32(255, 80, 60, 255), 2.0f);
+    }
+
+    // Seek requests: a click seeks, holding the button scrubs
+    if (active || ImGui::IsItemDeactivated()) {
+        float mouse_x = std::min(std::max(ImGui::GetMousePos().x - origin.x, 0.0f), width);
+        int64_t frame = (int64_t)(mouse_x * frames_per_pixel);
+        frame = std::min(frame, std::max<int64_t>(0, cache->GetReadyFrames() - 1));
+        bool scrubbing = active && ImGui::IsMouseDragging(0, 1.0f);
+        if (ImGui::IsItemActivated() || (scrubbing && frame != m_seek_frame)) {
+            m_seek_frame = frame;
+            m_seek_pending = true;
+        }
+        m_scrubbing = active;
+    }
+
+    if (ImGui::IsItemHovered()) {
+        float mouse_x = ImGui::GetMousePos().x - origin.x;
+        double seconds = mouse_x * frames_per_pixel / cache->GetSampleRate();
+        ImGui::SetTooltip("%d:%05.2f  bar %d", (int)(seconds / 60), seconds - 60 * (int)(seconds / 60),
+                          (int)(mouse_x * frames_per_pixel / frames_per_bar) + 1);
+    }
+}
+
+void TimelineWindow::Render()
+{
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(800, 180), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("Timeline", &m_open)) {
+        ImGui::SetNextItemWidth(100.0f);
+        if (ImGui::InputFloat("BPM", &m_bpm, 1.0f, 10.0f, "%.1f")) {
+            m_bpm = std::min(std::max(m_bpm, 20.0f), 999.0f);
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(80.0f);
+        if (ImGui::InputInt("Beats/bar", &m_beats_per_bar)) {
+            m_beats_per_bar = std::min(std::max(m_beats_per_bar, 1), 32);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Play from cache", &m_play_from_cache);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Play the pre-rendered song when it is up to date.\nMuting a channel switches back to the live emulator.");
+        }
+
+        const SongCache* cache = m_cache.get();
+        if (m_rendering) {
+            ImGui::SameLine();
+            ImGui::ProgressBar(m_render_progress, ImVec2(160.0f, 0.0f), "Rendering...");
+        } else if (cache) {
+            ImGui::SameLine();
+            double seconds = (double)cache->GetReadyFrames() / cache->GetSampleRate();
+            ImGui::TextDisabled("%.1f s, %.1f KiB cached", seconds, cache->GetCompressedBytes() / 1024.0);
+        }
+
+        ImVec2 avail = ImGui::GetContentRegionAvail();
+        RenderWaveform(std::max(avail.x, 50.0f), std::max(avail.y, 40.0f));
+    }
+    ImGui::End();
+}
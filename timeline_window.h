@@ -0,0 +1,58 @@
+#ifndef TIMELINE_WINDOW_H
+#define TIMELINE_WINDOW_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class SongCache;
+
+// Waveform overview of the pre-rendered song with bar markers and a play
+// cursor. Click to seek, drag to scrub; the Editor picks requests up with
+// ConsumeSeek() and forwards them to the audio engine.
+class TimelineWindow {
+public:
+    TimelineWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+    // State pushed in by the Editor every frame
+    void SetCache(std::shared_ptr<const SongCache> cache) { m_cache = std::move(cache); }
+    void SetRenderProgress(bool rendering, float progress) { m_rendering = rendering; m_render_progress = progress; }
+    void SetPlayFrame(int64_t frame) { m_play_frame = frame; }   // -1 when stopped
+    void SetTempoFromMML(const std::string& mml);
+
+    bool GetPlayFromCache() const { return m_play_from_cache; }
+
+    // Returns true once per pending seek. scrubbing is true while the mouse
+    // button is still held.
+    bool ConsumeSeek(int64_t& frame, bool& scrubbing);
+    bool IsScrubbing() const { return m_scrubbing; }
+
+private:
+    void RenderWaveform(float width, float height);
+
+    std::shared_ptr<const SongCache> m_cache;
+    std::vector<float> m_column_min;    // Per-pixel peaks, reused between frames
+    std::vector<float> m_column_max;
+    bool m_rendering;
+    float m_render_progress;
+    int64_t m_play_frame;
+
+    float m_bpm;
+    int m_beats_per_bar;
+    bool m_play_from_cache;
+
+    bool m_seek_pending;
+    bool m_scrubbing;
+    int64_t m_seek_frame;
+
+    bool m_open;
+    bool m_request_focus;
+};
+
+#endif // TIMELINE_WINDOW_H
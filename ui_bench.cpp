@@ -0,0 +1,391 @@
+// Headless UI frame benchmark. Runs the Editor against an ImGui context with
+// no platform or renderer backend, feeds it scripted input and reports the
+// CPU time and heap allocations of each frame. Built with
+// -DMDSDRV_EDITOR_BUILD_BENCH=ON; `cmake --build . --target ui_bench` runs it.
+//
+//   mdsdrv_ui_bench [--frames N] [--scale N] [--filter text] [--out file.json]
+//
+// Frame time is the UI thread's CPU time from NewFrame() to Render(), which
+// is what the GL backend would be waiting on; drawing itself is not included.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <imgui.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+#include "bench_common.h"
+#include "editor.h"
+#include "pattern_editor.h"
+#include "pcm_tool_window.h"
+
+namespace fs = std::filesystem;
+
+// Every allocation in the process is counted; frames are measured as the
+// difference across NewFrame()..Render() on the UI thread. Background work
+// the Editor starts (compiles, cache renders) can add to a frame's count.
+namespace {
+std::atomic<int64_t> g_allocations(0);
+std::atomic<int64_t> g_allocated_bytes(0);
+
+void* CountedAlloc(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+} // namespace
+
+void* operator new(size_t size)
+{
+    void* p = CountedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size)
+{
+    void* p = CountedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+const uint32_t SEED = 0x6d647364;   // Same inputs as mdsdrv_bench
+const int JSON_SCHEMA = 1;
+const int WARMUP_FRAMES = 30;       // Window layout settles, fonts and caches fill
+const ImVec2 DISPLAY_SIZE(1600.0f, 900.0f);
+const float FRAME_SECONDS = 1.0f / 60.0f;
+
+struct Options {
+    int frames = 2000;
+    int scale = 1;
+    std::string filter;
+    std::string out;
+};
+
+struct Result {
+    std::string name;
+    std::string variant;
+    std::vector<double> cpu_ms;
+    std::vector<int64_t> allocations;
+    std::vector<int64_t> allocated_bytes;
+};
+
+double CpuMilliseconds()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#else
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+template <typename T>
+T Percentile(std::vector<T> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+    return values[index];
+}
+
+template <typename T>
+double Mean(const std::vector<T>& values)
+{
+    double sum = 0.0;
+    for (T value : values) sum += (double)value;
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+void Click(ImGuiIO& io, int frame, ImVec2 pos)
+{
+    // Press on even frames, release on odd ones
+    io.AddMousePosEvent(pos.x, pos.y);
+    io.AddMouseButtonEvent(0, frame % 2 == 0);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            options.frames = std::max(10, std::atoi(argv[++i]));
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.scale = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.out = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+// Friend of Editor and PCMToolWindow, so scripts can open windows and reset
+// the waveform view without clicking through menus.
+class UiFrameBench {
+public:
+    // Called before each frame with the frame number (negative while warming
+    // up) to queue input events
+    typedef std::function<void(int frame, ImGuiIO& io)> Script;
+
+    explicit UiFrameBench(const Options& options) : m_options(options)
+    {
+        m_dir = fs::temp_directory_path() / ("mdsdrv-ui-bench-" + std::to_string(SEED));
+        fs::create_directories(m_dir);
+
+        std::string text = GenerateDocument((size_t)256 * 1024 * m_options.scale, 60, SEED);
+        m_document = (m_dir / "document.mml").string();
+        std::ofstream(m_document, std::ios::binary) << text;
+        m_document_label = SizeLabel((int64_t)text.size());
+
+        // Five minutes, mono 44.1 kHz once loaded
+        const int rate = 44100;
+        m_wav = (m_dir / "long.wav").string();
+        WriteWav(m_wav, GenerateSignal(rate, (int64_t)300 * rate * m_options.scale, SEED), rate, 16);
+    }
+
+    ~UiFrameBench()
+    {
+        std::error_code ec;
+        fs::remove_all(m_dir, ec);
+    }
+
+    void EditorIdle()
+    {
+        Run("editor_idle", m_document_label, nullptr, [](int, ImGuiIO&) {});
+    }
+
+    void EditorTyping()
+    {
+        static const char TEXT[] = "c d e f g a b > c < r\n";
+        Run("editor_typing", m_document_label, nullptr, [](int frame, ImGuiIO& io) {
+            if (frame < -WARMUP_FRAMES + 2) {
+                // Click into the text so it has keyboard focus
+                Click(io, frame + WARMUP_FRAMES, ImVec2(400.0f, 200.0f));
+                return;
+            }
+            if (frame < 0) return;
+            char c = TEXT[frame % (sizeof(TEXT) - 1)];
+            if (c == '\n') {
+                io.AddKeyEvent(ImGuiKey_Enter, true);
+            } else {
+                io.AddKeyEvent(ImGuiKey_Enter, false);
+                io.AddInputCharacter((unsigned int)c);
+            }
+        });
+    }
+
+    void EditorScroll()
+    {
+        Run("editor_scroll", m_document_label, nullptr, [](int frame, ImGuiIO& io) {
+            io.AddMousePosEvent(600.0f, 400.0f);
+            if (frame >= 0) io.AddMouseWheelEvent(0.0f, (frame / 200) % 2 ? 2.0f : -2.0f);
+        });
+    }
+
+    void PatternClicks()
+    {
+        // Clicks sweep the lower part of the window, where the note palette
+        // and step grid are; the pattern list and buttons above are left alone
+        const ImVec2 pos(0.0f, 20.0f), size(1000.0f, 800.0f);
+        Run("pattern_editor_clicks", m_document_label,
+            [&](Editor& editor) {
+                editor.m_patternEditor->SetOpen(true);
+                return Layout{ "Pattern Editor", pos, size };
+            },
+            [pos, size](int frame, ImGuiIO& io) {
+                if (frame < 0) return;
+                int click = frame / 2;
+                int columns = (int)((size.x - 40.0f) / 45.0f);
+                int rows = (int)((size.y * 0.45f) / 32.0f);
+                float x = pos.x + 20.0f + (click % columns) * 45.0f;
+                float y = pos.y + size.y * 0.5f + ((click / columns) % rows) * 32.0f;
+                Click(io, frame, ImVec2(x, y));
+            });
+    }
+
+    void WaveformZoom()
+    {
+        const ImVec2 pos(0.0f, 20.0f), size(1400.0f, 700.0f);
+        PCMToolWindow* window = nullptr;
+        Run("pcm_waveform_zoom", "5 min x" + std::to_string(m_options.scale),
+            [&](Editor& editor) {
+                window = editor.m_pcmToolWindow.get();
+                window->LoadFile(m_wav.c_str());
+                window->SetOpen(true);
+                return Layout{ "###PCMToolWindow" + std::to_string(window->m_id), pos, size };
+            },
+            [&window, pos, size](int frame, ImGuiIO& io) {
+                if (frame < 0) return;
+                // 60 frames hovering the full view, then 180 frames of wheel
+                // zoom (in for 90, out for 90) while the mouse sweeps across
+                int cycle = frame % 240;
+                float t = (cycle % 60) / 60.0f;
+                io.AddMousePosEvent(pos.x + 30.0f + t * (size.x - 60.0f), pos.y + 160.0f);
+                if (cycle == 0) {
+                    window->m_view_start = 0.0;
+                    window->m_view_length = 0.0;
+                } else if (cycle >= 60) {
+                    io.AddMouseWheelEvent(0.0f, cycle < 150 ? 1.0f : -1.0f);
+                }
+            });
+    }
+
+    void PrintSummary() const
+    {
+        for (const Result& result : m_results) {
+            fprintf(stderr, "%-24s %-12s p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms  %8.1f allocs/frame\n",
+                    result.name.c_str(), result.variant.c_str(), Percentile(result.cpu_ms, 0.5),
+                    Percentile(result.cpu_ms, 0.99), Percentile(result.cpu_ms, 1.0), Mean(result.allocations));
+        }
+    }
+
+    std::string ToJson() const
+    {
+        std::ostringstream out;
+        out << "{\n  \"schema\": " << JSON_SCHEMA << ",\n  \"frames\": " << m_options.frames
+            << ",\n  \"scale\": " << m_options.scale << ",\n  \"seed\": " << SEED
+#ifdef NDEBUG
+            << ",\n  \"optimized\": true"
+#else
+            << ",\n  \"optimized\": false"
+#endif
+            << ",\n  \"results\": [";
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            const Result& result = m_results[i];
+            char numbers[512];
+            snprintf(numbers, sizeof(numbers),
+                     "\"cpu_ms\": { \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f }, "
+                     "\"allocations_per_frame\": { \"p50\": %lld, \"p99\": %lld, \"max\": %lld, \"mean\": %.2f }, "
+                     "\"allocated_bytes_per_frame\": %.0f",
+                     Percentile(result.cpu_ms, 0.5), Percentile(result.cpu_ms, 0.9), Percentile(result.cpu_ms, 0.99),
+                     Percentile(result.cpu_ms, 1.0), Mean(result.cpu_ms),
+                     (long long)Percentile(result.allocations, 0.5), (long long)Percentile(result.allocations, 0.99),
+                     (long long)Percentile(result.allocations, 1.0), Mean(result.allocations),
+                     Mean(result.allocated_bytes));
+            out << (i ? "," : "") << "\n    { \"name\": \"" << JsonEscape(result.name) << "\", \"variant\": \""
+                << JsonEscape(result.variant) << "\", \"frames\": " << result.cpu_ms.size() << ", " << numbers << " }";
+        }
+        out << "\n  ]\n}\n";
+        return out.str();
+    }
+
+private:
+    struct Layout {
+        std::string window;     // Placed at pos/size during warm-up
+        ImVec2 pos;
+        ImVec2 size;
+    };
+    typedef std::function<Layout(Editor& editor)> Setup;
+
+    // Each scenario gets a fresh context and Editor, so earlier scripts don't
+    // leave windows open or text edited.
+    void Run(const std::string& name, const std::string& variant, const Setup& setup, const Script& script)
+    {
+        if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) return;
+
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.DisplaySize = DISPLAY_SIZE;
+        io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+        unsigned char* pixels;
+        int width, height;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+        Result result{ name, variant, {}, {}, {} };
+        {
+            Editor editor;
+            editor.OpenFile(m_document);
+            Layout layout;
+            if (setup) layout = setup(editor);
+
+            for (int frame = -WARMUP_FRAMES; frame < m_options.frames; ++frame) {
+                io.DeltaTime = FRAME_SECONDS;
+                script(frame, io);
+
+                int64_t allocations = g_allocations.load(std::memory_order_relaxed);
+                int64_t bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+                double start = CpuMilliseconds();
+
+                ImGui::NewFrame();
+                if (frame < 0 && !layout.window.empty()) {
+                    ImGui::SetWindowPos(layout.window.c_str(), layout.pos);
+                    ImGui::SetWindowSize(layout.window.c_str(), layout.size);
+                }
+                editor.Render();
+                ImGui::Render();
+
+                double elapsed = CpuMilliseconds() - start;
+                if (frame < 0) continue;
+                result.cpu_ms.push_back(elapsed);
+                result.allocations.push_back(g_allocations.load(std::memory_order_relaxed) - allocations);
+                result.allocated_bytes.push_back(g_allocated_bytes.load(std::memory_order_relaxed) - bytes);
+            }
+            editor.StopMML();
+        }
+        ImGui::DestroyContext();
+        m_results.push_back(result);
+    }
+
+    Options m_options;
+    fs::path m_dir;
+    std::string m_document;
+    std::string m_document_label;
+    std::string m_wav;
+    std::vector<Result> m_results;
+};
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::cerr << "usage: mdsdrv_ui_bench [--frames N] [--scale N] [--filter text] [--out file.json]" << std::endl;
+        return 2;
+    }
+
+    UiFrameBench bench(options);
+    bench.EditorIdle();
+    bench.EditorTyping();
+    bench.EditorScroll();
+    bench.PatternClicks();
+    bench.WaveformZoom();
+    bench.PrintSummary();
+
+    std::string json = bench.ToJson();
+    if (options.out.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(options.out);
+        out << json;
+        if (!out) {
+            std::cerr << "Could not write " << options.out << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,524 @@
+#include "vgm_export.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include "background_task.h"
+#include "song.h"
+#include "vgm.h"
+#include "platform/md.h"
+#include "stringf.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+// VGM timing is always in 44100 Hz samples; the driver is run at that rate so
+// play_step() returns delays in the same unit.
+const unsigned int VGM_RATE = 44100;
+const int64_t MAX_SECONDS = 20 * 60;
+
+const int VGM_VERSION = 0x171;
+const int VGM_HEADER_SIZE = 0x100;
+
+// Header fields (offsets into the file)
+const size_t HDR_EOF = 0x04;
+const size_t HDR_VERSION = 0x08;
+const size_t HDR_SN76489_CLOCK = 0x0C;
+const size_t HDR_GD3 = 0x14;
+const size_t HDR_TOTAL_SAMPLES = 0x18;
+const size_t HDR_LOOP_OFFSET = 0x1C;
+const size_t HDR_LOOP_SAMPLES = 0x20;
+const size_t HDR_SN76489_FEEDBACK = 0x28;
+const size_t HDR_SN76489_WIDTH = 0x2A;
+const size_t HDR_YM2612_CLOCK = 0x2C;
+const size_t HDR_DATA_OFFSET = 0x34;
+
+// Mega Drive (NTSC) chip clocks, used if the writer left them blank
+const uint32_t YM2612_CLOCK = 7670453;
+const uint32_t SN76489_CLOCK = 3579545;
+
+// Data block types below this are uncompressed streams that get appended to
+// a per-type bank; offsets into the bank are what the stream commands use.
+const uint8_t BANK_TYPE_LIMIT = 0x40;
+
+uint32_t Read32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t Read16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void Write32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+void Write16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+// Total length of the command starting at p, or 0 if it is unknown or runs
+// past end.
+size_t CommandLength(const uint8_t* p, const uint8_t* end) {
+    uint8_t cmd = p[0];
+    size_t length;
+    if (cmd == 0x67) {
+        if (end - p < 7) return 0;
+        length = 7 + (Read32(p + 3) & 0x7fffffff);
+    } else if (cmd >= 0x30 && cmd <= 0x3f) length = 2;
+    else if (cmd >= 0x40 && cmd <= 0x4e) length = 3;
+    else if (cmd == 0x4f || cmd == 0x50) length = 2;
+    else if (cmd >= 0x51 && cmd <= 0x5f) length = 3;
+    else if (cmd == 0x61) length = 3;
+    else if (cmd == 0x62 || cmd == 0x63 || cmd == 0x66) length = 1;
+    else if (cmd == 0x68) length = 12;
+    else if (cmd >= 0x70 && cmd <= 0x8f) length = 1;
+    else if (cmd == 0x90 || cmd == 0x91 || cmd == 0x95) length = 5;
+    else if (cmd == 0x92) length = 6;
+    else if (cmd == 0x93) length = 11;
+    else if (cmd == 0x94) length = 2;
+    else if (cmd >= 0xa0 && cmd <= 0xbf) length = 3;
+    else if (cmd >= 0xc0 && cmd <= 0xdf) length = 4;
+    else if (cmd >= 0xe0) length = 5;
+    else return 0;
+    return ((size_t)(end - p) >= length) ? length : 0;
+}
+
+// Samples a command waits for, or 0
+int64_t CommandWait(const uint8_t* p) {
+    uint8_t cmd = p[0];
+    if (cmd == 0x61) return Read16(p + 1);
+    if (cmd == 0x62) return 735;
+    if (cmd == 0x63) return 882;
+    if (cmd >= 0x70 && cmd <= 0x7f) return (cmd & 0x0f) + 1;
+    if (cmd >= 0x80 && cmd <= 0x8f) return cmd & 0x0f;   // DAC write, then wait
+    return 0;
+}
+
+void AppendWait(std::vector<uint8_t>& out, int64_t samples) {
+    while (samples > 0) {
+        if (samples <= 16) {
+            out.push_back((uint8_t)(0x70 + samples - 1));
+            return;
+        }
+        if (samples == 735 || samples == 882) {
+            out.push_back(samples == 735 ? 0x62 : 0x63);
+            return;
+        }
+        int64_t chunk = std::min<int64_t>(samples, 0xffff);
+        out.push_back(0x61);
+        out.push_back((uint8_t)chunk);
+        out.push_back((uint8_t)(chunk >> 8));
+        samples -= chunk;
+    }
+}
+
+// One PCM data block as found in the capture
+struct BankBlock {
+    size_t data;            // Offset of the block contents in the capture
+    uint32_t size;
+    uint32_t offset;        // Position in the bank as written by the driver
+    uint32_t new_offset;    // Position in the deduplicated bank
+    int new_index;          // Block ID in the deduplicated bank
+    int original;           // Index of the first identical block (or itself)
+};
+
+struct Bank {
+    std::vector<BankBlock> blocks;
+    uint32_t size = 0;
+    uint32_t new_size = 0;
+    int new_count = 0;
+
+    uint32_t RemapOffset(uint32_t offset) const {
+        // Last block starting at or before the offset
+        auto it = std::upper_bound(blocks.begin(), blocks.end(), offset,
+            [](uint32_t value, const BankBlock& block) { return value < block.offset; });
+        if (it == blocks.begin()) return offset;
+        const BankBlock& block = *(it - 1);
+        if (offset >= block.offset + block.size) return new_size;
+        return blocks[block.original].new_offset + (offset - block.offset);
+    }
+
+    uint16_t RemapIndex(uint16_t index) const {
+        if (index >= blocks.size()) return index;
+        return (uint16_t)blocks[blocks[index].original].new_index;
+    }
+};
+
+// Non-wait command kept in the output, at its position in time
+struct TimedCommand {
+    int64_t time;
+    size_t offset;
+    size_t size;
+};
+
+uint64_t HashBytes(const uint8_t* data, size_t size) {
+    // FNV-1a; collisions are resolved by comparing the contents
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string CaptureFilename() {
+    static int counter = 0;
+    fs::path dir = fs::temp_directory_path();
+    return (dir / ("mdsdrv_editor_capture_" + std::to_string(++counter) + ".vgm")).string();
+}
+} // namespace
+
+bool CaptureVgm(std::shared_ptr<Song> song, VgmCapture& capture, std::string& error, BackgroundTask& task)
+{
+    if (!song) {
+        error = "No song to export";
+        return false;
+    }
+
+    const double max_samples = (double)MAX_SECONDS * VGM_RATE;
+    std::string filename;
+    try {
+        filename = CaptureFilename();
+        VGM_Writer vgm(filename.c_str(), VGM_VERSION, VGM_HEADER_SIZE);
+        MD_Driver driver(VGM_RATE, &vgm);
+        driver.play_song(*song);
+
+        double time = 0.0;
+        int loops = driver.get_loop_count();
+        capture.loop_start = -1;
+        capture.loop_end = -1;
+        while (driver.is_playing() && !task.IsCancelled()) {
+            double delta = driver.play_step();
+
+            // The tick that just ran jumped back to the loop point
+            int count = driver.get_loop_count();
+            if (count != loops) {
+                loops = count;
+                if (capture.loop_start < 0) {
+                    capture.loop_start = (int64_t)(time + 0.5);
+                } else {
+                    capture.loop_end = (int64_t)(time + 0.5);
+                    break;
+                }
+            }
+
+            vgm.delay(delta);
+            time += delta;
+            if (time >= max_samples) break;
+            task.SetProgress((float)(time / max_samples));
+        }
+        vgm.stop();
+    } catch (const std::exception& e) {
+        error = std::string("Driver error: ") + e.what();
+        std::error_code ec;
+        fs::remove(filename, ec);
+        return false;
+    }
+
+    // Only a full second pass tells us how long the loop is
+    if (capture.loop_end < 0) {
+        capture.loop_start = -1;
+    }
+
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (in) {
+        std::streamsize size = in.tellg();
+        capture.data.resize((size_t)std::max<std::streamsize>(0, size));
+        in.seekg(0);
+        in.read((char*)capture.data.data(), size);
+    }
+    in.close();
+    std::error_code ec;
+    fs::remove(filename, ec);
+
+    if (task.IsCancelled()) {
+        error = "Cancelled";
+        return false;
+    }
+    if (capture.data.empty()) {
+        error = "Could not read back the captured VGM";
+        return false;
+    }
+    return true;
+}
+
+bool OptimizeVgm(const VgmCapture& capture, std::vector<uint8_t>& output, VgmExportStats& stats, std::string& error)
+{
+    const std::vector<uint8_t>& in = capture.data;
+    if (in.size() < 0x40 || std::memcmp(in.data(), "Vgm ", 4) != 0) {
+        error = "Capture is not a VGM file";
+        return false;
+    }
+
+    uint32_t version = Read32(&in[HDR_VERSION]);
+    size_t data_start = 0x40;
+    if (version >= 0x150 && Read32(&in[HDR_DATA_OFFSET]) != 0) {
+        data_start = HDR_DATA_OFFSET + Read32(&in[HDR_DATA_OFFSET]);
+    }
+    size_t data_end = in.size();
+    size_t gd3_start = 0;
+    if (Read32(&in[HDR_GD3]) != 0) {
+        gd3_start = HDR_GD3 + Read32(&in[HDR_GD3]);
+        if (gd3_start < in.size()) data_end = std::min(data_end, gd3_start);
+        else gd3_start = 0;
+    }
+    if (data_start >= data_end) {
+        error = "VGM header points past the end of the file";
+        return false;
+    }
+
+    // Walk the command stream once: time every command, collect PCM blocks
+    Bank banks[BANK_TYPE_LIMIT];
+    std::unordered_map<uint64_t, std::vector<int>> seen[BANK_TYPE_LIMIT];
+    std::vector<TimedCommand> commands;
+    int64_t time = 0;
+    const uint8_t* base = in.data();
+    const uint8_t* end = base + data_end;
+    size_t pos = data_start;
+    while (pos < data_end) {
+        const uint8_t* p = base + pos;
+        size_t length = CommandLength(p, end);
+        if (length == 0) {
+            error = stringf("Unknown VGM command %02x at offset %zx", p[0], pos);
+            return false;
+        }
+        if (p[0] == 0x66) break;
+
+        if (p[0] == 0x67 && p[2] < BANK_TYPE_LIMIT) {
+            Bank& bank = banks[p[2]];
+            BankBlock block;
+            block.data = pos + 7;
+            block.size = Read32(p + 3) & 0x7fffffff;
+            block.offset = bank.size;
+            block.original = (int)bank.blocks.size();
+            bank.size += block.size;
+            stats.data_blocks++;
+            stats.pcm_bytes_in += block.size;
+
+            uint64_t hash = HashBytes(base + block.data, block.size);
+            for (int index : seen[p[2]][hash]) {
+                const BankBlock& other = bank.blocks[index];
+                if (other.size == block.size && std::memcmp(base + other.data, base + block.data, block.size) == 0) {
+                    block.original = index;
+                    break;
+                }
+            }
+            if (block.original == (int)bank.blocks.size()) {
+                seen[p[2]][hash].push_back(block.original);
+                block.new_offset = bank.new_size;
+                block.new_index = bank.new_count++;
+                bank.new_size += block.size;
+                stats.pcm_bytes_out += block.size;
+            } else {
+                block.new_offset = 0;
+                block.new_index = -1;
+                stats.duplicate_blocks++;
+            }
+            bank.blocks.push_back(block);
+        } else if (CommandWait(p) == 0 || (p[0] >= 0x80 && p[0] <= 0x8f)) {
+            commands.push_back(TimedCommand{ time, pos, length });
+        }
+        time += CommandWait(p);
+        pos += length;
+    }
+
+    // One pass of the loop is everything up to where the second pass starts
+    int64_t end_time = time;
+    int64_t loop_time = -1;
+    if (capture.loop_start >= 0 && capture.loop_end > capture.loop_start) {
+        end_time = std::min(time, capture.loop_start);
+        loop_time = std::max<int64_t>(0, capture.loop_start - (capture.loop_end - capture.loop_start));
+    }
+
+    // Header, then every unique block up front so a loop never replays them
+    output.clear();
+    output.reserve(in.size());
+    size_t header_size = std::max<size_t>(data_start, 0x40);
+    output.insert(output.end(), in.begin(), in.begin() + std::min(header_size, in.size()));
+    output.resize(header_size, 0);
+    for (int type = 0; type < BANK_TYPE_LIMIT; ++type) {
+        for (size_t i = 0; i < banks[type].blocks.size(); ++i) {
+            const BankBlock& block = banks[type].blocks[i];
+            if (block.original != (int)i) continue;
+            uint8_t head[7] = { 0x67, 0x66, (uint8_t)type };
+            Write32(head + 3, block.size);
+            output.insert(output.end(), head, head + 7);
+            output.insert(output.end(), in.begin() + block.data, in.begin() + block.data + block.size);
+        }
+    }
+
+    // Commands, with the waits between them re-encoded
+    uint8_t stream_bank[256];
+    std::memset(stream_bank, 0, sizeof(stream_bank));
+    size_t loop_offset = 0;
+    int64_t now = 0;
+    for (const TimedCommand& event : commands) {
+        if (event.time >= end_time) break;
+        if (loop_time >= 0 && loop_offset == 0 && event.time >= loop_time) {
+            AppendWait(output, loop_time - now);
+            now = loop_time;
+            loop_offset = output.size();
+        }
+        AppendWait(output, event.time - now);
+        now = event.time;
+
+        size_t at = output.size();
+        output.insert(output.end(), in.begin() + event.offset, in.begin() + event.offset + event.size);
+        uint8_t* cmd = &output[at];
+        switch (cmd[0]) {
+        case 0x91:  // Stream data: which bank the stream reads from
+            stream_bank[cmd[1]] = cmd[2];
+            break;
+        case 0x93: {  // Stream start at a bank offset
+            uint32_t offset = Read32(cmd + 2);
+            if (offset != 0xffffffff && stream_bank[cmd[1]] < BANK_TYPE_LIMIT) {
+                Write32(cmd + 2, banks[stream_bank[cmd[1]]].RemapOffset(offset));
+            }
+            break;
+        }
+        case 0x95:  // Stream start by block ID
+            if (stream_bank[cmd[1]] < BANK_TYPE_LIMIT) {
+                Write16(cmd + 2, banks[stream_bank[cmd[1]]].RemapIndex(Read16(cmd + 2)));
+            }
+            break;
+        case 0xe0:  // Seek in the YM2612 PCM bank
+            Write32(cmd + 1, banks[0].RemapOffset(Read32(cmd + 1)));
+            break;
+        default:
+            break;
+        }
+        now += CommandWait(cmd);
+    }
+    if (loop_time >= 0 && loop_offset == 0) {
+        AppendWait(output, loop_time - now);
+        now = loop_time;
+        loop_offset = output.size();
+    }
+    AppendWait(output, end_time - now);
+    output.push_back(0x66);
+
+    size_t new_gd3 = 0;
+    if (gd3_start) {
+        new_gd3 = output.size();
+        output.insert(output.end(), in.begin() + gd3_start, in.end());
+    }
+
+    uint8_t* header = output.data();
+    Write32(header + HDR_EOF, (uint32_t)(output.size() - HDR_EOF));
+    Write32(header + HDR_VERSION, std::max<uint32_t>(version, VGM_VERSION));
+    Write32(header + HDR_GD3, new_gd3 ? (uint32_t)(new_gd3 - HDR_GD3) : 0);
+    Write32(header + HDR_TOTAL_SAMPLES, (uint32_t)end_time);
+    Write32(header + HDR_LOOP_OFFSET, loop_offset ? (uint32_t)(loop_offset - HDR_LOOP_OFFSET) : 0);
+    Write32(header + HDR_LOOP_SAMPLES, loop_offset ? (uint32_t)(end_time - loop_time) : 0);
+    Write32(header + HDR_DATA_OFFSET, (uint32_t)(header_size - HDR_DATA_OFFSET));
+    if (Read32(header + HDR_YM2612_CLOCK) == 0) {
+        Write32(header + HDR_YM2612_CLOCK, YM2612_CLOCK);
+    }
+    if (Read32(header + HDR_SN76489_CLOCK) == 0) {
+        Write32(header + HDR_SN76489_CLOCK, SN76489_CLOCK);
+        Write16(header + HDR_SN76489_FEEDBACK, 0x0009);
+        header[HDR_SN76489_WIDTH] = 16;
+    }
+
+    stats.total_samples = end_time;
+    stats.loop_samples = loop_offset ? end_time - loop_time : 0;
+    stats.raw_bytes = in.size();
+    stats.file_bytes = output.size();
+    return true;
+}
+
+bool IsVgzSupported()
+{
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CompressVgz(const std::vector<uint8_t>& input, std::vector<uint8_t>& output)
+{
+#ifdef HAVE_ZLIB
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // windowBits + 16 selects a gzip wrapper instead of raw zlib
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    output.resize(deflateBound(&stream, (uLong)input.size()) + 32);
+    stream.next_in = const_cast<Bytef*>(input.data());
+    stream.avail_in = (uInt)input.size();
+    stream.next_out = output.data();
+    stream.avail_out = (uInt)output.size();
+    int result = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+#else
+    (void)input;
+    (void)output;
+    return false;
+#endif
+}
+
+bool ExportVgm(std::shared_ptr<Song> song, const std::string& path, VgmExportStats& stats, std::string& error, BackgroundTask& task)
+{
+    stats = VgmExportStats();
+    bool compress = iequal(fs::path(path).extension().string(), ".vgz");
+    if (compress && !IsVgzSupported()) {
+        error = "This build has no zlib; export as .vgm instead";
+        return false;
+    }
+
+    VgmCapture capture;
+    if (!CaptureVgm(song, capture, error, task)) {
+        return false;
+    }
+    std::vector<uint8_t> vgm;
+    if (!OptimizeVgm(capture, vgm, stats, error)) {
+        return false;
+    }
+    capture.data.clear();
+    capture.data.shrink_to_fit();
+
+    std::vector<uint8_t> compressed;
+    if (compress) {
+        if (!CompressVgz(vgm, compressed)) {
+            error = "Compression failed";
+            return false;
+        }
+    }
+    const std::vector<uint8_t>& file = compress ? compressed : vgm;
+
+    try {
+        fs::path out_path(path);
+        if (out_path.has_parent_path()) {
+            fs::create_directories(out_path.parent_path());
+        }
+    } catch (const std::exception& e) {
+        error = std::string("Could not create directory: ") + e.what();
+        return false;
+    }
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+    out.write((const char*)file.data(), (std::streamsize)file.size());
+    if (!out) {
+        error = "Write failed for " + path;
+        return false;
+    }
+    stats.file_bytes = file.size();
+    task.SetProgress(1.0f);
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef VGM_EXPORT_H
+#define VGM_EXPORT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class Song;
+class BackgroundTask;
+
+// Figures reported back to the export window
+struct VgmExportStats {
+    int64_t total_samples = 0;      // 44100 Hz, intro plus one pass of the loop
+    int64_t loop_samples = 0;       // 0 if the song does not loop
+    int data_blocks = 0;            // PCM data blocks written by the driver
+    int duplicate_blocks = 0;       // ...of which were dropped as duplicates
+    size_t pcm_bytes_in = 0;
+    size_t pcm_bytes_out = 0;
+    size_t raw_bytes = 0;           // VGM as written by the driver
+    size_t file_bytes = 0;          // Final file, after compression if any
+};
+
+// Register log of a song, captured by running the driver faster than realtime.
+// loop_start/loop_end are sample positions in the capture: the end of the
+// first pass through the song and the length of one loop. Both are -1 for
+// songs that end.
+struct VgmCapture {
+    std::vector<uint8_t> data;
+    int64_t loop_start = -1;
+    int64_t loop_end = -1;
+};
+
+// Run the song through ctrmml's MD driver and VGM writer. The capture covers
+// the intro and two passes of the loop (so the loop length can be measured),
+// capped at MAX_SECONDS. Runs on a BackgroundTask; returns false with an
+// error message on failure or cancellation.
+bool CaptureVgm(std::shared_ptr<Song> song, VgmCapture& capture, std::string& error, BackgroundTask& task);
+
+// Rewrite a capture into the final VGM: trims it to one pass of the loop and
+// sets the loop offset, hoists PCM data blocks to the start and drops the
+// duplicates (remapping the stream offsets that point into them), and fixes
+// up the header. Returns false if the capture could not be parsed.
+bool OptimizeVgm(const VgmCapture& capture, std::vector<uint8_t>& output, VgmExportStats& stats, std::string& error);
+
+// gzip for .vgz files. Only available when built with zlib.
+bool IsVgzSupported();
+bool CompressVgz(const std::vector<uint8_t>& input, std::vector<uint8_t>& output);
+
+// Capture, optimize and write the file; compressed when the path ends in .vgz.
+bool ExportVgm(std::shared_ptr<Song> song, const std::string& path, VgmExportStats& stats, std::string& error, BackgroundTask& task);
+
+#endif // VGM_EXPORT_H
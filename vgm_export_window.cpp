@@ -0,0 +1,127 @@
+#include "vgm_export_window.h"
+#include <imgui.h>
+#include <cstring>
+#include <filesystem>
+#include "stringf.h"
+
+namespace fs = std::filesystem;
+
+VgmExportWindow::VgmExportWindow()
+    : m_open(false), m_request_focus(false), m_browse_save(false),
+      m_export_requested(false), m_exporting(false), m_task_ok(false),
+      m_fs(true, false, true)
+{
+    std::memset(m_output_path, 0, sizeof(m_output_path));
+    std::strncpy(m_output_path, "song.vgm", sizeof(m_output_path) - 1);
+    m_status_message = "Ready";
+}
+
+void VgmExportWindow::SetSourcePath(const std::string& mml_path)
+{
+    if (mml_path.empty() || mml_path == m_source_path) return;
+    m_source_path = mml_path;
+    fs::path out_path(mml_path);
+    out_path.replace_extension(IsVgzSupported() ? ".vgz" : ".vgm");
+    std::strncpy(m_output_path, out_path.string().c_str(), sizeof(m_output_path) - 1);
+}
+
+bool VgmExportWindow::ConsumeExportRequest()
+{
+    bool requested = m_export_requested;
+    m_export_requested = false;
+    return requested;
+}
+
+void VgmExportWindow::StartExport(std::shared_ptr<Song> song)
+{
+    m_exporting = true;
+    m_status_message = "Exporting...";
+    m_task_path = m_output_path;
+    m_task.Start([this, song](BackgroundTask& task) {
+        m_task_ok = ExportVgm(song, m_task_path, m_task_stats, m_task_error, task);
+    });
+}
+
+void VgmExportWindow::FinishExport()
+{
+    m_task.Join();
+    m_exporting = false;
+    if (!m_task_ok) {
+        m_status_message = "Export failed: " + m_task_error;
+        return;
+    }
+
+    const VgmExportStats& stats = m_task_stats;
+    m_status_message = stringf("Wrote %zu bytes to %s\n", stats.file_bytes, m_task_path.c_str());
+    if (stats.loop_samples > 0) {
+        m_status_message += stringf("Length %.1f s, loop %.1f s\n",
+                                    stats.total_samples / 44100.0, stats.loop_samples / 44100.0);
+    } else {
+        m_status_message += stringf("Length %.1f s, no loop\n", stats.total_samples / 44100.0);
+    }
+    m_status_message += stringf("PCM data blocks: %d (%d duplicates dropped), %zu -> %zu bytes\n",
+                                stats.data_blocks, stats.duplicate_blocks, stats.pcm_bytes_in, stats.pcm_bytes_out);
+    m_status_message += stringf("Driver output %zu bytes", stats.raw_bytes);
+}
+
+void VgmExportWindow::Render()
+{
+    // Pick up a finished export even while the window is closed
+    if (m_exporting && !m_task.IsRunning()) {
+        FinishExport();
+    }
+
+    if (!m_open) return;
+
+    ImGui::SetNextWindowSize(ImVec2(480, 300), ImGuiCond_FirstUseEver);
+
+    if (m_request_focus) {
+        ImGui::SetNextWindowFocus();
+        m_request_focus = false;
+    }
+
+    if (ImGui::Begin("VGM export", &m_open)) {
+        ImGui::TextWrapped("Render the current song through the driver and save the register log.");
+        if (!IsVgzSupported()) {
+            ImGui::TextDisabled("Built without zlib: .vgz output is unavailable.");
+        }
+        ImGui::Separator();
+
+        ImGui::InputText("Destination", m_output_path, sizeof(m_output_path));
+        ImGui::SameLine();
+        bool trigger_save = ImGui::Button("Browse...");
+
+        if (m_exporting) {
+            ImGui::ProgressBar(m_task.GetProgress(), ImVec2(200.0f, 0.0f), "Rendering...");
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                m_task.Cancel();
+            }
+        } else if (ImGui::Button("Export")) {
+            m_export_requested = true;
+        }
+
+        if (m_browse_save) {
+            ImVec2 size(520, 380);
+            ImVec2 center = ImGui::GetIO().DisplaySize * 0.5f;
+            ImVec2 pos(center.x - size.x * 0.5f, center.y - size.y * 0.5f);
+
+            const char* default_ext = IsVgzSupported() ? ".vgz" : ".vgm";
+            const char* path = m_fs.saveFileDialog(trigger_save, m_output_path, nullptr, default_ext, "Save VGM", size, pos);
+            if (std::strlen(path) > 0) {
+                std::strncpy(m_output_path, path, sizeof(m_output_path) - 1);
+                m_browse_save = false;
+            } else if (m_fs.hasUserJustCancelledDialog()) {
+                m_browse_save = false;
+            }
+        }
+        else if (trigger_save) {
+            // Start the dialog on this frame
+            m_browse_save = true;
+        }
+
+        ImGui::Separator();
+        ImGui::TextWrapped("%s", m_status_message.c_str());
+    }
+    ImGui::End();
+}
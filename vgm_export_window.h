@@ -0,0 +1,55 @@
+#ifndef VGM_EXPORT_WINDOW_H
+#define VGM_EXPORT_WINDOW_H
+
+#include <memory>
+#include <string>
+#include "background_task.h"
+#include "imguifilesystem.h"
+#include "vgm_export.h"
+
+// Forward declarations
+class Song;
+
+// Exports the song in the editor as .vgm/.vgz. The window asks for a song with
+// ConsumeExportRequest(); the Editor compiles the current text and hands it
+// back through StartExport(), which renders it on a worker thread.
+class VgmExportWindow {
+public:
+    VgmExportWindow();
+
+    void Render();
+    bool IsOpen() const { return m_open; }
+    void SetOpen(bool open) { m_open = open; if (open) m_request_focus = true; }
+
+    // Returns true once after the Export button was pressed
+    bool ConsumeExportRequest();
+    void StartExport(std::shared_ptr<Song> song);
+    void SetError(const std::string& message) { m_status_message = message; }
+
+    // Suggest a file name next to the MML file being edited
+    void SetSourcePath(const std::string& mml_path);
+
+private:
+    void FinishExport();
+
+    char m_output_path[1024];
+    std::string m_source_path;
+    std::string m_status_message;
+
+    bool m_open;
+    bool m_request_focus;
+    bool m_browse_save;
+    bool m_export_requested;
+    bool m_exporting;
+
+    // Owned by the job while it runs
+    std::string m_task_path;
+    VgmExportStats m_task_stats;
+    std::string m_task_error;
+    bool m_task_ok;
+    BackgroundTask m_task;          // After the fields above, so it is joined first
+
+    ImGuiFs::Dialog m_fs;
+};
+
+#endif // VGM_EXPORT_WINDOW_H
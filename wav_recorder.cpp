@@ -0,0 +1,266 @@
+#include "wav_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "wav_writer.h"
+
+namespace {
+// Emulator output is 16-bit audio scaled up by 8 bits
+const int SAMPLE_SHIFT = 8;
+
+// Large enough that the writer hits the disk a few times a second at most
+const size_t FILE_BUFFER_BYTES = 1 << 20;
+
+const int WRITER_SLEEP_MS = 10;
+
+// How long the writer waits for the audio thread to acknowledge Stop()
+// before assuming the device is no longer running
+const int STOP_TIMEOUT_MS = 500;
+
+int16_t ToSample16(int32_t value) {
+    value >>= SAMPLE_SHIFT;
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+} // namespace
+
+WavRecorder::WavRecorder()
+    : m_head(0), m_tail(0), m_state(IDLE), m_fill(0), m_drop_fill(0),
+      m_frames(0), m_dropped_frames(0), m_dropped_blocks(0), m_max_fill(0),
+      m_file(nullptr), m_data_bytes(0), m_sample_rate(0)
+{
+}
+
+WavRecorder::~WavRecorder()
+{
+    // Nothing feeds us any more; close the file with what was recorded
+    if (m_state.load(std::memory_order_acquire) != IDLE) {
+        m_state.store(DRAINING, std::memory_order_release);
+#ifdef __EMSCRIPTEN__
+        Drain();
+        Finalize();
+#else
+        if (m_thread.joinable()) m_thread.join();
+#endif
+    }
+}
+
+bool WavRecorder::Start(const std::string& path, uint32_t sample_rate, std::string& error)
+{
+    if (IsRecording()) {
+        error = "A recording is still being written";
+        return false;
+    }
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+    if (!m_file_buffer) {
+        m_file_buffer.reset(new char[FILE_BUFFER_BYTES]);
+    }
+    std::setvbuf(m_file, m_file_buffer.get(), _IOFBF, FILE_BUFFER_BYTES);
+
+    // Placeholder sizes, patched in Finalize()
+    uint8_t header[WAV_HEADER_BYTES];
+    MakeWavHeader(header, 2, sample_rate, 0);
+    std::fwrite(header, 1, sizeof(header), m_file);
+
+    if (!m_blocks) {
+        m_blocks.reset(new Block[RING_BLOCKS]);
+    }
+    m_path = path;
+    m_sample_rate = sample_rate;
+    m_data_bytes = 0;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    m_fill = 0;
+    m_drop_fill = 0;
+    m_frames.store(0, std::memory_order_relaxed);
+    m_dropped_frames.store(0, std::memory_order_relaxed);
+    m_dropped_blocks.store(0, std::memory_order_relaxed);
+    m_max_fill.store(0, std::memory_order_relaxed);
+
+    // Everything above is visible to the audio thread once it sees RECORDING
+    m_state.store(RECORDING, std::memory_order_release);
+#ifndef __EMSCRIPTEN__
+    m_thread = std::thread([this]() { WriterLoop(); });
+#endif
+    return true;
+}
+
+void WavRecorder::Stop()
+{
+    int expected = RECORDING;
+    m_state.compare_exchange_strong(expected, STOPPING, std::memory_order_acq_rel);
+}
+
+bool WavRecorder::IsRecording() const
+{
+    int state = m_state.load(std::memory_order_acquire);
+    return state != IDLE;
+}
+
+bool WavRecorder::IsStopping() const
+{
+    int state = m_state.load(std::memory_order_acquire);
+    return state != IDLE && state != RECORDING;
+}
+
+WavRecorder::Stats WavRecorder::GetStats() const
+{
+    Stats stats;
+    stats.frames = m_frames.load(std::memory_order_relaxed);
+    stats.dropped_frames = m_dropped_frames.load(std::memory_order_relaxed);
+    stats.dropped_blocks = m_dropped_blocks.load(std::memory_order_relaxed);
+    stats.max_fill = m_max_fill.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void WavRecorder::Update()
+{
+#ifdef __EMSCRIPTEN__
+    // No writer thread: drain from the UI loop instead
+    int state = m_state.load(std::memory_order_acquire);
+    if (state == IDLE) return;
+    Drain();
+    if (state == STOPPING) {
+        // The audio callback runs on this thread too, so it is not inside Write()
+        if (m_fill > 0) PublishBlock();
+        m_state.store(DRAINING, std::memory_order_release);
+        state = DRAINING;
+    }
+    if (state == DRAINING) {
+        Drain();
+        Finalize();
+        m_state.store(IDLE, std::memory_order_release);
+    }
+#else
+    if (m_state.load(std::memory_order_acquire) == DONE) {
+        if (m_thread.joinable()) m_thread.join();
+        m_state.store(IDLE, std::memory_order_release);
+    }
+#endif
+}
+
+void WavRecorder::PublishBlock()
+{
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    m_blocks[head % RING_BLOCKS].frames = m_fill;
+    m_head.store(head + 1, std::memory_order_release);
+    m_fill = 0;
+
+    int fill = (int)(head + 1 - m_tail.load(std::memory_order_acquire));
+    if (fill > m_max_fill.load(std::memory_order_relaxed)) {
+        m_max_fill.store(fill, std::memory_order_relaxed);
+    }
+}
+
+void WavRecorder::Write(const WAVE_32BS* frames, int count)
+{
+    int state = m_state.load(std::memory_order_acquire);
+    if (state == STOPPING) {
+        int expected = STOPPING;
+        if (!m_state.compare_exchange_strong(expected, FLUSHING, std::memory_order_acq_rel)) return;
+        if (m_fill > 0) PublishBlock();
+        m_state.store(DRAINING, std::memory_order_release);
+        return;
+    }
+    if (state != RECORDING) return;
+
+    while (count > 0) {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= (uint64_t)RING_BLOCKS) {
+            // The writer is behind and every slot is taken: drop this audio
+            m_dropped_frames.fetch_add(count, std::memory_order_relaxed);
+            m_drop_fill += count;
+            if (m_drop_fill >= BLOCK_FRAMES) {
+                m_dropped_blocks.fetch_add(m_drop_fill / BLOCK_FRAMES, std::memory_order_relaxed);
+                m_drop_fill %= BLOCK_FRAMES;
+            }
+            return;
+        }
+        if (m_drop_fill > 0) {
+            // A partial drop still loses a block's worth of continuity
+            m_dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+            m_drop_fill = 0;
+        }
+
+        Block& block = m_blocks[head % RING_BLOCKS];
+        int n = std::min(count, BLOCK_FRAMES - m_fill);
+        int16_t* out = block.samples + m_fill * 2;
+        for (int i = 0; i < n; ++i) {
+            out[i * 2] = ToSample16(frames[i].L);
+            out[i * 2 + 1] = ToSample16(frames[i].R);
+        }
+        m_fill += n;
+        frames += n;
+        count -= n;
+        if (m_fill == BLOCK_FRAMES) {
+            PublishBlock();
+        }
+    }
+}
+
+bool WavRecorder::Drain()
+{
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    if (tail == head) return false;
+    for (; tail != head; ++tail) {
+        const Block& block = m_blocks[tail % RING_BLOCKS];
+        if (m_file) {
+            // WAV is little-endian, as is every platform we build for
+            std::fwrite(block.samples, sizeof(int16_t) * 2, block.frames, m_file);
+        }
+        m_data_bytes += (uint64_t)block.frames * 4;
+        m_frames.fetch_add(block.frames, std::memory_order_relaxed);
+        // Hand the slot back as soon as it is written
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+    return true;
+}
+
+void WavRecorder::Finalize()
+{
+    if (!m_file) return;
+    uint8_t header[WAV_HEADER_BYTES];
+    MakeWavHeader(header, 2, m_sample_rate, m_data_bytes);
+    std::fflush(m_file);
+    std::fseek(m_file, 0, SEEK_SET);
+    std::fwrite(header, 1, sizeof(header), m_file);
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+void WavRecorder::WriterLoop()
+{
+    auto stop_time = std::chrono::steady_clock::time_point();
+    bool stop_seen = false;
+    for (;;) {
+        int state = m_state.load(std::memory_order_acquire);
+        if (state == DRAINING) {
+            Drain();
+            break;
+        }
+        if (state == STOPPING) {
+            // If the device has stopped, the audio thread never answers
+            auto now = std::chrono::steady_clock::now();
+            if (!stop_seen) {
+                stop_seen = true;
+                stop_time = now;
+            } else if (now - stop_time > std::chrono::milliseconds(STOP_TIMEOUT_MS)) {
+                int expected = STOPPING;
+                m_state.compare_exchange_strong(expected, DRAINING, std::memory_order_acq_rel);
+                continue;
+            }
+        }
+        if (!Drain()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_SLEEP_MS));
+        }
+    }
+    Finalize();
+    m_state.store(DONE, std::memory_order_release);
+}
@@ -0,0 +1,93 @@
+#ifndef WAV_RECORDER_H
+#define WAV_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include "audio_manager.h"
+
+// Records the engine's final output to a 16-bit stereo WAV file. The audio
+// thread only converts into preallocated blocks and publishes them through a
+// lock-free ring; a writer thread drains the ring to disk with large buffered
+// writes. If the disk falls behind, the audio thread drops whole blocks
+// rather than wait, and counts them.
+class WavRecorder {
+public:
+    static const int BLOCK_FRAMES = 4096;
+    static const int RING_BLOCKS = 64;      // About 6 s at 44.1 kHz
+
+    struct Stats {
+        int64_t frames;             // Frames written to the file
+        int64_t dropped_frames;
+        uint32_t dropped_blocks;    // Blocks lost because the ring was full
+        int max_fill;               // Most blocks ever waiting in the ring
+    };
+
+    WavRecorder();
+    ~WavRecorder();
+
+    WavRecorder(const WavRecorder&) = delete;
+    WavRecorder& operator=(const WavRecorder&) = delete;
+
+    // UI thread. Start() fails if a recording is still being finished.
+    bool Start(const std::string& path, uint32_t sample_rate, std::string& error);
+    void Stop();
+    // Once per UI frame: closes a stopped recording once the writer is done.
+    void Update();
+    bool IsRecording() const;       // From Start() until the file is closed
+    bool IsStopping() const;
+    Stats GetStats() const;
+    const std::string& GetPath() const { return m_path; }
+    uint32_t GetSampleRate() const { return m_sample_rate; }
+
+    // Audio thread
+    void Write(const WAVE_32BS* frames, int count);
+
+private:
+    enum State {
+        IDLE,
+        RECORDING,
+        STOPPING,       // Stop() called, waiting for the audio thread
+        FLUSHING,       // Audio thread is queueing its partial block
+        DRAINING,       // No more input; the writer empties the ring and closes
+        DONE            // File closed, thread can be joined
+    };
+
+    struct Block {
+        int frames;
+        int16_t samples[BLOCK_FRAMES * 2];
+    };
+
+    void WriterLoop();
+    bool Drain();
+    void Finalize();
+    void PublishBlock();
+
+    std::unique_ptr<Block[]> m_blocks;
+    std::atomic<uint64_t> m_head;       // Blocks published by the audio thread
+    std::atomic<uint64_t> m_tail;       // Blocks written by the writer
+    std::atomic<int> m_state;
+
+    // Audio thread only
+    int m_fill;                         // Frames in the block being filled
+    int m_drop_fill;                    // Frames dropped towards the next dropped block
+
+    // Counters (audio thread and writer -> UI)
+    std::atomic<int64_t> m_frames;
+    std::atomic<int64_t> m_dropped_frames;
+    std::atomic<uint32_t> m_dropped_blocks;
+    std::atomic<int> m_max_fill;
+
+    // Writer thread (UI thread while idle)
+    std::FILE* m_file;
+    std::unique_ptr<char[]> m_file_buffer;
+    uint64_t m_data_bytes;
+    std::string m_path;
+    uint32_t m_sample_rate;
+    std::thread m_thread;
+};
+
+#endif // WAV_RECORDER_H
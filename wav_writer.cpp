@@ -0,0 +1,79 @@
+#include "wav_writer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const uint32_t SMPL_CHUNK_BYTES = 8 + 36 + 24;      // Header, fields, one loop
+
+const uint32_t MIDI_UNITY_NOTE = 60;
+
+void Put16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+void Put32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+void MakeSmplChunk(uint8_t* p, uint32_t sample_rate, const WavLoop& loop) {
+    std::memset(p, 0, SMPL_CHUNK_BYTES);
+    std::memcpy(p, "smpl", 4);
+    Put32(p + 4, SMPL_CHUNK_BYTES - 8);
+    Put32(p + 16, sample_rate ? 1000000000u / sample_rate : 0);    // Sample period, ns
+    Put32(p + 20, MIDI_UNITY_NOTE);
+    Put32(p + 36, 1);                       // Loop count
+    // Loop: cue point 0, forward, start, end, no fraction, infinite
+    Put32(p + 52, loop.start);
+    Put32(p + 56, loop.end);
+}
+} // namespace
+
+void MakeWavHeader(uint8_t* header, int channels, uint32_t sample_rate, uint64_t data_bytes,
+                   uint32_t extra_bytes)
+{
+    // Sizes saturate for files past 4 GB; most readers then read to EOF
+    uint32_t data = (uint32_t)std::min<uint64_t>(data_bytes, 0xffffffffull - 36 - extra_bytes);
+    uint16_t frame_bytes = (uint16_t)(channels * 2);
+    std::memcpy(header, "RIFF", 4);
+    Put32(header + 4, data + 36 + extra_bytes);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    Put32(header + 16, 16);
+    Put16(header + 20, 1);                              // PCM
+    Put16(header + 22, (uint16_t)channels);
+    Put32(header + 24, sample_rate);
+    Put32(header + 28, sample_rate * frame_bytes);      // Bytes per second
+    Put16(header + 32, frame_bytes);
+    Put16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    Put32(header + 40, data);
+}
+
+void EncodeWav(const short* samples, size_t frames, int channels, uint32_t sample_rate,
+               const WavLoop* loop, std::vector<uint8_t>& out)
+{
+    size_t data_bytes = frames * channels * sizeof(short);
+    uint32_t extra = loop ? SMPL_CHUNK_BYTES : 0;
+    out.resize(WAV_HEADER_BYTES + data_bytes + extra);
+    MakeWavHeader(out.data(), channels, sample_rate, data_bytes, extra);
+
+    // Samples are stored little-endian, as they are in memory on every target
+    std::memcpy(out.data() + WAV_HEADER_BYTES, samples, data_bytes);
+    if (loop) {
+        MakeSmplChunk(out.data() + WAV_HEADER_BYTES + data_bytes, sample_rate, *loop);
+    }
+}
+
+bool WriteFileAtOnce(const std::string& path, const std::vector<uint8_t>& bytes)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    setvbuf(file, nullptr, _IONBF, 0);
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
@@ -0,0 +1,34 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Canonical 16-bit PCM WAV files: a 44-byte header, the data chunk and,
+// optionally, a smpl chunk after it. Readers that only know the canonical
+// layout still find the data at offset 44.
+
+const size_t WAV_HEADER_BYTES = 44;
+
+// Loop points for the smpl chunk, in frames; end is the last frame played
+struct WavLoop {
+    uint32_t start;
+    uint32_t end;
+};
+
+// Fill header with RIFF/fmt/data headers for data_bytes of audio followed
+// by extra_bytes of trailing chunks. Sizes saturate past 4 GB.
+void MakeWavHeader(uint8_t* header, int channels, uint32_t sample_rate, uint64_t data_bytes,
+                   uint32_t extra_bytes = 0);
+
+// Build a complete file in memory. out is resized, so reusing it across
+// calls avoids reallocating.
+void EncodeWav(const short* samples, size_t frames, int channels, uint32_t sample_rate,
+               const WavLoop* loop, std::vector<uint8_t>& out);
+
+// Write bytes as the whole file, unbuffered, so it goes out in one write
+bool WriteFileAtOnce(const std::string& path, const std::vector<uint8_t>& bytes);
+
+#endif // WAV_WRITER_H
@@ -0,0 +1,100 @@
+#include "waveform_peaks.h"
+#include <algorithm>
+#include <cmath>
+
+const int WaveformPeaks::BASE_SHIFT;
+const size_t WaveformPeaks::BASE_BLOCK;
+
+WaveformPeaks::WaveformPeaks() : m_size(0)
+{
+}
+
+void WaveformPeaks::Clear()
+{
+    m_levels.clear();
+    m_size = 0;
+}
+
+void WaveformPeaks::Append(const short* data, size_t count)
+{
+    if (count <= m_size) return;
+
+    // Level 0 from the samples, starting at the block that was partial
+    if (m_levels.empty()) m_levels.emplace_back();
+    size_t first = m_size >> BASE_SHIFT;
+    size_t blocks = (count + BASE_BLOCK - 1) >> BASE_SHIFT;
+    std::vector<Peak>& base = m_levels[0];
+    base.resize(blocks);
+    for (size_t b = first; b < blocks; ++b) {
+        const short* p = data + (b << BASE_SHIFT);
+        const short* end = data + std::min(count, (b + 1) << BASE_SHIFT);
+        short lo = *p;
+        short hi = *p;
+        for (++p; p < end; ++p) {
+            lo = std::min(lo, *p);
+            hi = std::max(hi, *p);
+        }
+        base[b] = Peak{ lo, hi };
+    }
+    m_size = count;
+
+    // Each level above pairs up the one below, until a level is one entry
+    for (size_t level = 1; m_levels[level - 1].size() > 1; ++level) {
+        if (m_levels.size() <= level) m_levels.emplace_back();
+        const std::vector<Peak>& below = m_levels[level - 1];
+        std::vector<Peak>& peaks = m_levels[level];
+        first >>= 1;
+        peaks.resize((below.size() + 1) / 2);
+        for (size_t b = first; b < peaks.size(); ++b) {
+            Peak peak = below[b * 2];
+            if (b * 2 + 1 < below.size()) {
+                peak.min = std::min(peak.min, below[b * 2 + 1].min);
+                peak.max = std::max(peak.max, below[b * 2 + 1].max);
+            }
+            peaks[b] = peak;
+        }
+    }
+}
+
+void WaveformPeaks::Query(const short* data, double start, double samples_per_column, int columns,
+                          short* out_min, short* out_max) const
+{
+    for (int c = 0; c < columns; ++c) {
+        double from = std::floor(start + c * samples_per_column);
+        double to = std::floor(start + (c + 1) * samples_per_column);
+        size_t s0 = (size_t)std::max(0.0, from);
+        size_t s1 = (size_t)std::max(0.0, std::min((double)m_size, std::max(to, from + 1.0)));
+        if (s0 >= s1) {
+            out_min[c] = 1;
+            out_max[c] = 0;
+            continue;
+        }
+
+        size_t span = s1 - s0;
+        short lo = 32767;
+        short hi = -32768;
+        if (span < BASE_BLOCK) {
+            for (size_t i = s0; i < s1; ++i) {
+                lo = std::min(lo, data[i]);
+                hi = std::max(hi, data[i]);
+            }
+        } else {
+            // Largest level whose entries are no wider than the span; whole
+            // entries overlapping it are used, so the edges can reach up to
+            // one entry (less than a column) past it
+            size_t level = 0;
+            while (level + 1 < m_levels.size() && ((size_t)1 << (BASE_SHIFT + level + 1)) <= span) {
+                ++level;
+            }
+            int shift = BASE_SHIFT + (int)level;
+            const std::vector<Peak>& peaks = m_levels[level];
+            size_t b1 = std::min(peaks.size(), ((s1 - 1) >> shift) + 1);
+            for (size_t b = s0 >> shift; b < b1; ++b) {
+                lo = std::min(lo, peaks[b].min);
+                hi = std::max(hi, peaks[b].max);
+            }
+        }
+        out_min[c] = lo;
+        out_max[c] = hi;
+    }
+}
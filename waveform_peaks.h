@@ -0,0 +1,46 @@
+#ifndef WAVEFORM_PEAKS_H
+#define WAVEFORM_PEAKS_H
+
+#include <cstddef>
+#include <vector>
+
+// Min/max pyramid over a mono 16-bit buffer, for drawing one column per
+// pixel at any zoom. Level 0 summarizes BASE_BLOCK samples per entry and
+// each level above halves the entry count, so a column spanning n samples
+// is answered from a handful of entries at the level just below n.
+//
+// The samples themselves are not kept; Query() is handed the same buffer
+// that was appended, which lets it grow (or reallocate) freely in between.
+class WaveformPeaks {
+public:
+    static const int BASE_SHIFT = 4;
+    static const size_t BASE_BLOCK = (size_t)1 << BASE_SHIFT;
+
+    WaveformPeaks();
+
+    void Clear();
+
+    // Extend the pyramid from GetSize() to count samples of data. The block
+    // that was partly filled before is recomputed, so appending in pieces
+    // gives the same result as building at once.
+    void Append(const short* data, size_t count);
+
+    size_t GetSize() const { return m_size; }
+
+    // Min and max of columns consecutive spans of samples_per_column
+    // samples, the first starting at start. Columns past either end of the
+    // data get min > max.
+    void Query(const short* data, double start, double samples_per_column, int columns,
+               short* out_min, short* out_max) const;
+
+private:
+    struct Peak {
+        short min;
+        short max;
+    };
+
+    std::vector<std::vector<Peak>> m_levels;
+    size_t m_size;
+};
+
+#endif // WAVEFORM_PEAKS_H
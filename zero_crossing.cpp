@@ -0,0 +1,76 @@
+#include "zero_crossing.h"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ZERO_CROSSING_SSE2 1
+#endif
+
+namespace {
+// Boundaries tested per step
+const int64_t BLOCK = 8;
+
+// Bit k set when boundary first + k is a crossing; boundaries outside
+// [lo, hi] are never set. lo is at least 1, hi at most count - 1.
+unsigned CrossingMask(const short* data, int64_t first, int64_t lo, int64_t hi)
+{
+#ifdef ZERO_CROSSING_SSE2
+    if (first >= lo && first + BLOCK - 1 <= hi) {
+        // The sign bit of a ^ b is set where the two differ in sign
+        __m128i a = _mm_loadu_si128((const __m128i*)(data + first));
+        __m128i b = _mm_loadu_si128((const __m128i*)(data + first - 1));
+        __m128i differs = _mm_srai_epi16(_mm_xor_si128(a, b), 15);
+        return (unsigned)_mm_movemask_epi8(_mm_packs_epi16(differs, differs)) & 0xff;
+    }
+#endif
+    unsigned mask = 0;
+    for (int64_t k = 0; k < BLOCK; ++k) {
+        int64_t i = first + k;
+        if (i >= lo && i <= hi && (data[i] ^ data[i - 1]) < 0) mask |= 1u << k;
+    }
+    return mask;
+}
+
+int LowestBit(unsigned mask)
+{
+    int bit = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+}
+
+int HighestBit(unsigned mask)
+{
+    int bit = 0;
+    while (mask >>= 1) ++bit;
+    return bit;
+}
+} // namespace
+
+size_t FindZeroCrossing(const short* data, size_t count, size_t position, size_t radius)
+{
+    if (count < 2 || position > count) return position;
+    radius = std::min(radius, MAX_ZERO_CROSSING_RADIUS);
+    int64_t pos = (int64_t)position;
+    int64_t lo = std::max<int64_t>(1, pos - (int64_t)radius);
+    int64_t hi = std::min<int64_t>((int64_t)count - 1, pos + (int64_t)radius);
+
+    // Step outwards a block at a time on each side. Step n covers distances
+    // 8n..8n+7 on both sides, so the first step with a hit holds the nearest
+    // crossing.
+    for (int64_t right = pos, left = pos - BLOCK + 1; right <= hi || left + BLOCK - 1 >= lo;
+         right += BLOCK, left -= BLOCK) {
+        unsigned right_mask = right <= hi ? CrossingMask(data, right, lo, hi) : 0;
+        unsigned left_mask = left + BLOCK - 1 >= lo ? CrossingMask(data, left, lo, hi) : 0;
+        if (!right_mask && !left_mask) continue;
+
+        int64_t best_right = right + LowestBit(right_mask | 0x100);
+        int64_t best_left = left + HighestBit(left_mask);
+        if (!left_mask || (right_mask && best_right - pos <= pos - best_left)) return (size_t)best_right;
+        return (size_t)best_left;
+    }
+    return position;
+}
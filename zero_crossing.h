@@ -0,0 +1,19 @@
+#ifndef ZERO_CROSSING_H
+#define ZERO_CROSSING_H
+
+#include <cstddef>
+
+// Largest search radius FindZeroCrossing() honours. The search looks at
+// eight boundaries per step outwards from the position, so even the full
+// radius is a few thousand compares and stays cheap enough to run on every
+// mouse move while a handle is dragged.
+const size_t MAX_ZERO_CROSSING_RADIUS = 16384;
+
+// Nearest zero crossing to position in mono 16-bit data, at most radius
+// samples away. A crossing is a boundary i (0 < i < count) where data[i - 1]
+// and data[i] differ in sign, so cutting there starts or ends a piece right
+// at the sign change. Ties go to the later boundary. Returns position
+// unchanged when there is no crossing in range.
+size_t FindZeroCrossing(const short* data, size_t count, size_t position, size_t radius);
+
+#endif // ZERO_CROSSING_H